@@ -0,0 +1,91 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include <map>
+#include "fixtures.h"
+#include "../utils/archive.h"
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+namespace Bench {
+
+namespace {
+
+struct ArchiveFixture {
+    std::string sourceDir;
+    std::string archivePath;
+    std::uint64_t bytes = 0;
+};
+
+// Trees and archives are built once per shape and shared between benchmarks
+const ArchiveFixture& fixtureFor(FileShape shape) {
+    static std::map<FileShape, ArchiveFixture> fixtures;
+
+    auto it = fixtures.find(shape);
+    if (it != fixtures.end()) {
+        return it->second;
+    }
+
+    ArchiveFixture fixture;
+    fixture.sourceDir = (fs::path(scratchDirectory()) / "src" / fileShapeName(shape)).string();
+    fixture.archivePath = (fs::path(scratchDirectory()) / (std::string(fileShapeName(shape)) + ".XEmupkg")).string();
+    fixture.bytes = createGameTree(fixture.sourceDir, shape);
+    createArchive(fixture.sourceDir, fixture.archivePath);
+
+    return fixtures.emplace(shape, fixture).first->second;
+}
+
+void BM_CreateArchive(benchmark::State& state) {
+    FileShape shape = static_cast<FileShape>(state.range(0));
+    const ArchiveFixture& fixture = fixtureFor(shape);
+    std::string output = (fs::path(scratchDirectory()) / "create_out.XEmupkg").string();
+
+    for (auto _ : state) {
+        if (!createArchive(fixture.sourceDir, output)) {
+            state.SkipWithError("createArchive failed");
+            break;
+        }
+    }
+
+    state.SetLabel(fileShapeName(shape));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * fixture.bytes));
+    fs::remove(output);
+}
+
+void BM_ExtractArchive(benchmark::State& state) {
+    FileShape shape = static_cast<FileShape>(state.range(0));
+    const ArchiveFixture& fixture = fixtureFor(shape);
+    std::string output = (fs::path(scratchDirectory()) / "extract_out").string();
+
+    for (auto _ : state) {
+        state.PauseTiming();
+        fs::remove_all(output);
+        state.ResumeTiming();
+
+        if (!extractArchive(fixture.archivePath, output)) {
+            state.SkipWithError("extractArchive failed");
+            break;
+        }
+    }
+
+    state.SetLabel(fileShapeName(shape));
+    state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * fixture.bytes));
+    fs::remove_all(output);
+}
+
+} // namespace
+
+BENCHMARK(BM_CreateArchive)
+    ->Arg(static_cast<int>(FileShape::Tiny))
+    ->Arg(static_cast<int>(FileShape::Mixed))
+    ->Arg(static_cast<int>(FileShape::Large))
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(BM_ExtractArchive)
+    ->Arg(static_cast<int>(FileShape::Tiny))
+    ->Arg(static_cast<int>(FileShape::Mixed))
+    ->Arg(static_cast<int>(FileShape::Large))
+    ->Unit(benchmark::kMillisecond);
+
+} // namespace Bench
+} // namespace XEmuRun
@@ -0,0 +1,42 @@
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <QCoreApplication>
+#include "fixtures.h"
+
+int main(int argc, char* argv[]) {
+    // Keep ConfigManager away from the user's real configuration
+    std::string configHome = XEmuRun::Bench::scratchDirectory() + "/config";
+    setenv("XDG_CONFIG_HOME", configHome.c_str(), 1);
+
+    // Registered before any singleton exists so it runs after their destructors
+    std::atexit(XEmuRun::Bench::cleanupScratch);
+
+    // GameLibrary is a QObject and needs an application instance
+    QCoreApplication app(argc, argv);
+
+    // Default to JSON output so results can be archived and diffed between releases
+    std::vector<char*> args(argv, argv + argc);
+    bool hasFormat = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strncmp(argv[i], "--benchmark_format", 18) == 0) {
+            hasFormat = true;
+        }
+    }
+    static char jsonFormat[] = "--benchmark_format=json";
+    if (!hasFormat) {
+        args.push_back(jsonFormat);
+    }
+
+    int benchArgc = static_cast<int>(args.size());
+    benchmark::Initialize(&benchArgc, args.data());
+    if (benchmark::ReportUnrecognizedArguments(benchArgc, args.data())) {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
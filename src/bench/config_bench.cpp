@@ -0,0 +1,66 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include "fixtures.h"
+#include "../config/config.h"
+#include "../config/config_manager.h"
+#include "../package/package.h"
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+namespace Bench {
+
+namespace {
+
+void BM_ConfigLoadFromJson(benchmark::State& state) {
+    Json::Value root = makeConfigJson(static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        Config config;
+        config.loadFromJson(root);
+        benchmark::DoNotOptimize(config);
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_PackageLoadManifest(benchmark::State& state) {
+    std::string directory = (fs::path(scratchDirectory()) / ("manifest_" + std::to_string(state.range(0)))).string();
+    createExtractedPackage(directory, static_cast<int>(state.range(0)));
+
+    for (auto _ : state) {
+        Package package;
+        if (!package.loadExtracted(directory)) {
+            state.SkipWithError("Package::loadExtracted failed");
+            break;
+        }
+        benchmark::DoNotOptimize(package);
+    }
+}
+
+void BM_MergeWithGameConfig(benchmark::State& state) {
+    // The config directory is redirected into the scratch area by bench_main
+    ConfigManager& configManager = ConfigManager::getInstance();
+    if (!configManager.initialize()) {
+        state.SkipWithError("ConfigManager::initialize failed");
+        return;
+    }
+
+    auto gameConfig = std::make_shared<Config>();
+    gameConfig->loadFromJson(makeConfigJson(static_cast<int>(state.range(0))));
+
+    for (auto _ : state) {
+        ConfigView merged = configManager.mergeWithGameConfig(gameConfig, "windows");
+        benchmark::DoNotOptimize(merged.getInt("resolution_width"));
+        benchmark::DoNotOptimize(merged.getString("wine_prefix"));
+    }
+}
+
+} // namespace
+
+BENCHMARK(BM_ConfigLoadFromJson)->Arg(10)->Arg(100)->Arg(1000);
+BENCHMARK(BM_PackageLoadManifest)->Arg(0)->Arg(10)->Arg(1000);
+BENCHMARK(BM_MergeWithGameConfig)->Arg(0)->Arg(10)->Arg(100);
+
+} // namespace Bench
+} // namespace XEmuRun
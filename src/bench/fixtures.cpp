@@ -0,0 +1,99 @@
+#include "fixtures.h"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+#include "../generator/generator.h"
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+namespace Bench {
+
+namespace {
+
+// Fixed seed so every run sees the same inputs
+constexpr std::uint64_t kSeed = 0x5845;
+
+} // namespace
+
+const char* fileShapeName(FileShape shape) {
+    switch (shape) {
+        case FileShape::Tiny: return "tiny";
+        case FileShape::Mixed: return "mixed";
+        case FileShape::Large: return "large";
+    }
+    return "unknown";
+}
+
+std::string scratchDirectory() {
+    static const std::string path =
+        (fs::temp_directory_path() / ("xemurun-bench-" + std::to_string(getpid()))).string();
+    fs::create_directories(path);
+    return path;
+}
+
+void cleanupScratch() {
+    std::error_code ec;
+    fs::remove_all(scratchDirectory(), ec);
+}
+
+std::uint64_t createGameTree(const std::string& directory, FileShape shape) {
+    GameTreeSpec spec;
+    switch (shape) {
+        case FileShape::Tiny:
+            spec.tinyFileCount = 1000;
+            spec.tinyFileSize = 1024;
+            spec.pattern = DataPattern::Text;
+            break;
+        case FileShape::Mixed:
+            spec.tinyFileCount = 100;
+            spec.tinyFileSize = 64 * 1024;
+            spec.pattern = DataPattern::Text;
+            break;
+        case FileShape::Large:
+            spec.blobCount = 4;
+            spec.blobSize = 16 * 1024 * 1024;
+            spec.pattern = DataPattern::Random;
+            break;
+    }
+
+    Generator generator(kSeed);
+    return generator.generateGameTree(spec, directory, "windows");
+}
+
+void createExtractedPackage(const std::string& directory, int configCount) {
+    Generator generator(kSeed);
+    generator.generateGameTree(GameTreeSpec(), directory, "windows");
+
+    Json::Value root;
+    root["name"] = "Benchmark Game";
+    root["platform"] = "windows";
+    root["main"] = Generator::mainExecutableFor("windows");
+    root["version"] = "1.0.0";
+    root["config"] = makeConfigJson(configCount);
+
+    std::ofstream file(fs::path(directory) / "manifest.json");
+    Json::StyledWriter writer;
+    file << writer.write(root);
+}
+
+Json::Value makeConfigJson(int keyCount) {
+    Json::Value config(Json::objectValue);
+    for (int i = 0; i < keyCount; i++) {
+        std::string key = "setting_" + std::to_string(i);
+        switch (i % 3) {
+            case 0: config[key] = "value_" + std::to_string(i); break;
+            case 1: config[key] = i; break;
+            case 2: config[key] = (i % 2 == 0); break;
+        }
+    }
+    return config;
+}
+
+void writeLibraryJson(const std::string& path, int entryCount) {
+    Generator generator(kSeed);
+    generator.generateLibrary(path, static_cast<std::uint64_t>(entryCount), "/games/library");
+}
+
+} // namespace Bench
+} // namespace XEmuRun
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <json/json.h>
+
+namespace XEmuRun {
+namespace Bench {
+
+// File-size distributions used by the archive benchmarks
+enum class FileShape {
+    Tiny,   // 1000 x 1 KiB
+    Mixed,  // 100 x 64 KiB
+    Large   // 4 x 16 MiB
+};
+
+const char* fileShapeName(FileShape shape);
+
+// Scratch directory for the whole run, removed by cleanupScratch()
+std::string scratchDirectory();
+void cleanupScratch();
+
+// Builds a deterministic game tree of the given shape below directory.
+// Returns the total number of payload bytes written.
+std::uint64_t createGameTree(const std::string& directory, FileShape shape);
+
+// Builds an extracted package layout (manifest.json + game/) with
+// configCount extra config keys in the manifest
+void createExtractedPackage(const std::string& directory, int configCount);
+
+// Config object with keyCount mixed string/int/bool values
+Json::Value makeConfigJson(int keyCount);
+
+// Writes a library.json with entryCount GameInfo entries
+void writeLibraryJson(const std::string& path, int entryCount);
+
+} // namespace Bench
+} // namespace XEmuRun
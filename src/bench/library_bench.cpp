@@ -0,0 +1,59 @@
+#include <benchmark/benchmark.h>
+#include <filesystem>
+#include "fixtures.h"
+#include "../gui/game_library.h"
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+namespace Bench {
+
+namespace {
+
+QString libraryFixture(int entryCount) {
+    std::string path = (fs::path(scratchDirectory()) / ("library_" + std::to_string(entryCount) + ".json")).string();
+    if (!fs::exists(path)) {
+        writeLibraryJson(path, entryCount);
+    }
+    return QString::fromStdString(path);
+}
+
+void BM_GameLibraryLoad(benchmark::State& state) {
+    QString path = libraryFixture(static_cast<int>(state.range(0)));
+    GameLibrary library(path);
+
+    for (auto _ : state) {
+        if (!library.loadLibrary()) {
+            state.SkipWithError("GameLibrary::loadLibrary failed");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+void BM_GameLibrarySave(benchmark::State& state) {
+    QString path = libraryFixture(static_cast<int>(state.range(0)));
+    QString output = QString::fromStdString(scratchDirectory()) + "/library_save.json";
+
+    // Save to a copy so the fixture stays intact
+    fs::copy_file(path.toStdString(), output.toStdString(), fs::copy_options::overwrite_existing);
+    GameLibrary target(output);
+
+    for (auto _ : state) {
+        if (!target.saveLibrary()) {
+            state.SkipWithError("GameLibrary::saveLibrary failed");
+            break;
+        }
+    }
+
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+
+} // namespace
+
+BENCHMARK(BM_GameLibraryLoad)->Arg(10)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_GameLibrarySave)->Arg(10)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond);
+
+} // namespace Bench
+} // namespace XEmuRun
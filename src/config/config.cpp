@@ -1,100 +1,458 @@
 #include "config.h"
+#include "../utils/snapshot.h"
 #include <fstream>
+#include <algorithm>
 #include <iostream>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <cerrno>
+#include <limits>
+#include <unistd.h>
 
 namespace XEmuRun {
 
 Config::Config() = default;
 Config::~Config() = default;
 
+template <typename T, size_t N>
+const T* Config::findSlot(const SlotArray<T, N>& slots, size_t slot) {
+    return slots.present.test(slot) ? &slots.values[slot] : nullptr;
+}
+
+template <typename T, size_t N, typename V>
+bool Config::assignSlot(SlotArray<T, N>& slots, size_t slot, const V& value) {
+    if (slots.present.test(slot) && slots.values[slot] == value) {
+        return false;
+    }
+    slots.values[slot] = T(value);
+    slots.present.set(slot);
+    return true;
+}
+
+template <typename T>
+const T* Config::findValue(const ValueMap<T>& values, ConfigKey key) {
+    auto range = values.equal_range(key.hash());
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.key == key.name()) {
+            return &it->second.value;
+        }
+    }
+    return nullptr;
+}
+
+// Only report a change when the stored value actually differs, so that
+// re-applying the same settings does not cause a rewrite
+template <typename T>
+bool Config::assignValue(ValueMap<T>& values, ConfigKey key, const T& value) {
+    auto range = values.equal_range(key.hash());
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second.key == key.name()) {
+            if (it->second.value == value) {
+                return false;
+            }
+            it->second.value = value;
+            return true;
+        }
+    }
+    values.emplace(key.hash(), Entry<T>{std::string(key.name()), value});
+    return true;
+}
+
+namespace {
+
+// Values written by older packagers arrive as strings; accept them for
+// registered keys of other types
+bool coerceInt(const Json::Value& value, int& result) {
+    if (value.isInt()) {
+        result = value.asInt();
+        return true;
+    }
+    if (value.isString()) {
+        const std::string text = value.asString();
+        char* end = nullptr;
+        errno = 0;
+        long parsed = std::strtol(text.c_str(), &end, 10);
+        if (!text.empty() && *end == '\0' && errno == 0 &&
+            parsed >= std::numeric_limits<int>::min() && parsed <= std::numeric_limits<int>::max()) {
+            result = static_cast<int>(parsed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool coerceBool(const Json::Value& value, bool& result) {
+    if (value.isBool()) {
+        result = value.asBool();
+        return true;
+    }
+    if (value.isString()) {
+        const std::string text = value.asString();
+        if (text == "true" || text == "1") {
+            result = true;
+            return true;
+        }
+        if (text == "false" || text == "0") {
+            result = false;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
 void Config::loadFromJson(const Json::Value& root) {
-    // Process string values
     for (auto it = root.begin(); it != root.end(); ++it) {
         const std::string& key = it.key().asString();
         const Json::Value& value = *it;
         
+        // Registered keys go to their typed slot when the value fits
+        int intValue;
+        bool boolValue;
+        if (const IntKey* typed = Keys::findIntKey(key); typed && coerceInt(value, intValue)) {
+            assignSlot(m_intSlots, typed->slot, intValue);
+            continue;
+        }
+        if (const BoolKey* typed = Keys::findBoolKey(key); typed && coerceBool(value, boolValue)) {
+            assignSlot(m_boolSlots, typed->slot, boolValue);
+            continue;
+        }
+        if (const StringKey* typed = Keys::findStringKey(key); typed && value.isString()) {
+            assignSlot(m_stringSlots, typed->slot, value.asString());
+            continue;
+        }
+        
         if (value.isString()) {
-            m_stringValues[key] = value.asString();
+            assignValue(m_stringValues, key, value.asString());
         } else if (value.isInt()) {
-            m_intValues[key] = value.asInt();
+            assignValue(m_intValues, key, value.asInt());
         } else if (value.isBool()) {
-            m_boolValues[key] = value.asBool();
+            assignValue(m_boolValues, key, value.asBool());
         }
     }
 }
 
-void Config::loadFromFile(const std::string& path) {
+bool Config::loadFromFile(const std::string& path) {
+    // Stat before reading, so an edit racing with us leaves the snapshot
+    // stale rather than wrong
+    SnapshotSource source;
+    bool haveSource = statSnapshotSource(path, source);
+    
+    SnapshotReader snapshot;
+    if (haveSource && snapshot.open(path, SnapshotKind::Config, source)) {
+        loadFromSnapshot(snapshot);
+        return true;
+    }
+    
     std::ifstream file(path);
     if (!file.is_open()) {
         std::cerr << "Failed to open config file: " << path << std::endl;
-        return;
+        return false;
     }
     
     Json::Value root;
     Json::Reader reader;
     
-    if (!reader.parse(file, root)) {
+    if (!reader.parse(file, root) || !root.isObject()) {
         std::cerr << "Failed to parse config JSON from file: " << path << std::endl;
-        return;
+        return false;
     }
     
     loadFromJson(root);
+    
+    if (haveSource) {
+        SnapshotWriter writer(SnapshotKind::Config);
+        writeSnapshot(writer);
+        writer.commitAsync(path, source);
+    }
+    return true;
+}
+
+void Config::loadFromSnapshot(SnapshotReader& snapshot) {
+    SnapshotEntry entry;
+    while (snapshot.next(entry)) {
+        ConfigKey key(entry.key);
+        switch (entry.type) {
+            case SnapshotValueType::String:
+                if (const StringKey* typed = Keys::findStringKey(key)) {
+                    assignSlot(m_stringSlots, typed->slot, entry.stringValue);
+                } else {
+                    assignValue(m_stringValues, key, std::string(entry.stringValue));
+                }
+                break;
+            case SnapshotValueType::Int:
+                if (const IntKey* typed = Keys::findIntKey(key)) {
+                    assignSlot(m_intSlots, typed->slot, static_cast<int>(entry.intValue));
+                } else {
+                    assignValue(m_intValues, key, static_cast<int>(entry.intValue));
+                }
+                break;
+            case SnapshotValueType::Bool:
+                if (const BoolKey* typed = Keys::findBoolKey(key)) {
+                    assignSlot(m_boolSlots, typed->slot, entry.boolValue);
+                } else {
+                    assignValue(m_boolValues, key, entry.boolValue);
+                }
+                break;
+            case SnapshotValueType::Record:
+                return;
+        }
+    }
+}
+
+void Config::writeSnapshot(SnapshotWriter& snapshot) const {
+    for (const StringKey* key : Keys::kStringKeys) {
+        if (const std::string* value = find(*key)) {
+            snapshot.addString(key->key.name(), *value);
+        }
+    }
+    for (const IntKey* key : Keys::kIntKeys) {
+        if (const int* value = find(*key)) {
+            snapshot.addInt(key->key.name(), *value);
+        }
+    }
+    for (const BoolKey* key : Keys::kBoolKeys) {
+        if (const bool* value = find(*key)) {
+            snapshot.addBool(key->key.name(), *value);
+        }
+    }
+    for (const auto& [hash, entry] : m_stringValues) {
+        snapshot.addString(entry.key, entry.value);
+    }
+    for (const auto& [hash, entry] : m_intValues) {
+        snapshot.addInt(entry.key, entry.value);
+    }
+    for (const auto& [hash, entry] : m_boolValues) {
+        snapshot.addBool(entry.key, entry.value);
+    }
+}
+
+std::vector<std::string> Config::diff(const Config& other) const {
+    std::vector<std::string> changed;
+    
+    auto diffSlots = [&changed](const auto& keys, const auto& mine, const auto& theirs) {
+        for (const auto* key : keys) {
+            const auto* a = findSlot(mine, key->slot);
+            const auto* b = findSlot(theirs, key->slot);
+            if ((a == nullptr) != (b == nullptr) || (a && *a != *b)) {
+                changed.emplace_back(key->key.name());
+            }
+        }
+    };
+    diffSlots(Keys::kStringKeys, m_stringSlots, other.m_stringSlots);
+    diffSlots(Keys::kIntKeys, m_intSlots, other.m_intSlots);
+    diffSlots(Keys::kBoolKeys, m_boolSlots, other.m_boolSlots);
+    
+    auto diffValues = [&changed](const auto& mine, const auto& theirs) {
+        for (const auto& [hash, entry] : mine) {
+            const auto* value = findValue(theirs, ConfigKey(entry.key));
+            if (!value || *value != entry.value) {
+                changed.push_back(entry.key);
+            }
+        }
+        for (const auto& [hash, entry] : theirs) {
+            if (!findValue(mine, ConfigKey(entry.key))) {
+                changed.push_back(entry.key);
+            }
+        }
+    };
+    diffValues(m_stringValues, other.m_stringValues);
+    diffValues(m_intValues, other.m_intValues);
+    diffValues(m_boolValues, other.m_boolValues);
+    
+    // A key stored under a different type shows up once per type
+    std::sort(changed.begin(), changed.end());
+    changed.erase(std::unique(changed.begin(), changed.end()), changed.end());
+    return changed;
+}
+
+bool Config::empty() const {
+    return m_stringSlots.present.none() && m_intSlots.present.none() && m_boolSlots.present.none() &&
+           m_stringValues.empty() && m_intValues.empty() && m_boolValues.empty();
+}
+
+const std::string* Config::find(const StringKey& key) const {
+    return findSlot(m_stringSlots, key.slot);
+}
+
+const int* Config::find(const IntKey& key) const {
+    return findSlot(m_intSlots, key.slot);
+}
+
+const bool* Config::find(const BoolKey& key) const {
+    return findSlot(m_boolSlots, key.slot);
+}
+
+std::string_view Config::get(const StringKey& key) const {
+    const std::string* value = find(key);
+    return value ? std::string_view(*value) : key.defaultValue;
+}
+
+int Config::get(const IntKey& key) const {
+    const int* value = find(key);
+    return value ? *value : key.defaultValue;
+}
+
+bool Config::get(const BoolKey& key) const {
+    const bool* value = find(key);
+    return value ? *value : key.defaultValue;
+}
+
+void Config::set(const StringKey& key, std::string_view value) {
+    if (assignSlot(m_stringSlots, key.slot, value)) {
+        m_dirty = true;
+    }
+}
+
+void Config::set(const IntKey& key, int value) {
+    if (assignSlot(m_intSlots, key.slot, value)) {
+        m_dirty = true;
+    }
+}
+
+void Config::set(const BoolKey& key, bool value) {
+    if (assignSlot(m_boolSlots, key.slot, value)) {
+        m_dirty = true;
+    }
 }
 
-std::string Config::getString(const std::string& key, const std::string& defaultValue) const {
-    auto it = m_stringValues.find(key);
-    return (it != m_stringValues.end()) ? it->second : defaultValue;
+std::string Config::getString(ConfigKey key, const std::string& defaultValue) const {
+    const std::string* value = findString(key);
+    return value ? *value : defaultValue;
 }
 
-int Config::getInt(const std::string& key, int defaultValue) const {
-    auto it = m_intValues.find(key);
-    return (it != m_intValues.end()) ? it->second : defaultValue;
+int Config::getInt(ConfigKey key, int defaultValue) const {
+    const int* value = findInt(key);
+    return value ? *value : defaultValue;
 }
 
-bool Config::getBool(const std::string& key, bool defaultValue) const {
-    auto it = m_boolValues.find(key);
-    return (it != m_boolValues.end()) ? it->second : defaultValue;
+bool Config::getBool(ConfigKey key, bool defaultValue) const {
+    const bool* value = findBool(key);
+    return value ? *value : defaultValue;
 }
 
-void Config::setString(const std::string& key, const std::string& value) {
-    m_stringValues[key] = value;
+const std::string* Config::findString(ConfigKey key) const {
+    if (const StringKey* typed = Keys::findStringKey(key)) {
+        return find(*typed);
+    }
+    return findValue(m_stringValues, key);
+}
+
+const int* Config::findInt(ConfigKey key) const {
+    if (const IntKey* typed = Keys::findIntKey(key)) {
+        return find(*typed);
+    }
+    return findValue(m_intValues, key);
+}
+
+const bool* Config::findBool(ConfigKey key) const {
+    if (const BoolKey* typed = Keys::findBoolKey(key)) {
+        return find(*typed);
+    }
+    return findValue(m_boolValues, key);
 }
 
-void Config::setInt(const std::string& key, int value) {
-    m_intValues[key] = value;
+void Config::setString(ConfigKey key, const std::string& value) {
+    if (const StringKey* typed = Keys::findStringKey(key)) {
+        set(*typed, value);
+    } else if (assignValue(m_stringValues, key, value)) {
+        m_dirty = true;
+    }
 }
 
-void Config::setBool(const std::string& key, bool value) {
-    m_boolValues[key] = value;
+void Config::setInt(ConfigKey key, int value) {
+    if (const IntKey* typed = Keys::findIntKey(key)) {
+        set(*typed, value);
+    } else if (assignValue(m_intValues, key, value)) {
+        m_dirty = true;
+    }
 }
 
-void Config::save(const std::string& path) {
+void Config::setBool(ConfigKey key, bool value) {
+    if (const BoolKey* typed = Keys::findBoolKey(key)) {
+        set(*typed, value);
+    } else if (assignValue(m_boolValues, key, value)) {
+        m_dirty = true;
+    }
+}
+
+bool Config::save(const std::string& path) {
     Json::Value root;
     
+    // Add registered values
+    for (const StringKey* key : Keys::kStringKeys) {
+        if (const std::string* value = find(*key)) {
+            root[std::string(key->key.name())] = *value;
+        }
+    }
+    for (const IntKey* key : Keys::kIntKeys) {
+        if (const int* value = find(*key)) {
+            root[std::string(key->key.name())] = *value;
+        }
+    }
+    for (const BoolKey* key : Keys::kBoolKeys) {
+        if (const bool* value = find(*key)) {
+            root[std::string(key->key.name())] = *value;
+        }
+    }
+    
     // Add string values
-    for (const auto& [key, value] : m_stringValues) {
-        root[key] = value;
+    for (const auto& [hash, entry] : m_stringValues) {
+        root[entry.key] = entry.value;
     }
     
     // Add int values
-    for (const auto& [key, value] : m_intValues) {
-        root[key] = value;
+    for (const auto& [hash, entry] : m_intValues) {
+        root[entry.key] = entry.value;
     }
     
     // Add bool values
-    for (const auto& [key, value] : m_boolValues) {
-        root[key] = value;
+    for (const auto& [hash, entry] : m_boolValues) {
+        root[entry.key] = entry.value;
     }
     
-    // Write to file
-    std::ofstream file(path);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open file for writing: " << path << std::endl;
-        return;
+    // Write to a sibling temp file and rename over the target, so readers
+    // never observe a partially written config
+    std::string tempPath = path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open file for writing: " << tempPath << std::endl;
+            return false;
+        }
+        
+        Json::StyledWriter writer;
+        file << writer.write(root);
+        file.flush();
+        if (!file) {
+            std::cerr << "Failed to write config file: " << tempPath << std::endl;
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+    
+    try {
+        std::filesystem::rename(tempPath, path);
+    } catch (const std::filesystem::filesystem_error& e) {
+        std::cerr << "Failed to replace config file " << path << ": " << e.what() << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    
+    // We know exactly what was written, so refresh the snapshot without
+    // waiting for the next load to parse it
+    SnapshotSource source;
+    if (statSnapshotSource(path, source)) {
+        SnapshotWriter writer(SnapshotKind::Config);
+        writeSnapshot(writer);
+        writer.commitAsync(path, source);
     }
     
-    Json::StyledWriter writer;
-    file << writer.write(root);
+    m_dirty = false;
+    return true;
 }
 
 } // namespace XEmuRun
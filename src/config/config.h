@@ -1,12 +1,21 @@
 #pragma once
 
 #include <string>
-#include <map>
+#include <array>
+#include <bitset>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include <json/json.h>
+#include "config_key.h"
+#include "config_keys.h"
 
 namespace XEmuRun {
 
 class ConfigManager; // Forward declaration
+class SnapshotReader;
+class SnapshotWriter;
 
 class Config {
 public:
@@ -14,25 +23,105 @@ public:
     ~Config();
     
     void loadFromJson(const Json::Value& root);
-    void loadFromFile(const std::string& path);
     
-    std::string getString(const std::string& key, const std::string& defaultValue = "") const;
-    int getInt(const std::string& key, int defaultValue = 0) const;
-    bool getBool(const std::string& key, bool defaultValue = false) const;
+    // Uses the binary snapshot next to the file when it matches the file's
+    // mtime and size; otherwise parses the JSON and refreshes the snapshot
+    // in the background
+    bool loadFromFile(const std::string& path);
     
-    void setString(const std::string& key, const std::string& value);
-    void setInt(const std::string& key, int value);
-    void setBool(const std::string& key, bool value);
+    // Reads entries up to the end of the snapshot or the next record
+    void loadFromSnapshot(SnapshotReader& snapshot);
+    void writeSnapshot(SnapshotWriter& snapshot) const;
     
-    void save(const std::string& path);
+    // Names of keys whose value or type differs between the two configs
+    std::vector<std::string> diff(const Config& other) const;
+    
+    // Registered keys read and write a flat slot array; get() falls back to
+    // the key's built-in default
+    const std::string* find(const StringKey& key) const;
+    const int* find(const IntKey& key) const;
+    const bool* find(const BoolKey& key) const;
+    
+    std::string_view get(const StringKey& key) const;
+    int get(const IntKey& key) const;
+    bool get(const BoolKey& key) const;
+    
+    void set(const StringKey& key, std::string_view value);
+    void set(const IntKey& key, int value);
+    void set(const BoolKey& key, bool value);
+    
+    template <typename T>
+    void setDefault(const TypedKey<T>& key) { set(key, key.defaultValue); }
+    
+    // Lookups by name, for keys built at runtime (e.g. controller mappings).
+    // Registered names resolve to the same slots as the typed accessors.
+    std::string getString(ConfigKey key, const std::string& defaultValue = "") const;
+    int getInt(ConfigKey key, int defaultValue = 0) const;
+    bool getBool(ConfigKey key, bool defaultValue = false) const;
+    
+    // Return the stored value, or nullptr if the key has no value of that type
+    const std::string* findString(ConfigKey key) const;
+    const int* findInt(ConfigKey key) const;
+    const bool* findBool(ConfigKey key) const;
+    
+    void setString(ConfigKey key, const std::string& value);
+    void setInt(ConfigKey key, int value);
+    void setBool(ConfigKey key, bool value);
+    
+    // Writes atomically (temp file + rename) and clears the dirty flag
+    bool save(const std::string& path);
+    
+    // True if no key has a value
+    bool empty() const;
+    
+    // True if a setter changed a value since the last load or save
+    bool isDirty() const { return m_dirty; }
+    void markDirty() { m_dirty = true; }
     
 private:
-    std::map<std::string, std::string> m_stringValues;
-    std::map<std::string, int> m_intValues;
-    std::map<std::string, bool> m_boolValues;
+    // Values of registered keys, indexed by TypedKey::slot
+    template <typename T, size_t N>
+    struct SlotArray {
+        std::array<T, N> values{};
+        std::bitset<N> present;
+    };
+    
+    template <typename T, size_t N>
+    static const T* findSlot(const SlotArray<T, N>& slots, size_t slot);
+    template <typename T, size_t N, typename V>
+    static bool assignSlot(SlotArray<T, N>& slots, size_t slot, const V& value);
+    
+    // Values of unregistered keys are bucketed by key hash; the name is kept
+    // to rule out collisions
+    template <typename T>
+    struct Entry {
+        std::string key;
+        T value;
+    };
+    
+    template <typename T>
+    using ValueMap = std::unordered_multimap<ConfigKey::Hash, Entry<T>>;
+    
+    template <typename T>
+    static const T* findValue(const ValueMap<T>& values, ConfigKey key);
+    template <typename T>
+    static bool assignValue(ValueMap<T>& values, ConfigKey key, const T& value);
+    
+    SlotArray<std::string, Keys::kStringKeyCount> m_stringSlots;
+    SlotArray<int, Keys::kIntKeyCount> m_intSlots;
+    SlotArray<bool, Keys::kBoolKeyCount> m_boolSlots;
+    
+    ValueMap<std::string> m_stringValues;
+    ValueMap<int> m_intValues;
+    ValueMap<bool> m_boolValues;
+    bool m_dirty = false;
     
     // Grant ConfigManager access to private members for merging configs
     friend class ConfigManager;
 };
 
+// Immutable, reference-counted view of a configuration. A snapshot stays
+// valid for as long as it is held, even after newer versions are published.
+using ConfigSnapshot = std::shared_ptr<const Config>;
+
 } // namespace XEmuRun
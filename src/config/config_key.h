@@ -0,0 +1,42 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+namespace XEmuRun {
+
+/**
+ * @class ConfigKey
+ * @brief Configuration key name paired with its precomputed hash.
+ *
+ * Keys built from literals are hashed at compile time; Config stores values
+ * by hash so a lookup is a single bucket probe plus a name check.
+ */
+class ConfigKey {
+public:
+    using Hash = std::uint64_t;
+
+    constexpr ConfigKey(const char* name) : ConfigKey(std::string_view(name)) {}
+    constexpr ConfigKey(std::string_view name) : m_name(name), m_hash(hashOf(name)) {}
+    ConfigKey(const std::string& name) : ConfigKey(std::string_view(name)) {}
+
+    constexpr std::string_view name() const { return m_name; }
+    constexpr Hash hash() const { return m_hash; }
+
+    // 64-bit FNV-1a
+    static constexpr Hash hashOf(std::string_view name) {
+        Hash hash = 0xcbf29ce484222325ULL;
+        for (char c : name) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+private:
+    std::string_view m_name;
+    Hash m_hash;
+};
+
+} // namespace XEmuRun
@@ -0,0 +1,44 @@
+#include "config_keys.h"
+#include <unordered_map>
+
+namespace XEmuRun {
+namespace Keys {
+
+namespace {
+
+template <typename T, typename Array>
+const TypedKey<T>* findKey(const Array& keys, ConfigKey key) {
+    // Built once from the registry; hashes are unique across it in practice,
+    // and the name check below covers the rest. Never freed, so the config
+    // watcher thread can still parse files while statics are torn down.
+    static const auto* index = [&keys] {
+        auto* byHash = new std::unordered_map<ConfigKey::Hash, const TypedKey<T>*>();
+        for (const TypedKey<T>* typed : keys) {
+            byHash->emplace(typed->key.hash(), typed);
+        }
+        return byHash;
+    }();
+
+    auto it = index->find(key.hash());
+    if (it == index->end() || it->second->key.name() != key.name()) {
+        return nullptr;
+    }
+    return it->second;
+}
+
+} // namespace
+
+const StringKey* findStringKey(ConfigKey key) {
+    return findKey<std::string_view>(kStringKeys, key);
+}
+
+const IntKey* findIntKey(ConfigKey key) {
+    return findKey<int>(kIntKeys, key);
+}
+
+const BoolKey* findBoolKey(ConfigKey key) {
+    return findKey<bool>(kBoolKeys, key);
+}
+
+} // namespace Keys
+} // namespace XEmuRun
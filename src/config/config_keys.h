@@ -0,0 +1,116 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+#include <cstddef>
+#include "config_key.h"
+
+namespace XEmuRun {
+
+/**
+ * A registered configuration key: its name and hash, the index of its slot
+ * in Config's flat array for type T, and the value used when no
+ * configuration layer sets it.
+ */
+template <typename T>
+struct TypedKey {
+    ConfigKey key;
+    size_t slot;
+    T defaultValue;
+};
+
+using StringKey = TypedKey<std::string_view>;
+using IntKey = TypedKey<int>;
+using BoolKey = TypedKey<bool>;
+
+namespace Keys {
+
+// String keys
+inline constexpr StringKey GameDirectory{"game_directory", 0, ""};
+inline constexpr StringKey TempDirectory{"temp_directory", 1, ""};
+inline constexpr StringKey DefaultOutputDirectory{"default_output_directory", 2, ""};
+inline constexpr StringKey WinePrefix{"wine_prefix", 3, ""};
+inline constexpr StringKey WineVersion{"wine_version", 4, ""};
+inline constexpr StringKey BiosPath{"bios_path", 5, ""};
+inline constexpr StringKey Ps4BiosPath{"ps4_bios_path", 6, ""};
+inline constexpr StringKey Ps5BiosPath{"ps5_bios_path", 7, ""};
+inline constexpr StringKey SystemFilesPath{"system_files_path", 8, ""};
+inline constexpr StringKey XboxBiosPath{"xbox_bios_path", 9, ""};
+inline constexpr StringKey HddPath{"hdd_path", 10, ""};
+inline constexpr StringKey SaveDirectory{"save_directory", 11, ""};
+inline constexpr StringKey RamExtractionPath{"ram_extraction_path", 12, "/dev/shm/XEmuRun"}; // empty disables the RAM tier
+inline constexpr StringKey WineDllOverrides{"wine_dll_overrides", 13, ""}; // WINEDLLOVERRIDES syntax, e.g. "d3dx9_43=n,b;xinput1_3=n"
+
+// Integer keys
+inline constexpr IntKey ResolutionWidth{"resolution_width", 0, 1920};
+inline constexpr IntKey ResolutionHeight{"resolution_height", 1, 1080};
+inline constexpr IntKey LoggingLevel{"logging_level", 2, 1}; // 0=none, 1=errors, 2=warnings, 3=info, 4=debug
+inline constexpr IntKey WindowsVersion{"windows_version", 3, 10}; // Target Windows version (7, 8, 10)
+inline constexpr IntKey RenderingResolution{"rendering_resolution", 4, 1080};
+inline constexpr IntKey RenderingScale{"rendering_scale", 5, 100}; // percentage
+inline constexpr IntKey CpuThreads{"cpu_threads", 6, 8};
+inline constexpr IntKey PrewarmDiskBudgetMb{"prewarm_disk_budget_mb", 7, 4096}; // space pre-extracted games may use
+inline constexpr IntKey PrewarmMaxTitles{"prewarm_max_titles", 8, 3};
+inline constexpr IntKey RamExtractionBudgetMb{"ram_extraction_budget_mb", 9, 0}; // 0 disables the RAM tier
+inline constexpr IntKey DisklessLaunchMaxMb{"diskless_launch_max_mb", 10, 16}; // 0 always extracts native titles
+inline constexpr IntKey WineDpi{"wine_dpi", 11, 0}; // 0 keeps the prefix's setting
+
+// Boolean keys
+inline constexpr BoolKey Fullscreen{"fullscreen", 0, true};
+inline constexpr BoolKey Vsync{"vsync", 1, true};
+inline constexpr BoolKey CleanupTempFiles{"cleanup_temp_files", 2, true};
+inline constexpr BoolKey EnableDxvk{"enable_dxvk", 3, true};
+inline constexpr BoolKey EnableHwAcceleration{"enable_hw_acceleration", 4, true};
+inline constexpr BoolKey EnableGpuAcceleration{"enable_gpu_acceleration", 5, true};
+inline constexpr BoolKey EnableRayTracing{"enable_ray_tracing", 6, false};
+inline constexpr BoolKey HddEnabled{"hdd_enabled", 7, true};
+inline constexpr BoolKey GpuHardwareAcceleration{"gpu_hardware_acceleration", 8, true};
+inline constexpr BoolKey ExperimentalMode{"experimental_mode", 9, false};
+inline constexpr BoolKey Raytracing{"raytracing", 10, false};
+inline constexpr BoolKey PrewarmEnabled{"prewarm_enabled", 11, true}; // pre-extract likely games when idle
+inline constexpr BoolKey CasefoldExtraction{"casefold_extraction", 12, true}; // case-insensitive directories for Windows titles
+inline constexpr BoolKey StreamDiscImages{"stream_disc_images", 13, true}; // serve Xbox disc images from the package
+
+// Every key of each type, in slot order
+inline constexpr std::array kStringKeys{
+    &GameDirectory, &TempDirectory, &DefaultOutputDirectory, &WinePrefix, &WineVersion, &BiosPath,
+    &Ps4BiosPath, &Ps5BiosPath, &SystemFilesPath, &XboxBiosPath, &HddPath, &SaveDirectory,
+    &RamExtractionPath, &WineDllOverrides,
+};
+inline constexpr std::array kIntKeys{
+    &ResolutionWidth, &ResolutionHeight, &LoggingLevel, &WindowsVersion, &RenderingResolution,
+    &RenderingScale, &CpuThreads, &PrewarmDiskBudgetMb, &PrewarmMaxTitles,
+    &RamExtractionBudgetMb, &DisklessLaunchMaxMb, &WineDpi,
+};
+inline constexpr std::array kBoolKeys{
+    &Fullscreen, &Vsync, &CleanupTempFiles, &EnableDxvk, &EnableHwAcceleration, &EnableGpuAcceleration,
+    &EnableRayTracing, &HddEnabled, &GpuHardwareAcceleration, &ExperimentalMode, &Raytracing,
+    &PrewarmEnabled, &CasefoldExtraction, &StreamDiscImages,
+};
+
+inline constexpr size_t kStringKeyCount = kStringKeys.size();
+inline constexpr size_t kIntKeyCount = kIntKeys.size();
+inline constexpr size_t kBoolKeyCount = kBoolKeys.size();
+
+template <typename Array>
+constexpr bool slotsMatchOrder(const Array& keys) {
+    for (size_t i = 0; i < keys.size(); ++i) {
+        if (keys[i]->slot != i) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static_assert(slotsMatchOrder(kStringKeys), "string key slots must match their registry order");
+static_assert(slotsMatchOrder(kIntKeys), "integer key slots must match their registry order");
+static_assert(slotsMatchOrder(kBoolKeys), "boolean key slots must match their registry order");
+
+// Look up a registered key by name; nullptr for keys outside the registry
+const StringKey* findStringKey(ConfigKey key);
+const IntKey* findIntKey(ConfigKey key);
+const BoolKey* findBoolKey(ConfigKey key);
+
+} // namespace Keys
+
+} // namespace XEmuRun
@@ -1,6 +1,13 @@
 #include "config_manager.h"
+#include "../utils/trace.h"
 #include <iostream>
 #include <filesystem>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
 
 namespace fs = std::filesystem;
 
@@ -11,106 +18,323 @@ ConfigManager& ConfigManager::getInstance() {
     return instance;
 }
 
-ConfigManager::ConfigManager() : m_initialized(false) {
+ConfigManager::ConfigManager()
+    : m_initialized(false), m_nextListenerId(1), m_generation(0),
+      m_inotifyFd(-1), m_wakeFd(-1), m_systemWatch(-1), m_emulatorsWatch(-1) {
+    // Lookups for these never insert, so readers can share the map
+    for (const char* platform : {"windows", "linux", "playstation4", "playstation5", "xbox", "xbox_series"}) {
+        Config defaults;
+        createDefaultEmulatorConfig(defaults, platform);
+        m_knownEmulatorSlots[platform].defaults = std::make_shared<const Config>(std::move(defaults));
+    }
+    
+    // Readers before initialize() see an empty system configuration
+    m_systemSlot.config = std::make_shared<const Config>();
 }
 
 ConfigManager::~ConfigManager() {
-    // Save any unsaved changes
+    stopWatching();
+    
+    // Write back only what changed during this run
     if (m_initialized) {
         saveSystemConfig();
         
-        for (const auto& [platform, _] : m_emulatorConfigs) {
+        for (const auto& [platform, slot] : m_knownEmulatorSlots) {
+            if (std::atomic_load(&slot.config)) {
+                saveEmulatorConfig(platform);
+            }
+        }
+        for (const auto& [platform, _] : m_otherEmulatorSlots) {
             saveEmulatorConfig(platform);
         }
     }
 }
 
 bool ConfigManager::initialize() {
-    if (m_initialized) {
+    if (m_initialized.load(std::memory_order_acquire)) {
         return true;
     }
     
-    // Ensure config directory exists
-    if (!ensureConfigDirectoryExists()) {
-        std::cerr << "Failed to create configuration directory" << std::endl;
-        return false;
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    if (m_initialized.load(std::memory_order_relaxed)) {
+        return true;
     }
     
-    // Load system configuration
+    XEMURUN_TRACE_SCOPE("config", "ConfigManager::initialize");
+    
+    // Load system configuration. Emulator configurations are loaded on
+    // first use by getEmulatorConfig.
+    Config systemConfig;
     std::string systemConfigPath = getSystemConfigPath();
     if (fs::exists(systemConfigPath)) {
-        if (!loadConfig(m_systemConfig, systemConfigPath)) {
-            std::cerr << "Failed to load system configuration" << std::endl;
-            return false;
+        if (!loadConfig(systemConfig, systemConfigPath)) {
+            // Run on defaults but leave the broken file for the user to fix
+            std::cerr << "Failed to load system configuration, using defaults" << std::endl;
+            systemConfig = Config();
+            createDefaultSystemConfig(systemConfig);
+            systemConfig.m_dirty = false;
         }
     } else {
-        // Create default system configuration
-        createDefaultSystemConfig();
-        saveSystemConfig();
+        // Defaults stay in memory and are written out on exit
+        createDefaultSystemConfig(systemConfig);
     }
     
-    // Load emulator configurations for known platforms
-    std::vector<std::string> platforms = {
-        "windows", "linux", "playstation4", "playstation5", "xbox", "xbox_series"
-    };
+    std::atomic_store(&m_systemSlot.config, std::make_shared<const Config>(std::move(systemConfig)));
+    m_initialized.store(true, std::memory_order_release);
+    return true;
+}
+
+ConfigSnapshot ConfigManager::getSystemConfig() const {
+    return std::atomic_load(&m_systemSlot.config);
+}
+
+ConfigSnapshot ConfigManager::getEmulatorConfig(const std::string& platform) {
+    // Fast path: a known platform that is already loaded
+    auto it = m_knownEmulatorSlots.find(platform);
+    if (it != m_knownEmulatorSlots.end()) {
+        ConfigSnapshot config = std::atomic_load(&it->second.config);
+        if (config) {
+            return config;
+        }
+    }
     
-    for (const auto& platform : platforms) {
-        std::string emulatorConfigPath = getEmulatorConfigPath(platform);
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    return loadEmulatorSlot(platform, emulatorSlot(platform));
+}
+
+bool ConfigManager::updateSystemConfig(const std::function<void(Config&)>& mutator) {
+    std::vector<std::string> changedKeys;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
         
-        if (fs::exists(emulatorConfigPath)) {
-            Config config;
-            if (loadConfig(config, emulatorConfigPath)) {
-                m_emulatorConfigs[platform] = config;
-            } else {
-                std::cerr << "Failed to load " << platform << " emulator configuration" << std::endl;
-            }
-        } else {
-            // Create default emulator configuration
-            createDefaultEmulatorConfig(platform);
-            m_emulatorConfigs[platform] = Config();
-            saveEmulatorConfig(platform);
+        ConfigSnapshot current = std::atomic_load(&m_systemSlot.config);
+        Config updated = *current;
+        updated.m_dirty = false;
+        mutator(updated);
+        if (!updated.m_dirty) {
+            return false;
         }
+        
+        changedKeys = current->diff(updated);
+        std::atomic_store(&m_systemSlot.config, std::make_shared<const Config>(std::move(updated)));
+        m_generation.fetch_add(1, std::memory_order_release);
     }
     
-    m_initialized = true;
+    notifyListeners("", changedKeys);
     return true;
 }
 
-Config& ConfigManager::getSystemConfig() {
-    return m_systemConfig;
+bool ConfigManager::updateEmulatorConfig(const std::string& platform, const std::function<void(Config&)>& mutator) {
+    std::vector<std::string> changedKeys;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        
+        Slot& slot = emulatorSlot(platform);
+        ConfigSnapshot current = loadEmulatorSlot(platform, slot);
+        Config updated = *current;
+        updated.m_dirty = false;
+        mutator(updated);
+        if (!updated.m_dirty) {
+            return false;
+        }
+        
+        changedKeys = current->diff(updated);
+        std::atomic_store(&slot.config, std::make_shared<const Config>(std::move(updated)));
+        m_generation.fetch_add(1, std::memory_order_release);
+    }
+    
+    notifyListeners(platform, changedKeys);
+    return true;
+}
+
+int ConfigManager::addChangeListener(ChangeListener listener) {
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    int id = m_nextListenerId++;
+    m_listeners.emplace(id, std::move(listener));
+    return id;
+}
+
+void ConfigManager::removeChangeListener(int id) {
+    // Waits for a notification in progress, so the listener's captures may
+    // be destroyed once this returns
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    m_listeners.erase(id);
+}
+
+std::uint64_t ConfigManager::getGeneration() const {
+    return m_generation.load(std::memory_order_acquire);
 }
 
-Config& ConfigManager::getEmulatorConfig(const std::string& platform) {
-    // Create configuration if it doesn't exist
-    if (m_emulatorConfigs.find(platform) == m_emulatorConfigs.end()) {
-        createDefaultEmulatorConfig(platform);
-        saveEmulatorConfig(platform);
+void ConfigManager::notifyListeners(const std::string& platform, const std::vector<std::string>& changedKeys) {
+    if (changedKeys.empty()) {
+        return;
     }
     
-    return m_emulatorConfigs[platform];
+    std::lock_guard<std::mutex> lock(m_listenerMutex);
+    for (const auto& [id, listener] : m_listeners) {
+        listener(platform, changedKeys);
+    }
 }
 
-Config ConfigManager::mergeWithGameConfig(const Config& gameConfig, const std::string& platform) {
-    // Start with the emulator's configuration
-    Config mergedConfig = getEmulatorConfig(platform);
+bool ConfigManager::startWatching() {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    if (m_watchThread.joinable()) {
+        return true;
+    }
     
-    // Override with game-specific settings
-    // String values
-    for (auto it = gameConfig.m_stringValues.begin(); it != gameConfig.m_stringValues.end(); ++it) {
-        mergedConfig.setString(it->first, it->second);
+    if (!ensureConfigDirectoryExists()) {
+        return false;
     }
     
-    // Integer values
-    for (auto it = gameConfig.m_intValues.begin(); it != gameConfig.m_intValues.end(); ++it) {
-        mergedConfig.setInt(it->first, it->second);
+    m_inotifyFd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+    m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_inotifyFd < 0 || m_wakeFd < 0) {
+        std::cerr << "Failed to set up config watcher: " << std::strerror(errno) << std::endl;
+        if (m_inotifyFd >= 0) close(m_inotifyFd);
+        if (m_wakeFd >= 0) close(m_wakeFd);
+        m_inotifyFd = m_wakeFd = -1;
+        return false;
+    }
+    
+    // Config::save and most editors replace files by rename, so watch
+    // directories for both completed writes and files moved into place
+    const uint32_t mask = IN_CLOSE_WRITE | IN_MOVED_TO;
+    m_systemWatch = inotify_add_watch(m_inotifyFd, getConfigDirectory().c_str(), mask);
+    m_emulatorsWatch = inotify_add_watch(m_inotifyFd, (getConfigDirectory() + "/emulators").c_str(), mask);
+    if (m_systemWatch < 0 || m_emulatorsWatch < 0) {
+        std::cerr << "Failed to watch configuration directory: " << std::strerror(errno) << std::endl;
+        close(m_inotifyFd);
+        close(m_wakeFd);
+        m_inotifyFd = m_wakeFd = -1;
+        return false;
+    }
+    
+    m_watchThread = std::thread(&ConfigManager::watchLoop, this);
+    return true;
+}
+
+void ConfigManager::stopWatching() {
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        if (!m_watchThread.joinable()) {
+            return;
+        }
+        uint64_t one = 1;
+        ssize_t ignored = write(m_wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+    
+    m_watchThread.join();
+    close(m_inotifyFd);
+    close(m_wakeFd);
+    m_inotifyFd = m_wakeFd = -1;
+}
+
+void ConfigManager::watchLoop() {
+    alignas(inotify_event) char buffer[4096];
+    
+    while (true) {
+        pollfd fds[2] = {
+            {m_inotifyFd, POLLIN, 0},
+            {m_wakeFd, POLLIN, 0},
+        };
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+        
+        ssize_t length = read(m_inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) {
+            continue;
+        }
+        
+        for (ssize_t offset = 0; offset < length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+            if (event->len == 0) {
+                continue;
+            }
+            
+            // Only whole .json files; Config::save's temp files are skipped
+            std::string name = event->name;
+            if (name.size() <= 5 || name.compare(name.size() - 5, 5, ".json") != 0) {
+                continue;
+            }
+            
+            if (event->wd == m_systemWatch && name == "system.json") {
+                reloadFromDisk("");
+            } else if (event->wd == m_emulatorsWatch) {
+                reloadFromDisk(name.substr(0, name.size() - 5));
+            }
+        }
+    }
+}
+
+void ConfigManager::reloadFromDisk(const std::string& platform) {
+    std::vector<std::string> changedKeys;
+    {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        
+        // Platforms nobody has asked for yet are picked up on first use
+        Slot* slot = nullptr;
+        if (platform.empty()) {
+            slot = &m_systemSlot;
+        } else if (auto known = m_knownEmulatorSlots.find(platform); known != m_knownEmulatorSlots.end()) {
+            slot = &known->second;
+        } else if (auto other = m_otherEmulatorSlots.find(platform); other != m_otherEmulatorSlots.end()) {
+            slot = &other->second;
+        }
+        
+        ConfigSnapshot current = slot ? std::atomic_load(&slot->config) : nullptr;
+        if (!current) {
+            return;
+        }
+        
+        // A file that does not parse (e.g. mid-edit) leaves the current
+        // version in place
+        Config reloaded;
+        std::string path = platform.empty() ? getSystemConfigPath() : getEmulatorConfigPath(platform);
+        if (!loadConfig(reloaded, path)) {
+            return;
+        }
+        
+        // Our own saves come back here unchanged
+        changedKeys = current->diff(reloaded);
+        if (changedKeys.empty()) {
+            return;
+        }
+        
+        std::cout << "Reloaded " << path << " (" << changedKeys.size() << " changed)" << std::endl;
+        std::atomic_store(&slot->config, std::make_shared<const Config>(std::move(reloaded)));
+        m_generation.fetch_add(1, std::memory_order_release);
     }
     
-    // Boolean values
-    for (auto it = gameConfig.m_boolValues.begin(); it != gameConfig.m_boolValues.end(); ++it) {
-        mergedConfig.setBool(it->first, it->second);
+    notifyListeners(platform, changedKeys);
+}
+
+ConfigView ConfigManager::mergeWithGameConfig(ConfigSnapshot gameConfig, const std::string& platform) {
+    ConfigSnapshot emulatorConfig = getEmulatorConfig(platform);
+    
+    // The slot exists now that the emulator configuration is loaded
+    ConfigSnapshot defaults;
+    auto known = m_knownEmulatorSlots.find(platform);
+    if (known != m_knownEmulatorSlots.end()) {
+        defaults = known->second.defaults;
+    } else {
+        std::lock_guard<std::mutex> lock(m_writeMutex);
+        defaults = emulatorSlot(platform).defaults;
     }
     
-    return mergedConfig;
+    ConfigView view(std::move(gameConfig));
+    view.addLayer(std::move(emulatorConfig));
+    view.addLayer(getSystemConfig());
+    view.addLayer(std::move(defaults));
+    return view;
 }
 
 std::string ConfigManager::getConfigDirectory() const {
@@ -140,53 +364,132 @@ std::string ConfigManager::getEmulatorConfigPath(const std::string& platform) co
 }
 
 bool ConfigManager::saveSystemConfig() {
-    std::string path = getSystemConfigPath();
-    m_systemConfig.save(path);
-    return true;
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    return saveSlot(m_systemSlot, getSystemConfigPath());
 }
 
 bool ConfigManager::saveEmulatorConfig(const std::string& platform) {
-    if (m_emulatorConfigs.find(platform) == m_emulatorConfigs.end()) {
+    std::lock_guard<std::mutex> lock(m_writeMutex);
+    
+    Slot* slot = nullptr;
+    auto known = m_knownEmulatorSlots.find(platform);
+    if (known != m_knownEmulatorSlots.end()) {
+        slot = &known->second;
+    } else {
+        auto other = m_otherEmulatorSlots.find(platform);
+        if (other != m_otherEmulatorSlots.end()) {
+            slot = &other->second;
+        }
+    }
+    
+    if (!slot || !std::atomic_load(&slot->config)) {
         std::cerr << "No configuration exists for platform: " << platform << std::endl;
         return false;
     }
     
-    std::string path = getEmulatorConfigPath(platform);
-    m_emulatorConfigs[platform].save(path);
-    return true;
+    return saveSlot(*slot, getEmulatorConfigPath(platform));
 }
 
-void ConfigManager::createDefaultSystemConfig() {
-    m_systemConfig.setString("temp_directory", "");
-    m_systemConfig.setString("default_output_directory", "");
-    m_systemConfig.setBool("cleanup_temp_files", true);
-    m_systemConfig.setInt("logging_level", 1); // 0=none, 1=errors, 2=warnings, 3=info, 4=debug
+ConfigManager::Slot& ConfigManager::emulatorSlot(const std::string& platform) {
+    auto it = m_knownEmulatorSlots.find(platform);
+    if (it != m_knownEmulatorSlots.end()) {
+        return it->second;
+    }
+    Slot& slot = m_otherEmulatorSlots[platform];
+    if (!slot.defaults) {
+        Config defaults;
+        createDefaultEmulatorConfig(defaults, platform);
+        slot.defaults = std::make_shared<const Config>(std::move(defaults));
+    }
+    return slot;
 }
 
-void ConfigManager::createDefaultEmulatorConfig(const std::string& platform) {
-    Config& config = m_emulatorConfigs[platform];
+ConfigSnapshot ConfigManager::loadEmulatorSlot(const std::string& platform, Slot& slot) {
+    // Another thread may have loaded it while we waited for the lock
+    ConfigSnapshot current = std::atomic_load(&slot.config);
+    if (current) {
+        return current;
+    }
+    
+    XEMURUN_TRACE_SCOPE("config", "ConfigManager::loadEmulatorConfig", platform.c_str());
+    
+    Config config;
+    std::string emulatorConfigPath = getEmulatorConfigPath(platform);
+    if (fs::exists(emulatorConfigPath)) {
+        if (!loadConfig(config, emulatorConfigPath)) {
+            std::cerr << "Failed to load " << platform << " emulator configuration" << std::endl;
+        }
+    } else {
+        // Defaults stay in memory and are written out on exit
+        config = *slot.defaults;
+    }
+    
+    current = std::make_shared<const Config>(std::move(config));
+    std::atomic_store(&slot.config, current);
+    return current;
+}
+
+bool ConfigManager::saveSlot(Slot& slot, const std::string& path) {
+    ConfigSnapshot current = std::atomic_load(&slot.config);
+    if (!current || !current->isDirty()) {
+        return true;
+    }
     
+    if (!ensureConfigDirectoryExists()) {
+        return false;
+    }
+    
+    // Publish the saved version so the dirty flag clears for later readers
+    Config saved = *current;
+    if (!saved.save(path)) {
+        return false;
+    }
+    
+    std::atomic_store(&slot.config, std::make_shared<const Config>(std::move(saved)));
+    return true;
+}
+
+void ConfigManager::createDefaultSystemConfig(Config& config) {
+    config.setDefault(Keys::TempDirectory);
+    config.setDefault(Keys::DefaultOutputDirectory);
+    config.setDefault(Keys::CleanupTempFiles);
+    config.setDefault(Keys::LoggingLevel);
+    config.setDefault(Keys::PrewarmEnabled);
+    config.setDefault(Keys::PrewarmDiskBudgetMb);
+    config.setDefault(Keys::PrewarmMaxTitles);
+    config.setDefault(Keys::RamExtractionBudgetMb);
+    config.setDefault(Keys::RamExtractionPath);
+    config.setDefault(Keys::CasefoldExtraction);
+}
+
+void ConfigManager::createDefaultEmulatorConfig(Config& config, const std::string& platform) {
     // Common settings for all emulators
-    config.setString("game_directory", "");
-    config.setBool("fullscreen", true);
-    config.setInt("resolution_width", 1920);
-    config.setInt("resolution_height", 1080);
+    config.setDefault(Keys::GameDirectory);
+    config.setDefault(Keys::Fullscreen);
+    config.setDefault(Keys::ResolutionWidth);
+    config.setDefault(Keys::ResolutionHeight);
     
     // Platform-specific default settings
     if (platform == "windows") {
-        config.setString("wine_prefix", "");
-        config.setString("wine_version", "");
-        config.setBool("enable_dxvk", true);
-        config.setInt("windows_version", 10); // Target Windows version (7, 8, 10)
+        config.setDefault(Keys::WinePrefix);
+        config.setDefault(Keys::WineVersion);
+        config.setDefault(Keys::EnableDxvk);
+        config.setDefault(Keys::WindowsVersion);
+        config.setDefault(Keys::WineDllOverrides);
+        config.setDefault(Keys::WineDpi);
     } 
     else if (platform == "playstation4" || platform == "playstation5") {
-        config.setString("bios_path", "");
-        config.setInt("rendering_resolution", 1080);
-        config.setBool("vsync", true);
+        config.setDefault(Keys::BiosPath);
+        config.setDefault(Keys::RenderingResolution);
+        config.setDefault(Keys::Vsync);
     }
     else if (platform == "xbox" || platform == "xbox_series") {
-        config.setString("system_files_path", "");
-        config.setBool("enable_hw_acceleration", true);
+        config.setDefault(Keys::SystemFilesPath);
+        config.setDefault(Keys::EnableHwAcceleration);
+        config.setDefault(Keys::StreamDiscImages);
+    }
+    else if (platform == "linux") {
+        config.setDefault(Keys::DisklessLaunchMaxMb);
     }
 }
 
@@ -213,8 +516,7 @@ bool ConfigManager::ensureConfigDirectoryExists() const {
 
 bool ConfigManager::loadConfig(Config& config, const std::string& path) {
     try {
-        config.loadFromFile(path);
-        return true;
+        return config.loadFromFile(path);
     } catch (const std::exception& e) {
         std::cerr << "Error loading config from " << path << ": " << e.what() << std::endl;
         return false;
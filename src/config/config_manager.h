@@ -1,36 +1,71 @@
 #pragma once
 
 #include "config.h"
+#include "config_view.h"
 #include <string>
 #include <memory>
 #include <map>
+#include <mutex>
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+#include <cstdint>
 #include <filesystem>
 
 namespace XEmuRun {
 
+/**
+ * @class ConfigManager
+ * @brief Owns the system and per-platform emulator configurations.
+ *
+ * Readers get snapshots and never block: each configuration lives in a slot
+ * whose shared_ptr is swapped atomically. Writers copy the current version,
+ * modify the copy and publish it; they are serialized by a mutex.
+ */
 class ConfigManager {
 public:
     static ConfigManager& getInstance();
     
     bool initialize();
-    Config& getSystemConfig();
-    Config& getEmulatorConfig(const std::string& platform);
+    ConfigSnapshot getSystemConfig() const;
     
-    // Game-specific config management
-    Config mergeWithGameConfig(const Config& gameConfig, const std::string& platform);
+    // Loads the platform's configuration on first use
+    ConfigSnapshot getEmulatorConfig(const std::string& platform);
+    
+    // Publish a modified copy of the current configuration. Returns true if
+    // the mutator changed anything.
+    bool updateSystemConfig(const std::function<void(Config&)>& mutator);
+    bool updateEmulatorConfig(const std::string& platform, const std::function<void(Config&)>& mutator);
+    
+    // Layers the game configuration over the emulator, system and built-in
+    // defaults without copying any of them
+    ConfigView mergeWithGameConfig(ConfigSnapshot gameConfig, const std::string& platform);
     
     // Configuration paths
     std::string getConfigDirectory() const;
     std::string getSystemConfigPath() const;
     std::string getEmulatorConfigPath(const std::string& platform) const;
     
-    // Save configurations
+    // Save configurations that have unsaved changes
     bool saveSystemConfig();
     bool saveEmulatorConfig(const std::string& platform);
     
-    // Create default configurations
-    void createDefaultSystemConfig();
-    void createDefaultEmulatorConfig(const std::string& platform);
+    // Change notification. Listeners receive the platform whose
+    // configuration changed ("" for the system configuration) and the
+    // changed key names. They run on the thread that published the change
+    // and must not add or remove listeners.
+    using ChangeListener = std::function<void(const std::string& platform, const std::vector<std::string>& changedKeys)>;
+    int addChangeListener(ChangeListener listener);
+    void removeChangeListener(int id);
+    
+    // Reloads configuration files edited on disk (inotify) and notifies
+    // listeners of the keys that changed
+    bool startWatching();
+    void stopWatching();
+    
+    // Incremented whenever any configuration's values change
+    std::uint64_t getGeneration() const;
     
 private:
     ConfigManager();
@@ -40,16 +75,52 @@ private:
     ConfigManager(const ConfigManager&) = delete;
     ConfigManager& operator=(const ConfigManager&) = delete;
     
-    // Configuration storage
-    Config m_systemConfig;
-    std::map<std::string, Config> m_emulatorConfigs;
+    // A published configuration; empty until loaded. The built-in
+    // defaults never change once the slot exists.
+    struct Slot {
+        ConfigSnapshot config;
+        ConfigSnapshot defaults;
+    };
+    
+    // Configuration storage. The set of known platforms is fixed at
+    // construction so their lookups never modify the map; other platforms
+    // are added under m_writeMutex.
+    Slot m_systemSlot;
+    std::map<std::string, Slot> m_knownEmulatorSlots;
+    std::map<std::string, Slot> m_otherEmulatorSlots;
+    
+    // Serializes loading, updating and saving
+    mutable std::mutex m_writeMutex;
     
     // Flag to track initialization
-    bool m_initialized;
+    std::atomic<bool> m_initialized;
+    
+    // Change listeners
+    std::mutex m_listenerMutex;
+    std::map<int, ChangeListener> m_listeners;
+    int m_nextListenerId;
+    std::atomic<std::uint64_t> m_generation;
+    
+    // File watcher
+    std::thread m_watchThread;
+    int m_inotifyFd;
+    int m_wakeFd;
+    int m_systemWatch;
+    int m_emulatorsWatch;
     
     // Helper methods
+    void watchLoop();
+    void reloadFromDisk(const std::string& platform); // "" for the system configuration
+    void notifyListeners(const std::string& platform, const std::vector<std::string>& changedKeys);
+    Slot& emulatorSlot(const std::string& platform); // requires m_writeMutex for unknown platforms
+    ConfigSnapshot loadEmulatorSlot(const std::string& platform, Slot& slot); // requires m_writeMutex
+    bool saveSlot(Slot& slot, const std::string& path); // requires m_writeMutex
     bool ensureConfigDirectoryExists() const;
     bool loadConfig(Config& config, const std::string& path);
+    
+    // Create default configurations
+    static void createDefaultSystemConfig(Config& config);
+    static void createDefaultEmulatorConfig(Config& config, const std::string& platform);
 };
 
 } // namespace XEmuRun
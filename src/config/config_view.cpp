@@ -0,0 +1,72 @@
+#include "config_view.h"
+#include <iostream>
+
+namespace XEmuRun {
+
+ConfigView::ConfigView(ConfigSnapshot config) {
+    addLayer(std::move(config));
+}
+
+void ConfigView::addLayer(ConfigSnapshot config) {
+    if (!config) {
+        return;
+    }
+    if (m_layerCount == kMaxLayers) {
+        std::cerr << "ConfigView: too many layers, ignoring one" << std::endl;
+        return;
+    }
+    m_layers[m_layerCount++] = std::move(config);
+}
+
+template <typename T>
+const auto* ConfigView::findInLayers(const TypedKey<T>& key) const {
+    decltype(m_layers[0]->find(key)) value = nullptr;
+    for (size_t i = 0; i < m_layerCount && !value; ++i) {
+        value = m_layers[i]->find(key);
+    }
+    return value;
+}
+
+std::string_view ConfigView::get(const StringKey& key) const {
+    const std::string* value = findInLayers(key);
+    return value ? std::string_view(*value) : key.defaultValue;
+}
+
+int ConfigView::get(const IntKey& key) const {
+    const int* value = findInLayers(key);
+    return value ? *value : key.defaultValue;
+}
+
+bool ConfigView::get(const BoolKey& key) const {
+    const bool* value = findInLayers(key);
+    return value ? *value : key.defaultValue;
+}
+
+std::string_view ConfigView::getString(ConfigKey key, std::string_view defaultValue) const {
+    for (size_t i = 0; i < m_layerCount; ++i) {
+        if (const std::string* value = m_layers[i]->findString(key)) {
+            return *value;
+        }
+    }
+    return defaultValue;
+}
+
+int ConfigView::getInt(ConfigKey key, int defaultValue) const {
+    for (size_t i = 0; i < m_layerCount; ++i) {
+        if (const int* value = m_layers[i]->findInt(key)) {
+            return *value;
+        }
+    }
+    return defaultValue;
+}
+
+bool ConfigView::getBool(ConfigKey key, bool defaultValue) const {
+    for (size_t i = 0; i < m_layerCount; ++i) {
+        if (const bool* value = m_layers[i]->findBool(key)) {
+            return *value;
+        }
+    }
+    return defaultValue;
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "config.h"
+#include <array>
+#include <string_view>
+
+namespace XEmuRun {
+
+/**
+ * @class ConfigView
+ * @brief Read-only stack of configuration layers resolved per lookup.
+ *
+ * Layers are searched from highest to lowest priority (game, emulator,
+ * system, built-in defaults); the first layer holding the key with the
+ * requested type wins. Nothing is copied when the view is built, and the
+ * view keeps its layers alive, so returned string views stay valid for as
+ * long as the view does.
+ */
+class ConfigView {
+public:
+    static constexpr size_t kMaxLayers = 4;
+
+    ConfigView() = default;
+    explicit ConfigView(ConfigSnapshot config);
+
+    // Appends a layer below the existing ones; null snapshots are skipped
+    void addLayer(ConfigSnapshot config);
+
+    // Registered keys: one slot load per layer, then the key's default
+    std::string_view get(const StringKey& key) const;
+    int get(const IntKey& key) const;
+    bool get(const BoolKey& key) const;
+
+    // Keys built at runtime
+    std::string_view getString(ConfigKey key, std::string_view defaultValue = {}) const;
+    int getInt(ConfigKey key, int defaultValue = 0) const;
+    bool getBool(ConfigKey key, bool defaultValue = false) const;
+
+private:
+    template <typename T>
+    const auto* findInLayers(const TypedKey<T>& key) const;
+
+    std::array<ConfigSnapshot, kMaxLayers> m_layers;
+    size_t m_layerCount = 0;
+};
+
+} // namespace XEmuRun
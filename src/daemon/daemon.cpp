@@ -0,0 +1,407 @@
+#include "daemon.h"
+#include "protocol.h"
+#include "../config/config_manager.h"
+#include <iostream>
+#include <filesystem>
+#include <thread>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+// How often the idle daemon looks after the extraction cache
+constexpr int kMaintenanceIntervalMs = 60 * 1000;
+
+Json::Value errorReply(const std::string& message, bool runLocally = false) {
+    Json::Value reply;
+    reply["status"] = "error";
+    reply["error"] = message;
+    if (runLocally) {
+        reply["runLocally"] = true;
+    }
+    return reply;
+}
+
+// True if something is already accepting connections on path
+bool socketIsLive(const sockaddr_un& addr) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool live = connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) == 0;
+    close(fd);
+    return live;
+}
+
+} // namespace
+
+Daemon::Daemon(const std::string& socketPath)
+    : m_socketPath(socketPath.empty() ? DaemonProtocol::getSocketPath() : socketPath),
+      m_listenFd(-1), m_wakePipe{-1, -1}, m_running(false) {
+}
+
+Daemon::~Daemon() {
+    if (m_listenFd >= 0) {
+        close(m_listenFd);
+        unlink(m_socketPath.c_str());
+    }
+    if (m_wakePipe[0] >= 0) {
+        close(m_wakePipe[0]);
+        close(m_wakePipe[1]);
+    }
+}
+
+bool Daemon::bindSocket() {
+    sockaddr_un addr{};
+    if (m_socketPath.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "Socket path too long: " << m_socketPath << std::endl;
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, m_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    // The socket directory is private to the user; launch requests run
+    // arbitrary packages, so nobody else may connect
+    try {
+        fs::path socketDir = fs::path(m_socketPath).parent_path();
+        fs::create_directories(socketDir);
+        fs::permissions(socketDir, fs::perms::owner_all, fs::perm_options::replace);
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Failed to create socket directory: " << e.what() << std::endl;
+        return false;
+    }
+
+    if (fs::exists(m_socketPath)) {
+        if (socketIsLive(addr)) {
+            std::cerr << "xemurund is already running on " << m_socketPath << std::endl;
+            return false;
+        }
+        // Left behind by a daemon that did not shut down cleanly
+        unlink(m_socketPath.c_str());
+    }
+
+    m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (m_listenFd < 0) {
+        std::cerr << "Failed to create socket: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    mode_t oldMask = umask(0077);
+    int bound = bind(m_listenFd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    umask(oldMask);
+
+    if (bound != 0 || listen(m_listenFd, 16) != 0) {
+        std::cerr << "Failed to listen on " << m_socketPath << ": " << std::strerror(errno) << std::endl;
+        close(m_listenFd);
+        m_listenFd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+int Daemon::run() {
+    // Configuration is loaded once and then served from memory; edits on
+    // disk are picked up by the watcher
+    ConfigManager& configManager = ConfigManager::getInstance();
+    if (!configManager.initialize()) {
+        std::cerr << "Failed to initialize configuration system" << std::endl;
+        return 1;
+    }
+    configManager.startWatching();
+
+    if (pipe2(m_wakePipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        std::cerr << "Failed to create wake pipe: " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    if (!bindSocket()) {
+        return 1;
+    }
+
+    m_startTime = std::chrono::steady_clock::now();
+    m_running = true;
+    std::cout << "xemurund listening on " << m_socketPath << std::endl;
+
+    while (m_running) {
+        pollfd fds[2] = {
+            {m_listenFd, POLLIN, 0},
+            {m_wakePipe[0], POLLIN, 0},
+        };
+
+        int ready = poll(fds, 2, kMaintenanceIntervalMs);
+        if (ready < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "poll failed: " << std::strerror(errno) << std::endl;
+            break;
+        }
+
+        // Prepared packages keep their extractions; idle ones in RAM are
+        // dropped when memory gets tight
+        if (ready == 0) {
+            Package::trimRamExtractions();
+            continue;
+        }
+
+        if (fds[1].revents & POLLIN) {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int clientFd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (clientFd < 0) {
+                continue;
+            }
+            // Launch requests block until the game exits, so each client
+            // gets its own thread
+            std::lock_guard<std::mutex> lock(m_clientsMutex);
+            m_clients[clientFd] = std::thread(&Daemon::handleConnection, this, clientFd);
+        }
+
+        reapClients(false);
+    }
+
+    m_running = false;
+    std::cout << "xemurund shutting down" << std::endl;
+
+    {
+        std::lock_guard<std::mutex> lock(m_clientsMutex);
+        for (Launcher* launcher : m_runningLaunchers) {
+            launcher->terminate();
+        }
+        // Wakes clients blocked waiting for their next request
+        for (const auto& [fd, thread] : m_clients) {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    reapClients(true);
+    return 0;
+}
+
+void Daemon::reapClients(bool wait) {
+    std::vector<std::thread> finished;
+    {
+        std::unique_lock<std::mutex> lock(m_clientsMutex);
+        if (wait) {
+            m_clientFinished.wait(lock, [this] { return m_clients.empty(); });
+        }
+        finished.swap(m_finishedClients);
+    }
+    for (std::thread& thread : finished) {
+        thread.join();
+    }
+}
+
+void Daemon::stop() {
+    m_running = false;
+    if (m_wakePipe[1] >= 0) {
+        char c = 0;
+        ssize_t ignored = write(m_wakePipe[1], &c, 1);
+        (void)ignored;
+    }
+}
+
+void Daemon::handleConnection(int fd) {
+    Json::Value request;
+    while (m_running && DaemonProtocol::receiveMessage(fd, request)) {
+        Json::Value reply = handleRequest(request);
+        if (!DaemonProtocol::sendMessage(fd, reply)) {
+            break;
+        }
+    }
+
+    // Hands this thread to run() to be joined; the fd stays open until the
+    // entry is gone, so shutdown() in run() never hits a reused fd
+    std::lock_guard<std::mutex> lock(m_clientsMutex);
+    auto it = m_clients.find(fd);
+    if (it != m_clients.end()) {
+        m_finishedClients.push_back(std::move(it->second));
+        m_clients.erase(it);
+    }
+    close(fd);
+    m_clientFinished.notify_all();
+}
+
+Json::Value Daemon::handleRequest(const Json::Value& request) {
+    std::string command = request["command"].asString();
+    std::string packagePath = request["package"].asString();
+
+    if (command == "status") {
+        return status();
+    }
+    if (command == "shutdown") {
+        stop();
+        Json::Value reply;
+        reply["status"] = "ok";
+        return reply;
+    }
+    if (command == "prepare" || command == "launch") {
+        if (packagePath.empty() || !fs::path(packagePath).is_absolute()) {
+            return errorReply("Request needs an absolute package path");
+        }
+        return command == "prepare" ? prepare(packagePath) : launch(packagePath, request);
+    }
+
+    return errorReply("Unknown command: " + command);
+}
+
+std::shared_ptr<Daemon::PreparedPackage> Daemon::preparePackage(const std::string& packagePath,
+                                                                std::unique_lock<std::mutex>& entryLock,
+                                                                std::string& error, bool& runLocally) {
+    runLocally = false;
+    fs::file_time_type mtime;
+    std::uintmax_t size;
+    try {
+        mtime = fs::last_write_time(packagePath);
+        size = fs::file_size(packagePath);
+    } catch (const fs::filesystem_error&) {
+        error = "Package not found: " + packagePath;
+        return nullptr;
+    }
+
+    std::shared_ptr<PreparedPackage> entry;
+    {
+        std::lock_guard<std::mutex> lock(m_packagesMutex);
+        std::shared_ptr<PreparedPackage>& slot = m_packages[packagePath];
+        if (!slot) {
+            slot = std::make_shared<PreparedPackage>();
+        }
+        entry = slot;
+    }
+
+    entryLock = std::unique_lock<std::mutex>(entry->mutex);
+    if (entry->launcher && entry->mtime == mtime && entry->size == size) {
+        return entry;
+    }
+    if (entry->running) {
+        error = "Package is running and cannot be reloaded: " + packagePath;
+        return nullptr;
+    }
+
+    // The package is new or was replaced on disk since it was prepared.
+    // The old version's launcher goes first: its shared lock on the
+    // extraction would keep the new version from replacing it.
+    entry->launcher.reset();
+
+    // In-process backends would emulate on a client thread, with the
+    // daemon's display and environment
+    auto launcher = std::make_unique<Launcher>();
+    launcher->setAllowInProcess(false);
+    if (!launcher->loadPackage(packagePath)) {
+        entry->launcher.reset();
+        runLocally = EmulatorRegistry::getInstance().runsInProcess(launcher->getPlatform());
+        error = runLocally ? "Platform " + launcher->getPlatform() + " is launched by the client"
+                           : "Failed to load package: " + packagePath;
+        return nullptr;
+    }
+
+    entry->launcher = std::move(launcher);
+    entry->mtime = mtime;
+    entry->size = size;
+    return entry;
+}
+
+Json::Value Daemon::prepare(const std::string& packagePath) {
+    std::unique_lock<std::mutex> entryLock;
+    std::string error;
+    bool runLocally = false;
+    if (!preparePackage(packagePath, entryLock, error, runLocally)) {
+        return errorReply(error, runLocally);
+    }
+
+    Json::Value reply;
+    reply["status"] = "ok";
+    reply["package"] = packagePath;
+    return reply;
+}
+
+Json::Value Daemon::launch(const std::string& packagePath, const Json::Value& request) {
+    std::unique_lock<std::mutex> entryLock;
+    std::string error;
+    bool runLocally = false;
+    std::shared_ptr<PreparedPackage> entry = preparePackage(packagePath, entryLock, error, runLocally);
+    if (!entry) {
+        return errorReply(error, runLocally);
+    }
+
+    // One running instance per package; a second launch is refused rather
+    // than queued behind the game. Other packages launch concurrently.
+    if (entry->running) {
+        return errorReply("Package is already running: " + packagePath);
+    }
+
+    // The game gets the client's display, session and working directory
+    // rather than whatever the daemon was started with
+    std::vector<std::string> environment;
+    for (const Json::Value& variable : request["environment"]) {
+        environment.push_back(variable.asString());
+    }
+    Launcher* launcher = entry->launcher.get();
+    launcher->setLaunchEnvironment(environment, request["cwd"].asString());
+    {
+        // Registered so that shutdown can stop the game
+        std::lock_guard<std::mutex> clientsLock(m_clientsMutex);
+        if (!m_running) {
+            return errorReply("xemurund is shutting down");
+        }
+        m_runningLaunchers.insert(launcher);
+    }
+
+    // Not held while the game runs, so other requests for the package are
+    // answered at once
+    entry->running = true;
+    entryLock.unlock();
+
+    Json::Value reply;
+    reply["status"] = "ok";
+    reply["exitCode"] = launcher->runGame();
+
+    {
+        std::lock_guard<std::mutex> clientsLock(m_clientsMutex);
+        m_runningLaunchers.erase(launcher);
+    }
+    entryLock.lock();
+    entry->running = false;
+    return reply;
+}
+
+Json::Value Daemon::status() {
+    Json::Value reply;
+    reply["status"] = "ok";
+    reply["pid"] = static_cast<Json::Int64>(getpid());
+    reply["uptimeSeconds"] = static_cast<Json::Int64>(std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now() - m_startTime).count());
+
+    Json::Value packages(Json::arrayValue);
+    {
+        std::lock_guard<std::mutex> lock(m_packagesMutex);
+        for (const auto& [path, entry] : m_packages) {
+            Json::Value package;
+            package["path"] = path;
+            // An entry that is being prepared or running is busy, not
+            // unprepared
+            std::unique_lock<std::mutex> entryLock(entry->mutex, std::try_to_lock);
+            bool busy = !entryLock.owns_lock() || entry->running;
+            package["busy"] = busy;
+            package["prepared"] = busy || entry->launcher != nullptr;
+            packages.append(package);
+        }
+    }
+    reply["packages"] = packages;
+    return reply;
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <string>
+#include <map>
+#include <set>
+#include <vector>
+#include <thread>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <json/json.h>
+#include "../launcher/launcher.h"
+
+namespace XEmuRun {
+
+/**
+ * @class Daemon
+ * @brief Resident launcher serving prepare/launch/status over a UNIX socket.
+ *
+ * Configuration is loaded once at startup and every prepared package keeps
+ * its extracted tree, parsed manifest and configured emulator in memory, so
+ * repeat launches skip straight to starting the game.
+ */
+class Daemon {
+public:
+    explicit Daemon(const std::string& socketPath = "");
+    ~Daemon();
+
+    // Binds the socket and serves requests until stop() is called
+    int run();
+
+    // Safe to call from a signal handler
+    void stop();
+
+private:
+    struct PreparedPackage {
+        std::unique_ptr<Launcher> launcher;
+        std::filesystem::file_time_type mtime;
+        std::uintmax_t size = 0;
+        bool running = false; // a launch is in its game
+        std::mutex mutex; // held while the package is prepared; guards the rest
+    };
+
+    bool bindSocket();
+    void handleConnection(int fd);
+    // Joins client threads that have returned; with wait, all of them
+    void reapClients(bool wait);
+    Json::Value handleRequest(const Json::Value& request);
+
+    Json::Value prepare(const std::string& packagePath);
+    Json::Value launch(const std::string& packagePath, const Json::Value& request);
+    Json::Value status();
+
+    // Returns the entry for packagePath, reloading it if the file changed,
+    // with entryLock holding its mutex. A package that changed while its
+    // game runs is refused as busy. Packages whose games would run inside
+    // the daemon are refused with runLocally set, and the client launches
+    // them itself.
+    std::shared_ptr<PreparedPackage> preparePackage(const std::string& packagePath,
+                                                    std::unique_lock<std::mutex>& entryLock, std::string& error,
+                                                    bool& runLocally);
+
+    std::string m_socketPath;
+    int m_listenFd;
+    int m_wakePipe[2];
+    std::atomic<bool> m_running;
+    std::chrono::steady_clock::time_point m_startTime;
+
+    std::mutex m_packagesMutex;
+    std::map<std::string, std::shared_ptr<PreparedPackage>> m_packages;
+
+    // Client threads use the daemon's members, so run() joins them all
+    // before it returns; games still running are terminated first
+    std::mutex m_clientsMutex;
+    std::condition_variable m_clientFinished;
+    std::map<int, std::thread> m_clients; // by connection fd
+    std::vector<std::thread> m_finishedClients;
+    std::set<Launcher*> m_runningLaunchers;
+
+    // Prevent copying
+    Daemon(const Daemon&) = delete;
+    Daemon& operator=(const Daemon&) = delete;
+};
+
+} // namespace XEmuRun
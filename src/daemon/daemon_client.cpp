@@ -0,0 +1,114 @@
+#include "daemon_client.h"
+#include "protocol.h"
+#include <iostream>
+#include <filesystem>
+#include <cstring>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+extern char** environ;
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+DaemonClient::DaemonClient(const std::string& socketPath)
+    : m_socketPath(socketPath.empty() ? DaemonProtocol::getSocketPath() : socketPath), m_fd(-1) {
+}
+
+DaemonClient::~DaemonClient() {
+    if (m_fd >= 0) {
+        close(m_fd);
+    }
+}
+
+bool DaemonClient::connect() {
+    if (m_fd >= 0) {
+        return true;
+    }
+
+    sockaddr_un addr{};
+    if (m_socketPath.size() >= sizeof(addr.sun_path)) {
+        return false;
+    }
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, m_socketPath.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0) {
+        close(fd);
+        return false;
+    }
+
+    m_fd = fd;
+    return true;
+}
+
+bool DaemonClient::request(const Json::Value& request, Json::Value& reply) {
+    if (!connect()) {
+        return false;
+    }
+
+    if (!DaemonProtocol::sendMessage(m_fd, request) || !DaemonProtocol::receiveMessage(m_fd, reply)) {
+        std::cerr << "Lost connection to xemurund" << std::endl;
+        close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+bool DaemonClient::prepare(const std::string& packagePath, Json::Value& reply) {
+    Json::Value req;
+    req["command"] = "prepare";
+    req["package"] = fs::absolute(packagePath).string();
+    return request(req, reply) && reply["status"].asString() == "ok";
+}
+
+bool DaemonClient::launch(const std::string& packagePath, int& exitCode) {
+    Json::Value req;
+    req["command"] = "launch";
+    req["package"] = fs::absolute(packagePath).string();
+
+    // The game runs with this process's environment and directory
+    Json::Value environment(Json::arrayValue);
+    for (char** entry = environ; entry && *entry; ++entry) {
+        environment.append(*entry);
+    }
+    req["environment"] = environment;
+    std::error_code ec;
+    req["cwd"] = fs::current_path(ec).string();
+
+    Json::Value reply;
+    if (!request(req, reply)) {
+        return false;
+    }
+
+    // Games the daemon does not run itself are launched by the caller
+    if (reply["runLocally"].asBool()) {
+        return false;
+    }
+
+    if (reply["status"].asString() != "ok") {
+        std::cerr << "xemurund: " << reply["error"].asString() << std::endl;
+        exitCode = 1;
+        return true;
+    }
+
+    exitCode = reply["exitCode"].asInt();
+    return true;
+}
+
+bool DaemonClient::status(Json::Value& reply) {
+    Json::Value req;
+    req["command"] = "status";
+    return request(req, reply);
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <json/json.h>
+
+namespace XEmuRun {
+
+/**
+ * @class DaemonClient
+ * @brief Thin client for a running xemurund.
+ *
+ * Connecting is cheap and never touches configuration, so callers can try
+ * the daemon first and fall back to launching in-process.
+ */
+class DaemonClient {
+public:
+    explicit DaemonClient(const std::string& socketPath = "");
+    ~DaemonClient();
+
+    // True if a daemon accepted the connection
+    bool connect();
+    bool isConnected() const { return m_fd >= 0; }
+
+    // Sends a request and waits for the reply. Launch replies arrive only
+    // once the game has exited.
+    bool request(const Json::Value& request, Json::Value& reply);
+
+    bool prepare(const std::string& packagePath, Json::Value& reply);
+    // False if the request failed or the daemon leaves the game to the
+    // caller, e.g. for platforms that emulate in-process
+    bool launch(const std::string& packagePath, int& exitCode);
+    bool status(Json::Value& reply);
+
+private:
+    std::string m_socketPath;
+    int m_fd;
+
+    // Prevent copying
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+};
+
+} // namespace XEmuRun
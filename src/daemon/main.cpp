@@ -0,0 +1,47 @@
+#include <iostream>
+#include <string>
+#include <csignal>
+#include "daemon/daemon.h"
+
+namespace {
+
+XEmuRun::Daemon* g_daemon = nullptr;
+
+void handleSignal(int) {
+    if (g_daemon) {
+        g_daemon->stop();
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::string socketPath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else if (arg == "--help" || arg == "-h") {
+            std::cout << "Usage: xemurund [--socket path]" << std::endl;
+            return 0;
+        } else {
+            std::cerr << "Unknown option: " << arg << std::endl;
+            return 1;
+        }
+    }
+
+    XEmuRun::Daemon daemon(socketPath);
+    g_daemon = &daemon;
+
+    struct sigaction action{};
+    action.sa_handler = handleSignal;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGTERM, &action, nullptr);
+    sigaction(SIGINT, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    int result = daemon.run();
+    g_daemon = nullptr;
+    return result;
+}
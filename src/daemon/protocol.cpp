@@ -0,0 +1,68 @@
+#include "protocol.h"
+#include <cstdlib>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+
+namespace XEmuRun {
+namespace DaemonProtocol {
+
+namespace {
+
+// Requests and replies are small, launches carry the client's environment;
+// anything larger is a broken peer
+constexpr size_t kMaxMessageSize = 1024 * 1024;
+
+} // namespace
+
+std::string getSocketPath() {
+    const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    if (runtimeDir && *runtimeDir) {
+        return std::string(runtimeDir) + "/xemurun/daemon.sock";
+    }
+    return "/tmp/xemurun-" + std::to_string(getuid()) + "/daemon.sock";
+}
+
+bool sendMessage(int fd, const Json::Value& message) {
+    Json::FastWriter writer;
+    std::string line = writer.write(message); // FastWriter terminates with '\n'
+
+    size_t offset = 0;
+    while (offset < line.size()) {
+        ssize_t written = send(fd, line.data() + offset, line.size() - offset, MSG_NOSIGNAL);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        offset += static_cast<size_t>(written);
+    }
+    return true;
+}
+
+bool receiveMessage(int fd, Json::Value& message) {
+    std::string line;
+    char c;
+
+    // Byte-wise reads keep the protocol free of buffering state between messages
+    while (line.size() < kMaxMessageSize) {
+        ssize_t count = recv(fd, &c, 1, 0);
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            return false;
+        }
+        if (c == '\n') {
+            Json::Reader reader;
+            return reader.parse(line, message) && message.isObject();
+        }
+        line += c;
+    }
+
+    return false;
+}
+
+} // namespace DaemonProtocol
+} // namespace XEmuRun
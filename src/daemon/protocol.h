@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <json/json.h>
+
+namespace XEmuRun {
+
+/**
+ * Wire format shared by xemurund and its clients: one JSON object per
+ * line over a UNIX stream socket.
+ *
+ * Requests carry a "command" (prepare, launch, status, shutdown) and,
+ * where relevant, an absolute "package" path. Replies carry "status"
+ * ("ok" or "error") plus command-specific fields.
+ */
+namespace DaemonProtocol {
+
+// Default socket location: $XDG_RUNTIME_DIR/xemurun/daemon.sock,
+// falling back to /tmp/xemurun-<uid>/daemon.sock
+std::string getSocketPath();
+
+bool sendMessage(int fd, const Json::Value& message);
+bool receiveMessage(int fd, Json::Value& message);
+
+} // namespace DaemonProtocol
+
+} // namespace XEmuRun
@@ -1,4 +1,5 @@
 #include "base_emulator.h"
+#include <cstdlib>
 
 namespace XEmuRun {
 
@@ -6,12 +7,177 @@ BaseEmulator::BaseEmulator(const std::string& name, const std::string& platform)
     : m_name(name), m_platform(platform), m_initialized(false) {
 }
 
+BaseEmulator::~BaseEmulator() {
+    // EmulatorDeleter terminates first, while the derived object still
+    // exists; this only catches emulators destroyed some other way
+    cancelPrepare();
+}
+
 bool BaseEmulator::initialize() {
     std::cout << "Initializing " << m_name << " emulator..." << std::endl;
     m_initialized = true;
     return true;
 }
 
+bool BaseEmulator::runInitialize() {
+    m_initialized = initialize();
+    return m_initialized;
+}
+
+void BaseEmulator::prepare() {
+    std::lock_guard<std::mutex> lock(m_prepareMutex);
+    
+    // Already preparing, prepared or running
+    EmulatorState state = m_state;
+    if (state != EmulatorState::Idle && state != EmulatorState::Failed) {
+        return;
+    }
+    
+    if (m_prepareThread.joinable()) {
+        m_prepareThread.join();
+    }
+    m_prepareCancelled = false;
+    m_state = EmulatorState::Preparing;
+    m_prepareThread = std::thread([this] {
+        bool ready = runInitialize();
+        
+        // Setup that completed before the cancel is kept
+        if (ready) {
+            m_state = EmulatorState::Ready;
+        } else {
+            m_state = m_prepareCancelled ? EmulatorState::Idle : EmulatorState::Failed;
+        }
+    });
+}
+
+void BaseEmulator::cancelPrepare() {
+    m_prepareCancelled = true;
+    waitForPrepare();
+}
+
+void BaseEmulator::waitForPrepare() {
+    std::lock_guard<std::mutex> lock(m_prepareMutex);
+    if (m_prepareThread.joinable()) {
+        m_prepareThread.join();
+    }
+}
+
+bool BaseEmulator::requiresExtraction(const Package&) {
+    return true;
+}
+
+void BaseEmulator::setLaunchEnvironment(const std::vector<std::string>& environment,
+                                        const std::string& workingDirectory) {
+    m_launchEnvironment = environment;
+    m_process.setBaseEnvironment(environment);
+    m_process.setWorkingDirectory(workingDirectory);
+}
+
+const char* BaseEmulator::getLaunchVariable(const std::string& name) const {
+    if (m_launchEnvironment.empty()) {
+        return std::getenv(name.c_str());
+    }
+    for (const std::string& variable : m_launchEnvironment) {
+        if (variable.size() > name.size() && variable[name.size()] == '=' && variable.compare(0, name.size(), name) == 0) {
+            return variable.c_str() + name.size() + 1;
+        }
+    }
+    return nullptr;
+}
+
+bool BaseEmulator::launch(const Package& package) {
+    {
+        std::lock_guard<std::mutex> lock(m_launchMutex);
+        if (m_stopRequested) {
+            m_stopRequested = false;
+            std::cerr << "Launch of " << m_name << " game cancelled" << std::endl;
+            m_exitCode = 1;
+            m_state = EmulatorState::Failed;
+            return false;
+        }
+        m_launching = true;
+    }
+    
+    bool started = setUpAndStart(package);
+    
+    // A terminate() while the game was starting only recorded the request
+    std::lock_guard<std::mutex> lock(m_launchMutex);
+    m_launching = false;
+    if (m_stopRequested) {
+        m_stopRequested = false;
+        if (m_process.isRunning()) {
+            m_process.terminate();
+        } else if (m_gameThread.joinable()) {
+            stopGame();
+        }
+    }
+    return started;
+}
+
+bool BaseEmulator::setUpAndStart(const Package& package) {
+    waitForPrepare();
+    m_prepareCancelled = false;
+    
+    // Not prepared, or preparation failed: set up now so the error is shown
+    if (!m_initialized && !runInitialize()) {
+        std::cerr << "Failed to initialize " << m_name << " emulator" << std::endl;
+        m_state = EmulatorState::Failed;
+        return false;
+    }
+    
+    m_exitCode = 0;
+    m_state = EmulatorState::Running;
+    if (!startGame(package)) {
+        m_exitCode = 1;
+        m_state = EmulatorState::Failed;
+        return false;
+    }
+    
+    // Backends that neither spawned nor started a game thread are done
+    if (!m_process.isRunning() && !m_gameThread.joinable()) {
+        m_state = EmulatorState::Exited;
+    }
+    return true;
+}
+
+void BaseEmulator::startGameThread(std::function<int()> game) {
+    m_gameThreadRunning = true;
+    m_gameThread = std::thread([this, game = std::move(game)] {
+        m_exitCode = game();
+        m_gameThreadRunning = false;
+    });
+}
+
+int BaseEmulator::waitFor() {
+    if (m_gameThread.joinable()) {
+        m_gameThread.join();
+        m_state = EmulatorState::Exited;
+    } else if (m_process.isRunning()) {
+        m_exitCode = m_process.wait();
+        m_state = EmulatorState::Exited;
+    }
+    return m_exitCode;
+}
+
+void BaseEmulator::terminate() {
+    cancelPrepare();
+    
+    std::lock_guard<std::mutex> lock(m_launchMutex);
+    if (m_launching || (!m_process.isRunning() && !m_gameThread.joinable())) {
+        // Nothing to stop yet: launch() stops the game once it has started,
+        // or does not start it
+        m_stopRequested = true;
+    } else if (m_process.isRunning()) {
+        m_process.terminate();
+    } else {
+        stopGame();
+    }
+}
+
+EmulatorState BaseEmulator::getState() const {
+    return m_state;
+}
+
 std::string BaseEmulator::getName() const {
     return m_name;
 }
@@ -20,7 +186,15 @@ std::string BaseEmulator::getSupportedPlatform() const {
     return m_platform;
 }
 
-void BaseEmulator::applyConfig(const Config& config) {
+void BaseEmulator::applyConfig(const ConfigView& config) {
+    // initialize() reads the configuration, so never swap it underneath a
+    // running prepare; setup done with the old one is redone at launch
+    waitForPrepare();
+    if (m_state == EmulatorState::Ready) {
+        m_initialized = false;
+        m_state = EmulatorState::Idle;
+    }
+    
     // Store the configuration
     m_config = config;
     
@@ -28,21 +202,31 @@ void BaseEmulator::applyConfig(const Config& config) {
     std::cout << "Applied configuration for " << m_name << " emulator" << std::endl;
     
     // Log some common settings
-    bool fullscreen = config.getBool("fullscreen", true);
-    int width = config.getInt("resolution_width", 1920);
-    int height = config.getInt("resolution_height", 1080);
+    bool fullscreen = config.get(Keys::Fullscreen);
+    int width = config.get(Keys::ResolutionWidth);
+    int height = config.get(Keys::ResolutionHeight);
     
     std::cout << "Display mode: " << (fullscreen ? "Fullscreen" : "Windowed") << std::endl;
     std::cout << "Resolution: " << width << "x" << height << std::endl;
 }
 
+bool BaseEmulator::onConfigChanged(const ConfigView&, const std::vector<std::string>& changedKeys) {
+    // Backends without live reconfiguration pick changes up on next launch
+    std::cout << m_name << ": configuration changed (";
+    for (size_t i = 0; i < changedKeys.size(); ++i) {
+        std::cout << (i ? ", " : "") << changedKeys[i];
+    }
+    std::cout << "), restart the game to apply" << std::endl;
+    return false;
+}
+
 Config BaseEmulator::getDefaultConfig() const {
     Config config;
     
     // Common settings for all emulators
-    config.setBool("fullscreen", true);
-    config.setInt("resolution_width", 1920);
-    config.setInt("resolution_height", 1080);
+    config.setDefault(Keys::Fullscreen);
+    config.setDefault(Keys::ResolutionWidth);
+    config.setDefault(Keys::ResolutionHeight);
     
     return config;
 }
@@ -1,29 +1,89 @@
 #pragma once
 
 #include "emulator_interface.h"
+#include "../utils/process.h"
 #include <string>
 #include <iostream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <functional>
 
 namespace XEmuRun {
 
 class BaseEmulator : public EmulatorInterface {
 public:
     BaseEmulator(const std::string& name, const std::string& platform);
-    virtual ~BaseEmulator() = default;
+    virtual ~BaseEmulator();
     
     virtual bool initialize() override;
     virtual std::string getName() const override;
     virtual std::string getSupportedPlatform() const override;
     
+    // Lifecycle
+    virtual void prepare() override;
+    virtual void cancelPrepare() override;
+    virtual bool requiresExtraction(const Package& package) override;
+    virtual void setLaunchEnvironment(const std::vector<std::string>& environment,
+                                      const std::string& workingDirectory) override;
+    virtual bool launch(const Package& package) override;
+    virtual int waitFor() override;
+    virtual void terminate() override;
+    virtual EmulatorState getState() const override;
+    
     // Configuration methods
-    virtual void applyConfig(const Config& config) override;
+    virtual void applyConfig(const ConfigView& config) override;
+    virtual bool onConfigChanged(const ConfigView& config, const std::vector<std::string>& changedKeys) override;
     virtual Config getDefaultConfig() const override;
     
 protected:
+    // Starts the game once setup is done. Backends that run an external
+    // program spawn it into m_process and return; in-process backends hand
+    // the game to startGameThread().
+    virtual bool startGame(const Package& package) = 0;
+    
+    // Runs an in-process game on a thread of its own, so launch() returns
+    // at once; waitFor() joins it and returns the game's result. Derived
+    // destructors must stop and join a game that is still running.
+    void startGameThread(std::function<int()> game);
+    bool isGameThreadRunning() const { return m_gameThreadRunning.load(); }
+    
+    // Asks an in-process game to quit; m_process is signalled by terminate()
+    virtual void stopGame() {}
+    
+    // A variable of the environment the game starts with, or nullptr
+    const char* getLaunchVariable(const std::string& name) const;
+    
+    // Checked by initialize() between setup steps
+    bool isPrepareCancelled() const { return m_prepareCancelled.load(); }
+    
     std::string m_name;
     std::string m_platform;
     bool m_initialized;
-    Config m_config;
+    ConfigView m_config;
+    Process m_process;
+    int m_exitCode = 0;
+    std::vector<std::string> m_launchEnvironment; // empty: this process's
+    
+private:
+    bool runInitialize();
+    void waitForPrepare();
+    bool setUpAndStart(const Package& package);
+    
+    std::mutex m_prepareMutex;
+    std::thread m_prepareThread;
+    std::atomic<bool> m_prepareCancelled{false};
+    std::atomic<EmulatorState> m_state{EmulatorState::Idle};
+    
+    std::thread m_gameThread;
+    std::atomic<bool> m_gameThreadRunning{false};
+    
+    // A terminate() that finds no game to stop is kept for launch(): one
+    // arriving while the game starts stops it once it has, and one
+    // arriving before launch() cancels it
+    std::mutex m_launchMutex;
+    bool m_launching = false;
+    bool m_stopRequested = false;
 };
 
 } // namespace XEmuRun
@@ -0,0 +1,253 @@
+#include "disc_mount.h"
+#include "../utils/trace.h"
+#include <iostream>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef XEMURUN_HAVE_FUSE3
+#define FUSE_USE_VERSION 31
+#include <fuse.h>
+#include <fuse_lowlevel.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+// Checkpoints of each package's image: $XDG_CACHE_HOME/XEmuRun/streams/<package>
+std::string indexPathFor(const std::string& packagePath) {
+    fs::path root;
+    const char* xdgCacheHome = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    if (xdgCacheHome && *xdgCacheHome) {
+        root = fs::path(xdgCacheHome) / "XEmuRun";
+    } else if (home) {
+        root = fs::path(home) / ".cache" / "XEmuRun";
+    } else {
+        root = fs::temp_directory_path() / "XEmuRun-cache";
+    }
+    std::error_code ec;
+    fs::create_directories(root / "streams", ec);
+    return (root / "streams" / fs::path(packagePath).stem()).string();
+}
+
+// One directory per mount, below the user's runtime directory
+std::string newMountPoint() {
+    static std::atomic<int> counter{0};
+    const char* runtimeDir = std::getenv("XDG_RUNTIME_DIR");
+    fs::path root = runtimeDir && *runtimeDir ? fs::path(runtimeDir) / "xemurun"
+                                              : fs::temp_directory_path() / ("xemurun-" + std::to_string(getuid()));
+    return (root / ("disc-" + std::to_string(getpid()) + "-" + std::to_string(counter++))).string();
+}
+
+} // namespace
+
+#ifdef XEMURUN_HAVE_FUSE3
+
+// The mount's root holds the image and nothing else
+struct DiscMountOperations {
+    static DiscMount* self() {
+        return static_cast<DiscMount*>(fuse_get_context()->private_data);
+    }
+
+    static bool isImage(const char* path) {
+        return path[0] == '/' && self()->m_fileName == path + 1;
+    }
+
+    static int getattr(const char* path, struct stat* st, struct fuse_file_info*) {
+        std::memset(st, 0, sizeof(*st));
+        st->st_uid = getuid();
+        st->st_gid = getgid();
+        if (std::strcmp(path, "/") == 0) {
+            st->st_mode = S_IFDIR | 0555;
+            st->st_nlink = 2;
+            return 0;
+        }
+        if (!isImage(path)) {
+            return -ENOENT;
+        }
+        st->st_mode = S_IFREG | 0444;
+        st->st_nlink = 1;
+        st->st_size = static_cast<off_t>(self()->m_entry.size());
+        return 0;
+    }
+
+    static int readdir(const char* path, void* buffer, fuse_fill_dir_t filler, off_t, struct fuse_file_info*,
+                       enum fuse_readdir_flags) {
+        if (std::strcmp(path, "/") != 0) {
+            return -ENOENT;
+        }
+        filler(buffer, ".", nullptr, 0, static_cast<fuse_fill_dir_flags>(0));
+        filler(buffer, "..", nullptr, 0, static_cast<fuse_fill_dir_flags>(0));
+        filler(buffer, self()->m_fileName.c_str(), nullptr, 0, static_cast<fuse_fill_dir_flags>(0));
+        return 0;
+    }
+
+    static int open(const char* path, struct fuse_file_info* info) {
+        if (!isImage(path)) {
+            return -ENOENT;
+        }
+        if ((info->flags & O_ACCMODE) != O_RDONLY) {
+            return -EROFS;
+        }
+        // The image never changes while mounted, so the page cache may
+        // keep it across opens
+        info->keep_cache = 1;
+        return 0;
+    }
+
+    static int read(const char*, char* buffer, size_t size, off_t offset, struct fuse_file_info*) {
+        ssize_t got = self()->m_entry.read(buffer, size, static_cast<uint64_t>(offset));
+        return got < 0 ? -EIO : static_cast<int>(got);
+    }
+
+    static fuse_operations get() {
+        fuse_operations operations;
+        std::memset(&operations, 0, sizeof(operations));
+        operations.getattr = getattr;
+        operations.readdir = readdir;
+        operations.open = open;
+        operations.read = read;
+        return operations;
+    }
+};
+
+#endif
+
+DiscMount::~DiscMount() {
+    unmount();
+}
+
+bool DiscMount::isSupported() {
+#ifdef XEMURUN_HAVE_FUSE3
+    return access("/dev/fuse", R_OK | W_OK) == 0;
+#else
+    return false;
+#endif
+}
+
+bool DiscMount::mount(const std::string& packagePath, const std::string& entryPath) {
+    XEMURUN_TRACE_SCOPE("emulator", "DiscMount::mount", entryPath.c_str());
+
+    unmount();
+#ifdef XEMURUN_HAVE_FUSE3
+    if (!isSupported() || !m_entry.open(packagePath, entryPath)) {
+        return false;
+    }
+    m_indexPath = indexPathFor(packagePath);
+    m_entry.loadIndex(m_indexPath);
+    m_fileName = fs::path(entryPath).filename().string();
+
+    m_mountPoint = newMountPoint();
+    std::error_code ec;
+    fs::create_directories(m_mountPoint, ec);
+    if (ec) {
+        std::cerr << "Failed to create mount point " << m_mountPoint << ": " << ec.message() << std::endl;
+        m_entry.close();
+        return false;
+    }
+
+    static const fuse_operations operations = DiscMountOperations::get();
+    char program[] = "xemurun";
+    char optionFlag[] = "-o";
+    char options[] = "ro,default_permissions,fsname=xemurun,subtype=xemurun";
+    char* argv[] = {program, optionFlag, options, nullptr};
+    struct fuse_args args = FUSE_ARGS_INIT(3, argv);
+    m_fuse = fuse_new(&args, &operations, sizeof(operations), this);
+    fuse_opt_free_args(&args);
+
+    m_wakeFd = eventfd(0, EFD_CLOEXEC);
+    if (!m_fuse || m_wakeFd < 0 || fuse_mount(m_fuse, m_mountPoint.c_str()) != 0) {
+        std::cerr << "Failed to mount " << entryPath << " at " << m_mountPoint << std::endl;
+        if (m_fuse) {
+            fuse_destroy(m_fuse);
+            m_fuse = nullptr;
+        }
+        if (m_wakeFd >= 0) {
+            close(m_wakeFd);
+            m_wakeFd = -1;
+        }
+        rmdir(m_mountPoint.c_str());
+        m_entry.close();
+        return false;
+    }
+
+    m_thread = std::thread(&DiscMount::serve, this);
+    return true;
+#else
+    (void)packagePath;
+    return false;
+#endif
+}
+
+void DiscMount::serve() {
+#ifdef XEMURUN_HAVE_FUSE3
+    // fuse_loop() cannot be woken while it waits for a request; this loop
+    // also waits for unmount() to ask it to stop
+    struct fuse_session* session = fuse_get_session(m_fuse);
+    struct fuse_buf buffer;
+    std::memset(&buffer, 0, sizeof(buffer));
+    struct pollfd fds[2] = {{fuse_session_fd(session), POLLIN, 0}, {m_wakeFd, POLLIN, 0}};
+    while (!fuse_session_exited(session)) {
+        if (poll(fds, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        if (fds[1].revents) {
+            break;
+        }
+        int result = fuse_session_receive_buf(session, &buffer);
+        if (result == -EINTR || result == -EAGAIN) {
+            continue;
+        }
+        if (result <= 0) {
+            break; // unmounted from outside
+        }
+        fuse_session_process_buf(session, &buffer);
+    }
+    std::free(buffer.mem);
+#endif
+}
+
+void DiscMount::unmount() {
+#ifdef XEMURUN_HAVE_FUSE3
+    if (!m_fuse) {
+        return;
+    }
+
+    uint64_t wake = 1;
+    if (write(m_wakeFd, &wake, sizeof(wake)) < 0) {
+        std::cerr << "Failed to stop serving " << m_fileName << std::endl;
+    }
+    m_thread.join();
+
+    // A detaching unmount: requests still queued fail instead of hanging
+    fuse_unmount(m_fuse);
+    fuse_destroy(m_fuse);
+    m_fuse = nullptr;
+    close(m_wakeFd);
+    m_wakeFd = -1;
+    rmdir(m_mountPoint.c_str());
+
+    m_entry.saveIndex(m_indexPath);
+    m_entry.close();
+#endif
+}
+
+std::string DiscMount::getImagePath() const {
+    return (fs::path(m_mountPoint) / m_fileName).string();
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "../utils/seekable_entry.h"
+#include <string>
+#include <thread>
+
+struct fuse;
+
+namespace XEmuRun {
+
+/**
+ * @class DiscMount
+ * @brief Serves a disc image inside a package as a read-only file, so an
+ * emulator can open it without the package being extracted.
+ *
+ * The image is a single file in a private FUSE mount; reads are answered
+ * from the package through SeekableEntry. The inflater's checkpoints are
+ * kept below the user's cache directory, keyed like the extraction
+ * directory, so only the first launch of a title inflates up to the
+ * offsets the emulator seeks to.
+ *
+ * Requires libfuse3 at build time and /dev/fuse with fusermount3 at run
+ * time; mount() fails otherwise and the caller extracts instead.
+ */
+class DiscMount {
+public:
+    DiscMount() = default;
+    // Unmounts; the emulator must have exited
+    ~DiscMount();
+
+    DiscMount(const DiscMount&) = delete;
+    DiscMount& operator=(const DiscMount&) = delete;
+
+    static bool isSupported();
+
+    bool mount(const std::string& packagePath, const std::string& entryPath);
+    void unmount();
+
+    // Path of the image while mounted
+    std::string getImagePath() const;
+
+private:
+    friend struct DiscMountOperations;
+
+    void serve();
+
+    SeekableEntry m_entry;
+    std::string m_indexPath;
+    std::string m_mountPoint;
+    std::string m_fileName;
+    struct fuse* m_fuse = nullptr;
+    int m_wakeFd = -1;
+    std::thread m_thread;
+};
+
+} // namespace XEmuRun
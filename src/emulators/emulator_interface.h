@@ -1,23 +1,67 @@
 #pragma once
 
 #include <string>
-#include "../config/config.h"
+#include <vector>
+#include "../config/config_view.h"
 
 namespace XEmuRun {
 
 class Package;
 
+enum class EmulatorState {
+    Idle,       // Nothing prepared yet
+    Preparing,  // prepare() is running in the background
+    Ready,      // Prepared; launch() starts the game without further setup
+    Running,
+    Exited,
+    Failed      // Setup or start failed
+};
+
 class EmulatorInterface {
 public:
     virtual ~EmulatorInterface() = default;
     
+    // Expensive one-time setup: tool discovery, BIOS checks, core init
     virtual bool initialize() = 0;
-    virtual int launch(const Package& package) = 0;
+    
+    // Runs initialize() on a background thread and returns at once. Safe to
+    // call speculatively (e.g. when a game is selected) and more than once.
+    virtual void prepare() = 0;
+    // Stops a prepare that is still running and waits for it to wind down
+    virtual void cancelPrepare() = 0;
+    
+    // Asked once the configuration is applied. Backends that can run the
+    // title straight out of its archive return false, and launch() then
+    // gets a package that was opened but not extracted.
+    virtual bool requiresExtraction(const Package& package) = 0;
+    
+    // Environment ("NAME=value" strings) and working directory the game
+    // starts with instead of this process's, e.g. those of the client a
+    // daemon launches for. Takes effect at the next launch().
+    virtual void setLaunchEnvironment(const std::vector<std::string>& environment,
+                                      const std::string& workingDirectory) = 0;
+    
+    // Waits for any pending prepare, then starts the game. Returns false if
+    // it could not be started.
+    virtual bool launch(const Package& package) = 0;
+    // Blocks until the game exits and returns its exit code
+    virtual int waitFor() = 0;
+    // Cancels preparation and asks a running game to quit; callable from
+    // any thread. A game still starting is stopped as soon as it has
+    // started, and with no game at all the next launch() is cancelled.
+    virtual void terminate() = 0;
+    virtual EmulatorState getState() const = 0;
+    
     virtual std::string getName() const = 0;
     virtual std::string getSupportedPlatform() const = 0;
     
     // Configuration methods
-    virtual void applyConfig(const Config& config) = 0;
+    virtual void applyConfig(const ConfigView& config) = 0;
+    
+    // Called from the config watcher thread while a game is running, with
+    // the updated configuration and the names of the keys that changed.
+    // Returns true if every change took effect without a restart.
+    virtual bool onConfigChanged(const ConfigView& config, const std::vector<std::string>& changedKeys) = 0;
     virtual Config getDefaultConfig() const = 0;
 };
 
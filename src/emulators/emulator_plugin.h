@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstdint>
+#include "emulator_interface.h"
+
+// Bump whenever EmulatorInterface or XEmuRunEmulatorPlugin changes layout.
+// The host refuses to load plugins built against a different version.
+#define XEMURUN_EMULATOR_ABI_VERSION 6
+
+// Symbol every emulator plugin must export
+#define XEMURUN_EMULATOR_PLUGIN_ENTRY "xemurun_emulator_plugin"
+
+extern "C" {
+
+/**
+ * Descriptor returned by a plugin's entry point.
+ *
+ * Emulator objects are created and destroyed by the plugin itself, so the
+ * host never frees memory allocated on the other side of the boundary.
+ */
+struct XEmuRunEmulatorPlugin {
+    std::uint32_t abiVersion;
+    const char* name;
+    const char* const* platforms; // nullptr-terminated
+    XEmuRun::EmulatorInterface* (*create)(const char* platform);
+    void (*destroy)(XEmuRun::EmulatorInterface* emulator);
+};
+
+typedef const XEmuRunEmulatorPlugin* (*XEmuRunEmulatorPluginEntry)();
+
+} // extern "C"
+
+#define XEMURUN_EMULATOR_PLUGIN_EXPORT extern "C" __attribute__((visibility("default")))
@@ -0,0 +1,528 @@
+#include "linker_cache.h"
+#include "../utils/snapshot.h"
+#include "../utils/trace.h"
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <map>
+#include <set>
+#include <elf.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+// Next to the extraction marker, outside the game directory
+constexpr const char* kCacheName = ".xemurun-linker";
+// Snapshots of an earlier format are rebuilt
+constexpr int64_t kCacheFormat = 3;
+
+// The system loader's index of the libraries it finds without help
+constexpr const char* kLoaderCachePath = "/etc/ld.so.cache";
+
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+constexpr unsigned char kNativeElfData = ELFDATA2LSB;
+#else
+constexpr unsigned char kNativeElfData = ELFDATA2MSB;
+#endif
+
+// What the loader checks before it accepts a library for an executable;
+// a library of another class or machine is skipped as if it were missing
+struct ElfIdentity {
+    unsigned char elfClass = ELFCLASSNONE;
+    uint16_t machine = EM_NONE;
+
+    bool operator==(const ElfIdentity& other) const {
+        return elfClass == other.elfClass && machine == other.machine;
+    }
+};
+
+bool readIdentity(const std::string& path, ElfIdentity& identity) {
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    // e_machine directly follows e_ident and e_type in both classes
+    unsigned char header[EI_NIDENT + 4];
+    ssize_t count = pread(fd, header, sizeof(header), 0);
+    close(fd);
+    if (count != static_cast<ssize_t>(sizeof(header)) || std::memcmp(header, ELFMAG, SELFMAG) != 0 ||
+        header[EI_DATA] != kNativeElfData || (header[EI_CLASS] != ELFCLASS32 && header[EI_CLASS] != ELFCLASS64)) {
+        return false;
+    }
+    identity.elfClass = header[EI_CLASS];
+    std::memcpy(&identity.machine, header + EI_NIDENT + 2, sizeof(identity.machine));
+    return true;
+}
+
+bool matchesIdentity(const fs::path& path, const ElfIdentity& identity) {
+    ElfIdentity libraryIdentity;
+    return readIdentity(path.string(), libraryIdentity) && libraryIdentity == identity;
+}
+
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* mapping = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapping != MAP_FAILED) {
+                m_data = static_cast<const char*>(mapping);
+                m_size = static_cast<size_t>(st.st_size);
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile() {
+        if (m_data) {
+            munmap(const_cast<char*>(m_data), m_size);
+        }
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+};
+
+// DT_NEEDED entries and the DT_RUNPATH (or, without one, DT_RPATH) string
+// of one ELF class. Everything is bounds-checked: the files come from
+// packages, not from the system.
+template <typename Ehdr, typename Phdr, typename Dyn>
+bool readNeeded(const char* data, size_t size, std::vector<std::string>& needed, std::string& runPath) {
+    Ehdr header;
+    if (size < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+    if (header.e_phentsize != sizeof(Phdr) || header.e_phoff > size ||
+        header.e_phnum > (size - header.e_phoff) / sizeof(Phdr)) {
+        return false;
+    }
+
+    std::vector<Phdr> segments(header.e_phnum);
+    std::memcpy(segments.data(), data + header.e_phoff, segments.size() * sizeof(Phdr));
+
+    const Phdr* dynamic = nullptr;
+    for (const Phdr& segment : segments) {
+        if (segment.p_type == PT_DYNAMIC) {
+            dynamic = &segment;
+        }
+    }
+    if (!dynamic) {
+        return true; // statically linked
+    }
+    if (dynamic->p_offset > size || dynamic->p_filesz > size - dynamic->p_offset) {
+        return false;
+    }
+
+    // The dynamic section holds addresses; the loadable segments map them
+    // back to file offsets
+    auto toOffset = [&](uint64_t address, uint64_t& offset) {
+        for (const Phdr& segment : segments) {
+            if (segment.p_type == PT_LOAD && address >= segment.p_vaddr &&
+                address - segment.p_vaddr < segment.p_filesz) {
+                offset = segment.p_offset + (address - segment.p_vaddr);
+                return true;
+            }
+        }
+        return false;
+    };
+
+    std::vector<uint64_t> nameOffsets;
+    uint64_t runPathOffset = 0;
+    bool haveRunPath = false;
+    bool haveRPath = false;
+    uint64_t strtab = 0;
+    uint64_t strsz = 0;
+    bool haveStrtab = false;
+    size_t count = dynamic->p_filesz / sizeof(Dyn);
+    for (size_t i = 0; i < count; ++i) {
+        Dyn entry;
+        std::memcpy(&entry, data + dynamic->p_offset + i * sizeof(Dyn), sizeof(entry));
+        if (entry.d_tag == DT_NULL) {
+            break;
+        }
+        if (entry.d_tag == DT_NEEDED) {
+            nameOffsets.push_back(entry.d_un.d_val);
+        } else if (entry.d_tag == DT_RUNPATH) {
+            // The linker ignores DT_RPATH when both are present
+            runPathOffset = entry.d_un.d_val;
+            haveRunPath = true;
+        } else if (entry.d_tag == DT_RPATH && !haveRunPath) {
+            runPathOffset = entry.d_un.d_val;
+            haveRPath = true;
+        } else if (entry.d_tag == DT_STRTAB) {
+            haveStrtab = toOffset(entry.d_un.d_ptr, strtab);
+        } else if (entry.d_tag == DT_STRSZ) {
+            strsz = entry.d_un.d_val;
+        }
+    }
+
+    if (nameOffsets.empty()) {
+        return true;
+    }
+    if (!haveStrtab || strtab > size || strsz > size - strtab) {
+        return false;
+    }
+    auto readString = [&](uint64_t offset, std::string& value) {
+        if (offset >= strsz) {
+            return false;
+        }
+        const char* string = data + strtab + offset;
+        value.assign(string, strnlen(string, static_cast<size_t>(strsz - offset)));
+        return true;
+    };
+    for (uint64_t nameOffset : nameOffsets) {
+        std::string name;
+        if (!readString(nameOffset, name)) {
+            return false;
+        }
+        needed.push_back(std::move(name));
+    }
+    if ((haveRunPath || haveRPath) && !readString(runPathOffset, runPath)) {
+        return false;
+    }
+    return true;
+}
+
+// The directories of a DT_RUNPATH string, with $ORIGIN expanded to the
+// object's directory. Entries using other tokens ($LIB, $PLATFORM) depend
+// on the system and are skipped.
+std::vector<fs::path> expandRunPath(const std::string& runPath, const fs::path& origin) {
+    std::vector<fs::path> directories;
+    size_t start = 0;
+    while (start <= runPath.size()) {
+        size_t end = runPath.find(':', start);
+        std::string directory = runPath.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        start = end == std::string::npos ? runPath.size() + 1 : end + 1;
+
+        for (const char* token : {"${ORIGIN}", "$ORIGIN"}) {
+            for (size_t at = directory.find(token); at != std::string::npos; at = directory.find(token, at)) {
+                directory.replace(at, std::strlen(token), origin.string());
+                at += origin.string().size();
+            }
+        }
+        if (directory.empty() || directory.find('$') != std::string::npos) {
+            continue;
+        }
+        directories.push_back(fs::path(directory).lexically_normal());
+    }
+    return directories;
+}
+
+bool readNeededLibraries(const std::string& path, std::vector<std::string>& needed,
+                         std::vector<fs::path>& runPath) {
+    MappedFile file(path);
+    const char* data = file.data();
+    if (!data || file.size() < EI_NIDENT || std::memcmp(data, ELFMAG, SELFMAG) != 0 ||
+        static_cast<unsigned char>(data[EI_DATA]) != kNativeElfData) {
+        return false;
+    }
+
+    std::string runPathString;
+    bool parsed = false;
+    switch (data[EI_CLASS]) {
+    case ELFCLASS32:
+        parsed = readNeeded<Elf32_Ehdr, Elf32_Phdr, Elf32_Dyn>(data, file.size(), needed, runPathString);
+        break;
+    case ELFCLASS64:
+        parsed = readNeeded<Elf64_Ehdr, Elf64_Phdr, Elf64_Dyn>(data, file.size(), needed, runPathString);
+        break;
+    default:
+        return false;
+    }
+    runPath = expandRunPath(runPathString, fs::path(path).parent_path());
+    return parsed;
+}
+
+// Library paths by file name from the loader's cache. Only the current
+// format is read: glibc has written it, alone or after the old one, since
+// 2.2. Everything is bounds-checked like the ELF files.
+std::multimap<std::string, std::string> readLoaderCache() {
+    std::multimap<std::string, std::string> libraries;
+    MappedFile file(kLoaderCachePath);
+    const char* data = file.data();
+    size_t size = file.size();
+    if (!data) {
+        return libraries;
+    }
+
+    // The old format's header and 12-byte entries, then the new format
+    // aligned to 8 bytes
+    size_t start = 0;
+    const char oldMagic[] = "ld.so-1.7.0";
+    if (size >= 16 && std::memcmp(data, oldMagic, sizeof(oldMagic) - 1) == 0) {
+        uint32_t oldCount;
+        std::memcpy(&oldCount, data + 12, sizeof(oldCount));
+        start = (16 + static_cast<size_t>(oldCount) * 12 + 7) & ~static_cast<size_t>(7);
+    }
+
+    const char newMagic[] = "glibc-ld.so.cache1.1";
+    constexpr size_t kHeaderSize = 48;
+    constexpr size_t kEntrySize = 24;
+    if (start > size || size - start < kHeaderSize || std::memcmp(data + start, newMagic, sizeof(newMagic) - 1) != 0) {
+        return libraries;
+    }
+    const char* cache = data + start;
+    size_t cacheSize = size - start;
+
+    uint32_t count;
+    std::memcpy(&count, cache + 20, sizeof(count));
+    if (count > (cacheSize - kHeaderSize) / kEntrySize) {
+        return libraries;
+    }
+
+    // Strings are offsets from the new format's header
+    auto readString = [&](uint32_t offset, std::string& value) {
+        if (offset >= cacheSize) {
+            return false;
+        }
+        value.assign(cache + offset, strnlen(cache + offset, cacheSize - offset));
+        return true;
+    };
+    for (uint32_t i = 0; i < count; ++i) {
+        const char* entry = cache + kHeaderSize + static_cast<size_t>(i) * kEntrySize;
+        uint32_t keyOffset;
+        uint32_t valueOffset;
+        std::memcpy(&keyOffset, entry + 4, sizeof(keyOffset));
+        std::memcpy(&valueOffset, entry + 8, sizeof(valueOffset));
+        std::string name;
+        std::string path;
+        if (readString(keyOffset, name) && readString(valueOffset, path)) {
+            libraries.emplace(std::move(name), std::move(path));
+        }
+    }
+    return libraries;
+}
+
+int64_t loaderCacheMtimeNs() {
+    struct stat st;
+    if (stat(kLoaderCachePath, &st) != 0) {
+        return 0;
+    }
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+// Every bundled library the executable can load, by file name, which is
+// what DT_NEEDED names; copies for another class or machine (bin/x86
+// next to bin/x86_64) are left out. A name found twice resolves to the
+// shallowest, then alphabetically first, path.
+std::map<std::string, fs::path> indexLibraries(const fs::path& gameDirectory, const ElfIdentity& identity) {
+    std::map<std::string, fs::path> libraries;
+    std::map<std::string, int> depths;
+    std::error_code ec;
+    auto options = fs::directory_options::skip_permission_denied;
+    for (fs::recursive_directory_iterator it(gameDirectory, options, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        std::error_code typeError;
+        if (name.find(".so") == std::string::npos || !it->is_regular_file(typeError) ||
+            !matchesIdentity(it->path(), identity)) {
+            continue;
+        }
+
+        auto existing = libraries.find(name);
+        if (existing == libraries.end() || it.depth() < depths[name] ||
+            (it.depth() == depths[name] && it->path() < existing->second)) {
+            libraries[name] = it->path();
+            depths[name] = it.depth();
+        }
+    }
+    return libraries;
+}
+
+} // namespace
+
+bool LinkerCache::build(const std::string& extractedPath, const std::string& mainExecutable) {
+    XEMURUN_TRACE_SCOPE("emulator", "LinkerCache::build");
+
+    m_runPath.clear();
+    m_searchPath.clear();
+    m_files.clear();
+
+    fs::path gameDirectory = fs::path(extractedPath) / "game";
+    std::string executablePath = (gameDirectory / mainExecutable).string();
+    std::string cachePath = (fs::path(extractedPath) / kCacheName).string();
+
+    // Stat'ed before the scan, like a JSON file before it is read
+    SnapshotSource source;
+    if (!statSnapshotSource(executablePath, source)) {
+        return false;
+    }
+
+    if (loadSnapshot(cachePath, gameDirectory.string(), source)) {
+        return true;
+    }
+
+    resolve(gameDirectory.string(), executablePath);
+    writeSnapshot(cachePath, gameDirectory.string(), source);
+    return true;
+}
+
+bool LinkerCache::loadSnapshot(const std::string& cachePath, const std::string& gameDirectory,
+                               const SnapshotSource& source) {
+    SnapshotReader snapshot;
+    if (!snapshot.open(cachePath, SnapshotKind::LinkerCache, source)) {
+        return false;
+    }
+
+    // What the system provides decides what is bundled-only, so an
+    // ldconfig run since the scan redoes it
+    SnapshotEntry entry;
+    if (!snapshot.next(entry) || entry.key != "format" || entry.intValue != kCacheFormat ||
+        !snapshot.next(entry) || entry.key != "system" || entry.intValue != loaderCacheMtimeNs()) {
+        return false;
+    }
+    while (snapshot.next(entry)) {
+        std::string path = (fs::path(gameDirectory) / std::string(entry.stringValue)).lexically_normal().string();
+        if (entry.key == "runpath") {
+            m_runPath.push_back(std::move(path));
+        } else if (entry.key == "dir") {
+            m_searchPath.push_back(std::move(path));
+        } else if (entry.key == "file") {
+            m_files.push_back(std::move(path));
+        }
+    }
+    return true;
+}
+
+void LinkerCache::resolve(const std::string& gameDirectory, const std::string& executablePath) {
+    m_files.push_back(executablePath);
+    ElfIdentity identity;
+    if (!readIdentity(executablePath, identity)) {
+        return;
+    }
+
+    std::map<std::string, fs::path> bundled = indexLibraries(gameDirectory, identity);
+    std::multimap<std::string, std::string> system = readLoaderCache();
+    std::set<std::string> seen;
+    std::set<std::string> runPathDirectories;
+    std::set<std::string> directories;
+
+    // The loader's default directories back up its cache
+    auto systemProvides = [&](const std::string& name) {
+        auto [first, last] = system.equal_range(name);
+        for (auto it = first; it != last; ++it) {
+            if (matchesIdentity(it->second, identity)) {
+                return true;
+            }
+        }
+        for (const char* directory : {"/lib64", "/usr/lib64", "/lib", "/usr/lib"}) {
+            if (matchesIdentity(fs::path(directory) / name, identity)) {
+                return true;
+            }
+        }
+        return false;
+    };
+
+    // Breadth first, the order in which the linker loads them
+    std::deque<std::string> pending = {executablePath};
+    while (!pending.empty()) {
+        std::vector<std::string> needed;
+        std::vector<fs::path> runPath;
+        readNeededLibraries(pending.front(), needed, runPath);
+        pending.pop_front();
+
+        for (const std::string& name : needed) {
+            if (seen.count(name)) {
+                continue;
+            }
+
+            // What the object's own DT_RUNPATH finds is what the game was
+            // built to load; its directory is only kept so LD_LIBRARY_PATH
+            // can list it ahead of the bundled ones
+            bool inRunPath = false;
+            for (const fs::path& runPathDirectory : runPath) {
+                fs::path candidate = runPathDirectory / name;
+                if (!matchesIdentity(candidate, identity)) {
+                    continue;
+                }
+                seen.insert(name);
+                if (runPathDirectories.insert(runPathDirectory.string()).second) {
+                    m_runPath.push_back(runPathDirectory.string());
+                }
+                m_files.push_back(candidate.string());
+                pending.push_back(candidate.string());
+                inRunPath = true;
+                break;
+            }
+            if (inRunPath) {
+                continue;
+            }
+
+            // Left to the system when it has the library: bundled copies
+            // such as libstdc++ are fallbacks for older distributions
+            if (systemProvides(name)) {
+                seen.insert(name);
+                continue;
+            }
+
+            auto library = bundled.find(name);
+            if (library == bundled.end()) {
+                continue;
+            }
+            seen.insert(name);
+
+            std::string directory = library->second.parent_path().string();
+            if (directories.insert(directory).second) {
+                m_searchPath.push_back(directory);
+            }
+            m_files.push_back(library->second.string());
+            pending.push_back(library->second.string());
+        }
+    }
+}
+
+void LinkerCache::writeSnapshot(const std::string& cachePath, const std::string& gameDirectory,
+                                const SnapshotSource& source) const {
+    // Relative to the game directory, one entry per path in order
+    SnapshotWriter writer(SnapshotKind::LinkerCache);
+    writer.addInt("format", kCacheFormat);
+    writer.addInt("system", loaderCacheMtimeNs());
+    for (const std::string& directory : m_runPath) {
+        writer.addString("runpath", fs::path(directory).lexically_relative(gameDirectory).string());
+    }
+    for (const std::string& directory : m_searchPath) {
+        writer.addString("dir", fs::path(directory).lexically_relative(gameDirectory).string());
+    }
+    for (const std::string& file : m_files) {
+        writer.addString("file", fs::path(file).lexically_relative(gameDirectory).string());
+    }
+    writer.commitAsync(cachePath, source);
+}
+
+void LinkerCache::warmPageCache() const {
+    XEMURUN_TRACE_SCOPE("emulator", "LinkerCache::warmPageCache");
+
+    for (const std::string& file : m_files) {
+        int fd = open(file.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        struct stat st;
+        if (fstat(fd, &st) == 0) {
+            // Queues the reads and returns; the linker's faults find the
+            // pages in flight or already cached
+            ::readahead(fd, 0, static_cast<size_t>(st.st_size));
+        }
+        close(fd);
+    }
+}
+
+} // namespace XEmuRun
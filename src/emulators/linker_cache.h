@@ -0,0 +1,63 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace XEmuRun {
+
+struct SnapshotSource;
+
+/**
+ * @class LinkerCache
+ * @brief The bundled shared libraries a native title loads, and from where.
+ *
+ * Ports often ship hundreds of .so files below game/, and the dynamic
+ * linker probes every directory on LD_LIBRARY_PATH for each DT_NEEDED
+ * entry. build() follows the executable's DT_NEEDED entries through the
+ * bundled libraries once, keeping only the directories that resolve
+ * something, in the order the linker first needs them. Only libraries the
+ * system does not provide count: LD_LIBRARY_PATH goes ahead of the system
+ * directories, and bundled copies of system libraries (libstdc++,
+ * libgcc_s) are meant for older distributions. Bundled files of another
+ * ELF class or machine than the executable are never picked.
+ *
+ * LD_LIBRARY_PATH is searched before DT_RUNPATH, so a library the
+ * requesting object's own DT_RUNPATH finds does not add its directory to
+ * the search path; the DT_RUNPATH directories that resolved something are
+ * kept apart, to be listed ahead of the bundled directories.
+ *
+ * The result is kept as a snapshot in the extraction directory, keyed to
+ * the executable and to the system's /etc/ld.so.cache, so later launches
+ * of the same extraction skip the scan.
+ */
+class LinkerCache {
+public:
+    // extractedPath is the package's extraction, mainExecutable relative
+    // to its game directory
+    bool build(const std::string& extractedPath, const std::string& mainExecutable);
+
+    // Absolute directories for LD_LIBRARY_PATH; empty if nothing bundled
+    // is needed outside of DT_RUNPATH
+    const std::vector<std::string>& getSearchPath() const { return m_searchPath; }
+    // Absolute DT_RUNPATH directories that resolved a library; they go
+    // ahead of getSearchPath() so the bundled directories cannot shadow them
+    const std::vector<std::string>& getRunPath() const { return m_runPath; }
+    // Absolute paths of the executable and the bundled libraries it loads
+    const std::vector<std::string>& getFiles() const { return m_files; }
+
+    // Starts reading the files into the page cache, so the linker finds
+    // them there instead of waiting on the disk
+    void warmPageCache() const;
+
+private:
+    bool loadSnapshot(const std::string& cachePath, const std::string& gameDirectory, const SnapshotSource& source);
+    void resolve(const std::string& gameDirectory, const std::string& executablePath);
+    void writeSnapshot(const std::string& cachePath, const std::string& gameDirectory,
+                       const SnapshotSource& source) const;
+
+    std::vector<std::string> m_runPath;
+    std::vector<std::string> m_searchPath;
+    std::vector<std::string> m_files;
+};
+
+} // namespace XEmuRun
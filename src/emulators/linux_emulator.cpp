@@ -1,13 +1,30 @@
 #include "linux_emulator.h"
+#include "emulator_plugin.h"
+#include "linker_cache.h"
+#include "../utils/archive.h"
+#include "../utils/trace.h"
 #include <iostream>
 #include <filesystem>
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
 #include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
 namespace XEmuRun {
 
+namespace {
+
+// MFD_EXEC, which older headers lack. Required where the vm.memfd_noexec
+// sysctl makes memfds non-executable by default; older kernels reject it.
+constexpr unsigned int kMemfdExec = 0x0010U;
+
+} // namespace
+
 LinuxEmulator::LinuxEmulator()
     : BaseEmulator("Native Linux", "linux") {
 }
@@ -15,6 +32,8 @@ LinuxEmulator::LinuxEmulator()
 LinuxEmulator::~LinuxEmulator() = default;
 
 bool LinuxEmulator::initialize() {
+    XEMURUN_TRACE_SCOPE("emulator", "LinuxEmulator::initialize");
+    
     if (!BaseEmulator::initialize()) {
         return false;
     }
@@ -28,31 +47,138 @@ bool LinuxEmulator::setupEnvironment() {
     return true;
 }
 
-int LinuxEmulator::launch(const Package& package) {
-    if (!m_initialized && !initialize()) {
-        std::cerr << "Failed to initialize Linux emulator" << std::endl;
-        return 1;
+bool LinuxEmulator::requiresExtraction(const Package& package) {
+    XEMURUN_TRACE_SCOPE("emulator", "LinuxEmulator::requiresExtraction");
+    
+    // An existing extraction costs nothing to use
+    int maxMb = m_config.get(Keys::DisklessLaunchMaxMb);
+    if (maxMb <= 0 || !package.getExtractedPath().empty()) {
+        return true;
+    }
+    
+    std::vector<ArchiveEntryInfo> entries;
+    if (!listArchive(package.getPackagePath(), entries)) {
+        return true;
+    }
+    
+    // A memfd has no directory around it, so any other file in the game
+    // directory, e.g. an asset the binary opens by a relative path, needs
+    // the title extracted
+    std::string executable = "game/" + package.getMainExecutable();
+    bool found = false;
+    for (const ArchiveEntryInfo& entry : entries) {
+        if (entry.isDirectory || entry.path.rfind("game/", 0) != 0) {
+            continue;
+        }
+        if (entry.path != executable || entry.size > (static_cast<uint64_t>(maxMb) << 20)) {
+            return true;
+        }
+        found = true;
+    }
+    return !found;
+}
+
+bool LinuxEmulator::startGame(const Package& package) {
+    if (package.getExtractedPath().empty()) {
+        return startFromMemory(package);
     }
     
     std::string executablePath = (fs::path(package.getExtractedPath()) / "game" / package.getMainExecutable()).string();
     
     if (!fs::exists(executablePath)) {
         std::cerr << "Executable not found: " << executablePath << std::endl;
-        return 1;
+        return false;
     }
     
     // Make the file executable
-    std::string chmodCmd = "chmod +x \"" + executablePath + "\"";
-    std::system(chmodCmd.c_str());
+    std::error_code ec;
+    fs::permissions(executablePath, fs::perms::owner_exec | fs::perms::group_exec | fs::perms::others_exec,
+                    fs::perm_options::add, ec);
+    if (ec) {
+        std::cerr << "Failed to make " << executablePath << " executable: " << ec.message() << std::endl;
+    }
+    
+    // Bundled libraries: the linker only probes directories that resolve
+    // something, and finds the files already on their way into memory
+    Process::Environment environment;
+    LinkerCache linkerCache;
+    if (linkerCache.build(package.getExtractedPath(), package.getMainExecutable()) &&
+        !linkerCache.getSearchPath().empty()) {
+        // DT_RUNPATH directories first: LD_LIBRARY_PATH is searched before
+        // them, and must not change what they resolve
+        std::string searchPath;
+        for (const std::string& directory : linkerCache.getRunPath()) {
+            searchPath += (searchPath.empty() ? "" : ":") + directory;
+        }
+        for (const std::string& directory : linkerCache.getSearchPath()) {
+            searchPath += (searchPath.empty() ? "" : ":") + directory;
+        }
+        if (const char* inherited = getLaunchVariable("LD_LIBRARY_PATH"); inherited && *inherited) {
+            searchPath += std::string(":") + inherited;
+        }
+        environment.emplace_back("LD_LIBRARY_PATH", searchPath);
+    }
+    linkerCache.warmPageCache();
     
     // Prepare command
-    std::string command = "\"" + executablePath + "\"";
+    std::vector<std::string> command = {executablePath};
     
     std::cout << "Launching Linux application: " << executablePath << std::endl;
-    std::cout << "Command: " << command << std::endl;
+    std::cout << "Command: " << formatCommandLine(command) << std::endl;
     
-    // Execute the command
-    return std::system(command.c_str());
+    return m_process.spawn(command, environment);
+}
+
+bool LinuxEmulator::startFromMemory(const Package& package) {
+    XEMURUN_TRACE_SCOPE("emulator", "LinuxEmulator::startFromMemory");
+    
+    std::string name = fs::path(package.getMainExecutable()).filename().string();
+    int fd = memfd_create(name.c_str(), MFD_CLOEXEC | kMemfdExec);
+    if (fd < 0 && errno == EINVAL) {
+        fd = memfd_create(name.c_str(), MFD_CLOEXEC);
+    }
+    if (fd < 0) {
+        std::cerr << "Failed to create memory file for " << name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    
+    if (!readArchiveEntry(package.getPackagePath(), "game/" + package.getMainExecutable(), fd)) {
+        std::cerr << "Failed to read executable from " << package.getPackagePath() << std::endl;
+        close(fd);
+        return false;
+    }
+    
+    // exec refuses a file that is still open for writing, so the child gets
+    // a read-only descriptor. It stays open across exec for the interpreter
+    // of a script; an ELF binary just inherits one spare descriptor.
+    int execFd = open(("/proc/self/fd/" + std::to_string(fd)).c_str(), O_RDONLY);
+    close(fd);
+    if (execFd < 0) {
+        std::cerr << "Failed to reopen memory file for " << name << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    
+    std::vector<std::string> command = {name};
+    
+    std::cout << "Launching Linux application from memory: " << package.getMainExecutable() << std::endl;
+    
+    // The running image keeps the memfd alive
+    bool started = m_process.spawnFd(execFd, command);
+    close(execFd);
+    return started;
 }
 
 } // namespace XEmuRun
+
+// Plugin entry point used by EmulatorRegistry
+XEMURUN_EMULATOR_PLUGIN_EXPORT const XEmuRunEmulatorPlugin* xemurun_emulator_plugin() {
+    static const char* const platforms[] = { "linux", nullptr };
+    static const XEmuRunEmulatorPlugin plugin = {
+        XEMURUN_EMULATOR_ABI_VERSION,
+        "Native Linux",
+        platforms,
+        [](const char*) -> XEmuRun::EmulatorInterface* { return new XEmuRun::LinuxEmulator(); },
+        [](XEmuRun::EmulatorInterface* emulator) { delete emulator; }
+    };
+    return &plugin;
+}
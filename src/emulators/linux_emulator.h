@@ -11,10 +11,18 @@ public:
     ~LinuxEmulator() override;
     
     bool initialize() override;
-    int launch(const Package& package) override;
+    
+    // False for titles whose game directory holds nothing but an executable
+    // of at most diskless_launch_max_mb; those run from memory
+    bool requiresExtraction(const Package& package) override;
+    
+protected:
+    bool startGame(const Package& package) override;
     
 private:
     bool setupEnvironment();
+    // Inflates the executable into a memfd and starts it from there
+    bool startFromMemory(const Package& package);
 };
 
 } // namespace XEmuRun
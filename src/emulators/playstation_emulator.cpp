@@ -1,4 +1,6 @@
 #include "playstation_emulator.h"
+#include "emulator_plugin.h"
+#include "../utils/trace.h"
 #include <iostream>
 #include <filesystem>
 #include <cstdlib>
@@ -8,6 +10,8 @@
 #include <random>
 #include <sstream>
 #include <atomic>
+#include <algorithm>
+#include <memory>
 // Add necessary Qt headers
 #include <QtWidgets/QApplication>
 #include <QtWidgets/QMainWindow>
@@ -19,6 +23,8 @@
 #include <QtWidgets/QStatusBar>
 #include <QtGui/QCloseEvent>
 #include <QtCore/QFileInfo>
+#include <QtCore/QThread>
+#include <QtCore/QMetaObject>
 
 namespace fs = std::filesystem;
 
@@ -27,7 +33,8 @@ namespace XEmuRun {
 // Simple game window class for visualization
 class GameWindow : public QMainWindow {
 public:
-    GameWindow(const QString& title, const QString& gamePath) : m_running(true), m_frames(0) {
+    GameWindow(const QString& title, const QString& gamePath)
+        : m_running(true), m_frames(0), m_outputWidth(1280), m_outputHeight(720), m_renderingScale(100) {
         setWindowTitle(title);
         resize(1280, 720);
         
@@ -68,6 +75,26 @@ public:
         return m_running;
     }
     
+    // Picks up settings changed since the last frame and returns the frame
+    // interval to use. Must be called on the GUI thread.
+    std::chrono::milliseconds applySettings(const PlayStationLiveSettings& settings) {
+        int width = settings.resolutionWidth.load(std::memory_order_relaxed);
+        int height = settings.resolutionHeight.load(std::memory_order_relaxed);
+        int scale = settings.renderingScale.load(std::memory_order_relaxed);
+        
+        if (width != m_outputWidth || height != m_outputHeight || scale != m_renderingScale) {
+            m_outputWidth = width;
+            m_outputHeight = height;
+            m_renderingScale = scale;
+            statusBar()->showMessage(QString("Output %1x%2, rendering at %3%")
+                                     .arg(width).arg(height).arg(scale));
+        }
+        
+        // Without vsync, only yield briefly between frames
+        return settings.vsync.load(std::memory_order_relaxed) ? std::chrono::milliseconds(16)
+                                                              : std::chrono::milliseconds(1);
+    }
+    
 protected:
     void closeEvent(QCloseEvent* event) override {
         m_running = false;
@@ -78,8 +105,10 @@ private slots:
     void renderFrame() {
         if (!m_running) return;
         
-        // Create a frame image
-        QImage image(1280, 720, QImage::Format_RGB32);
+        // Create a frame image at the internal rendering resolution
+        int renderWidth = std::max(1, m_outputWidth * m_renderingScale / 100);
+        int renderHeight = std::max(1, m_outputHeight * m_renderingScale / 100);
+        QImage image(renderWidth, renderHeight, QImage::Format_RGB32);
         QPainter painter(&image);
         
         // Fill background
@@ -93,8 +122,8 @@ private slots:
         for (int i = 0; i < 10; i++) {
             painter.setPen(Qt::NoPen);
             painter.setBrush(QColor(100 + i*15, 100 + (i*20) % 155, 200));
-            painter.drawEllipse(640 + 200 * std::cos((offset + i*36) * 3.14159/180), 
-                               360 + 200 * std::sin((offset + i*36) * 3.14159/180), 
+            painter.drawEllipse(renderWidth / 2 + 200 * std::cos((offset + i*36) * 3.14159/180), 
+                               renderHeight / 2 + 200 * std::sin((offset + i*36) * 3.14159/180), 
                                40, 40);
         }
         
@@ -106,10 +135,10 @@ private slots:
         // Draw frame counter and game info at bottom
         painter.setFont(QFont("Arial", 10));
         painter.setPen(Qt::lightGray);
-        painter.drawText(10, 700, QString("Frame: %1").arg(m_frames));
+        painter.drawText(10, renderHeight - 20, QString("Frame: %1").arg(m_frames));
         
-        // Display the frame
-        m_gameDisplay->setPixmap(QPixmap::fromImage(image));
+        // Display the frame, scaled to the display area
+        m_gameDisplay->setPixmap(QPixmap::fromImage(image).scaled(m_gameDisplay->size(), Qt::KeepAspectRatio));
         
         // Update frame counter and FPS
         m_frames++;
@@ -128,12 +157,90 @@ private:
     std::atomic<bool> m_running;
     int m_frames;
     std::chrono::time_point<std::chrono::steady_clock> m_startTime;
+    int m_outputWidth;
+    int m_outputHeight;
+    int m_renderingScale;
 };
 
+namespace {
+
+// Runs fn on the thread that owns the QApplication and waits for it. The
+// game runs on a thread of its own, which must never touch widgets that
+// live on another one.
+template <typename Fn>
+void runOnGuiThread(QCoreApplication* app, Fn fn) {
+    if (app->thread() == QThread::currentThread()) {
+        fn();
+    } else {
+        QMetaObject::invokeMethod(app, fn, Qt::BlockingQueuedConnection);
+    }
+}
+
+// The emulation loop shared by both cores. Called on the game thread; the
+// window is shown by the thread that owns the application, which the
+// launching program creates before it launches the game.
+void runGameWindow(const char* title, const std::string& gamePath, const PlayStationLiveSettings* liveSettings) {
+    QCoreApplication* app = QCoreApplication::instance();
+    if (!app) {
+        std::cerr << "No QApplication to show the game window in" << std::endl;
+        return;
+    }
+    const bool onGuiThread = app->thread() == QThread::currentThread();
+    
+    GameWindow* window = nullptr;
+    runOnGuiThread(app, [&] {
+        window = new GameWindow(title, QString::fromStdString(gamePath));
+        window->show();
+    });
+    
+    // Create a thread to monitor keyboard input from console
+    auto running = std::make_shared<std::atomic<bool>>(true);
+    std::thread inputThread([running]() {
+        std::cin.get(); // Wait for Enter key
+        *running = false;
+    });
+    inputThread.detach();
+    
+    // Main emulation loop
+    int frames = 0;
+    auto startTime = std::chrono::steady_clock::now();
+    
+    while (*running && window->isRunning() && !(liveSettings && liveSettings->stopRequested)) {
+        // Otherwise the GUI thread keeps the window responsive
+        if (onGuiThread) {
+            app->processEvents();
+        }
+        
+        // Simulate frame execution, honouring settings changed mid-game
+        std::chrono::milliseconds frameInterval(16); // ~60 FPS
+        if (liveSettings) {
+            runOnGuiThread(app, [&] { frameInterval = window->applySettings(*liveSettings); });
+        }
+        std::this_thread::sleep_for(frameInterval);
+        frames++;
+        
+        if (frames % 60 == 0) {
+            auto currentTime = std::chrono::steady_clock::now();
+            auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(currentTime - startTime).count();
+            std::cout << "Emulation running: " << frames << " frames, " 
+                      << elapsed << " seconds elapsed (Game is running...) \r" << std::flush;
+        }
+    }
+    
+    // Clean up
+    runOnGuiThread(app, [&] { delete window; });
+}
+
+} // namespace
+
 // Define the PS4Core class instead of just forward-declaring it
 class XEmuPS4Core {
 public:
-    XEmuPS4Core() : m_initialized(false), m_vulkanSupport(false) {}
+    XEmuPS4Core() : m_initialized(false), m_vulkanSupport(false), m_liveSettings(nullptr) {}
+    
+    void setLiveSettings(const PlayStationLiveSettings* settings) {
+        m_liveSettings = settings;
+    }
     
     bool initialize(const std::string& biosPath) {
         std::cout << "Initializing XEmuPS4 Core..." << std::endl;
@@ -243,57 +350,7 @@ private:
         std::cout << "A window should open with placeholder graphics." << std::endl;
         std::cout << "Close the window or press Enter in this console to exit emulation...\n" << std::endl;
         
-        // Create and show a game window
-        int argc = 0;
-        char** argv = nullptr;
-        QCoreApplication* qapp = QApplication::instance();
-        QApplication* app = qobject_cast<QApplication*>(qapp); // Cast properly
-        bool ownApp = false;
-        
-        if (!app) {
-            static int staticArgc = 1;
-            static char* staticArgv[] = { const_cast<char*>("xemurun") };
-            argc = staticArgc;
-            argv = staticArgv;
-            app = new QApplication(argc, argv);
-            ownApp = true;
-        }
-        
-        GameWindow window("XEmuRun PlayStation 4 Emulation", QString::fromStdString(m_gamePath));
-        window.show();
-        
-        // Create a thread to monitor keyboard input from console
-        bool running = true;
-        std::thread inputThread([&running]() {
-            std::cin.get(); // Wait for Enter key
-            running = false;
-        });
-        inputThread.detach();
-        
-        // Main emulation loop
-        int frames = 0;
-        auto startTime = std::chrono::steady_clock::now();
-        
-        while (running && window.isRunning()) {
-            // Process Qt events to keep the UI responsive
-            app->processEvents();
-            
-            // Simulate frame execution
-            std::this_thread::sleep_for(std::chrono::milliseconds(16)); // ~60 FPS
-            frames++;
-            
-            if (frames % 60 == 0) {
-                auto currentTime = std::chrono::steady_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(currentTime - startTime).count();
-                std::cout << "Emulation running: " << frames << " frames, " 
-                          << elapsed << " seconds elapsed (Game is running...) \r" << std::flush;
-            }
-        }
-        
-        // Clean up
-        if (ownApp) {
-            delete app;
-        }
+        runGameWindow("XEmuRun PlayStation 4 Emulation", m_gamePath, m_liveSettings);
         
         std::cout << "\n\nEmulation terminated. Thank you for using XEmuRun!" << std::endl;
         std::cout << "=================================================================" << std::endl;
@@ -303,12 +360,17 @@ private:
     bool m_vulkanSupport;
     std::string m_biosPath;
     std::string m_gamePath;
+    const PlayStationLiveSettings* m_liveSettings;
 };
 
 // Define the PS5Core class instead of just forward-declaring it
 class XEmuPS5Core {
 public:
-    XEmuPS5Core() : m_initialized(false), m_rayTracingEnabled(false) {}
+    XEmuPS5Core() : m_initialized(false), m_rayTracingEnabled(false), m_liveSettings(nullptr) {}
+    
+    void setLiveSettings(const PlayStationLiveSettings* settings) {
+        m_liveSettings = settings;
+    }
     
     bool initialize(const std::string& biosPath) {
         std::cout << "Initializing XEmuPS5 Core..." << std::endl;
@@ -426,57 +488,7 @@ private:
         std::cout << "A window should open with placeholder graphics." << std::endl;
         std::cout << "Close the window or press Enter in this console to exit emulation...\n" << std::endl;
         
-        // Create and show a game window
-        int argc = 0;
-        char** argv = nullptr;
-        QCoreApplication* qapp = QApplication::instance();
-        QApplication* app = qobject_cast<QApplication*>(qapp); // Cast properly
-        bool ownApp = false;
-        
-        if (!app) {
-            static int staticArgc = 1;
-            static char* staticArgv[] = { const_cast<char*>("xemurun") };
-            argc = staticArgc;
-            argv = staticArgv;
-            app = new QApplication(argc, argv);
-            ownApp = true;
-        }
-        
-        GameWindow window("XEmuRun PlayStation 5 Emulation", QString::fromStdString(m_gamePath));
-        window.show();
-        
-        // Create a thread to monitor keyboard input from console
-        bool running = true;
-        std::thread inputThread([&running]() {
-            std::cin.get(); // Wait for Enter key
-            running = false;
-        });
-        inputThread.detach();
-        
-        // Main emulation loop
-        int frames = 0;
-        auto startTime = std::chrono::steady_clock::now();
-        
-        while (running && window.isRunning()) {
-            // Process Qt events to keep the UI responsive
-            app->processEvents();
-            
-            // Simulate frame execution
-            std::this_thread::sleep_for(std::chrono::milliseconds(16)); // ~60 FPS
-            frames++;
-            
-            if (frames % 60 == 0) {
-                auto currentTime = std::chrono::steady_clock::now();
-                auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(currentTime - startTime).count();
-                std::cout << "Emulation running: " << frames << " frames, " 
-                          << elapsed << " seconds elapsed (Game is running...) \r" << std::flush;
-            }
-        }
-        
-        // Clean up
-        if (ownApp) {
-            delete app;
-        }
+        runGameWindow("XEmuRun PlayStation 5 Emulation", m_gamePath, m_liveSettings);
         
         std::cout << "\n\nEmulation terminated. Thank you for using XEmuRun!" << std::endl;
         std::cout << "=================================================================" << std::endl;
@@ -486,6 +498,7 @@ private:
     bool m_rayTracingEnabled;
     std::string m_biosPath;
     std::string m_gamePath;
+    const PlayStationLiveSettings* m_liveSettings;
 };
 
 // PlayStationEmulator implementation
@@ -497,6 +510,10 @@ PlayStationEmulator::PlayStationEmulator(const std::string& playstationVersion)
 }
 
 PlayStationEmulator::~PlayStationEmulator() {
+    // The game thread uses the cores
+    stopGame();
+    waitFor();
+    
     if (m_ps4Core) {
         delete m_ps4Core;
     }
@@ -506,21 +523,31 @@ PlayStationEmulator::~PlayStationEmulator() {
 }
 
 bool PlayStationEmulator::initialize() {
-    if (!BaseEmulator::initialize()) {
+    XEMURUN_TRACE_SCOPE("emulator", "PlayStationEmulator::initialize");
+    
+    if (!BaseEmulator::initialize() || isPrepareCancelled()) {
         return false;
     }
     
     std::cout << "Initializing XEmuPS for " << m_playstationVersion << std::endl;
     
+    // A configuration change since the last setup starts from fresh cores
+    delete m_ps4Core;
+    delete m_ps5Core;
+    m_ps4Core = nullptr;
+    m_ps5Core = nullptr;
+    
     // Platform-specific initialization
     if (m_playstationVersion == "playstation4") {
-        m_biosPath = m_config.getString("ps4_bios_path", "");
+        m_biosPath = m_config.get(Keys::Ps4BiosPath);
         m_ps4Core = new XEmuPS4Core();
+        m_ps4Core->setLiveSettings(&m_liveSettings);
         return m_ps4Core->initialize(m_biosPath);
     } 
     else if (m_playstationVersion == "playstation5") {
-        m_biosPath = m_config.getString("ps5_bios_path", "");
+        m_biosPath = m_config.get(Keys::Ps5BiosPath);
         m_ps5Core = new XEmuPS5Core();
+        m_ps5Core->setLiveSettings(&m_liveSettings);
         return m_ps5Core->initialize(m_biosPath);
     }
     else {
@@ -529,75 +556,143 @@ bool PlayStationEmulator::initialize() {
     }
 }
 
-int PlayStationEmulator::launch(const Package& package) {
-    if (!m_initialized && !initialize()) {
-        std::cerr << "Failed to initialize PlayStation emulator" << std::endl;
-        return 1;
-    }
-    
+bool PlayStationEmulator::startGame(const Package& package) {
     std::string gamePath = (fs::path(package.getExtractedPath()) / "game" / package.getMainExecutable()).string();
     
     if (!fs::exists(gamePath)) {
         std::cerr << "Game file not found: " << gamePath << std::endl;
-        return 1;
+        return false;
     }
     
     std::cout << "Launching " << m_playstationVersion << " game: " << gamePath << std::endl;
     
-    // Use the appropriate core based on platform
+    // Use the appropriate core based on platform; loading fails here, the
+    // emulation itself runs on the game thread
     if (m_playstationVersion == "playstation4" && m_ps4Core) {
         if (!m_ps4Core->loadGame(gamePath)) {
             std::cerr << "Failed to load PS4 game" << std::endl;
-            return 1;
+            return false;
         }
         
-        if (!m_ps4Core->run()) {
-            std::cerr << "Failed to run PS4 game" << std::endl;
-            return 1;
-        }
+        XEmuPS4Core* core = m_ps4Core;
+        startGameThread([this, core] {
+            bool ran = core->run();
+            if (!ran) {
+                std::cerr << "Failed to run PS4 game" << std::endl;
+            }
+            // Consumed; a terminate() that arrived while starting still took effect
+            m_liveSettings.stopRequested = false;
+            return ran ? 0 : 1;
+        });
     }
     else if (m_playstationVersion == "playstation5" && m_ps5Core) {
         if (!m_ps5Core->loadGame(gamePath)) {
             std::cerr << "Failed to load PS5 game" << std::endl;
-            return 1;
+            return false;
         }
         
-        if (!m_ps5Core->run()) {
-            std::cerr << "Failed to run PS5 game" << std::endl;
-            return 1;
-        }
+        XEmuPS5Core* core = m_ps5Core;
+        startGameThread([this, core] {
+            bool ran = core->run();
+            if (!ran) {
+                std::cerr << "Failed to run PS5 game" << std::endl;
+            }
+            m_liveSettings.stopRequested = false;
+            return ran ? 0 : 1;
+        });
     }
     else {
         std::cerr << "No appropriate emulation core available" << std::endl;
-        return 1;
+        return false;
     }
     
-    return 0;
+    return true;
+}
+
+void PlayStationEmulator::stopGame() {
+    m_liveSettings.stopRequested = true;
+}
+
+int PlayStationEmulator::waitFor() {
+    // The game window belongs to the thread that owns the QApplication; when
+    // that is this one, keep its events flowing until the game ends
+    QCoreApplication* app = QCoreApplication::instance();
+    if (app && app->thread() == QThread::currentThread()) {
+        while (isGameThreadRunning()) {
+            app->processEvents();
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+    }
+    return BaseEmulator::waitFor();
+}
+
+void PlayStationEmulator::applyConfig(const ConfigView& config) {
+    BaseEmulator::applyConfig(config);
+    
+    m_liveSettings.resolutionWidth = config.get(Keys::ResolutionWidth);
+    m_liveSettings.resolutionHeight = config.get(Keys::ResolutionHeight);
+    m_liveSettings.renderingScale = config.get(Keys::RenderingScale);
+    m_liveSettings.vsync = config.get(Keys::Vsync);
+}
+
+bool PlayStationEmulator::onConfigChanged(const ConfigView& config, const std::vector<std::string>& changedKeys) {
+    // The emulation loop reads these every frame; everything else needs a
+    // restart
+    std::vector<std::string> restartKeys;
+    for (const auto& key : changedKeys) {
+        if (key == Keys::ResolutionWidth.key.name()) {
+            m_liveSettings.resolutionWidth = config.get(Keys::ResolutionWidth);
+        } else if (key == Keys::ResolutionHeight.key.name()) {
+            m_liveSettings.resolutionHeight = config.get(Keys::ResolutionHeight);
+        } else if (key == Keys::RenderingScale.key.name()) {
+            m_liveSettings.renderingScale = config.get(Keys::RenderingScale);
+        } else if (key == Keys::Vsync.key.name()) {
+            m_liveSettings.vsync = config.get(Keys::Vsync);
+        } else {
+            restartKeys.push_back(key);
+        }
+    }
+    
+    if (restartKeys.empty()) {
+        std::cout << "Applied configuration changes live" << std::endl;
+        return true;
+    }
+    return BaseEmulator::onConfigChanged(config, restartKeys);
 }
 
 Config PlayStationEmulator::getDefaultConfig() const {
     Config config = BaseEmulator::getDefaultConfig();
     
     // Common PlayStation emulator settings
-    config.setBool("fullscreen", true);
-    config.setInt("resolution_width", 1920);
-    config.setInt("resolution_height", 1080);
-    config.setBool("vsync", true);
+    config.setDefault(Keys::Vsync);
     
     if (m_playstationVersion == "playstation4") {
-        config.setString("ps4_bios_path", "");
-        config.setBool("enable_gpu_acceleration", true);
-        config.setInt("rendering_scale", 100);  // percentage
+        config.setDefault(Keys::Ps4BiosPath);
+        config.setDefault(Keys::EnableGpuAcceleration);
+        config.setDefault(Keys::RenderingScale);
     } 
     else if (m_playstationVersion == "playstation5") {
-        config.setString("ps5_bios_path", "");
-        config.setBool("enable_gpu_acceleration", true);
-        config.setBool("enable_ray_tracing", false);  // off by default
-        config.setInt("rendering_scale", 75);   // lower default for performance
-        config.setInt("cpu_threads", 8);
+        config.setDefault(Keys::Ps5BiosPath);
+        config.setDefault(Keys::EnableGpuAcceleration);
+        config.setDefault(Keys::EnableRayTracing);
+        config.set(Keys::RenderingScale, 75);   // lower default for performance
+        config.setDefault(Keys::CpuThreads);
     }
     
     return config;
 }
 
 } // namespace XEmuRun
+
+// Plugin entry point used by EmulatorRegistry
+XEMURUN_EMULATOR_PLUGIN_EXPORT const XEmuRunEmulatorPlugin* xemurun_emulator_plugin() {
+    static const char* const platforms[] = { "playstation4", "playstation5", nullptr };
+    static const XEmuRunEmulatorPlugin plugin = {
+        XEMURUN_EMULATOR_ABI_VERSION,
+        "XEmuPS - PlayStation Emulator",
+        platforms,
+        [](const char* platform) -> XEmuRun::EmulatorInterface* { return new XEmuRun::PlayStationEmulator(platform); },
+        [](XEmuRun::EmulatorInterface* emulator) { delete emulator; }
+    };
+    return &plugin;
+}
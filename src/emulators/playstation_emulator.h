@@ -3,9 +3,20 @@
 #include "base_emulator.h"
 #include "../package/package.h"
 #include <string>
+#include <atomic>
 
 namespace XEmuRun {
 
+// Display settings the emulation loop re-reads every frame, so they can be
+// changed while a game is running
+struct PlayStationLiveSettings {
+    std::atomic<int> resolutionWidth{1920};
+    std::atomic<int> resolutionHeight{1080};
+    std::atomic<int> renderingScale{100}; // percentage
+    std::atomic<bool> vsync{true};
+    std::atomic<bool> stopRequested{false}; // set by terminate()
+};
+
 // Forward declarations for PlayStation emulator cores
 class XEmuPS4Core;
 class XEmuPS5Core;
@@ -23,12 +34,22 @@ public:
     ~PlayStationEmulator() override;
     
     bool initialize() override;
-    int launch(const Package& package) override;
+    void applyConfig(const ConfigView& config) override;
+    bool onConfigChanged(const ConfigView& config, const std::vector<std::string>& changedKeys) override;
     Config getDefaultConfig() const override;
     
+    // Also services the game window when called on the GUI thread
+    int waitFor() override;
+    
+protected:
+    // The cores emulate in-process, on a game thread started here
+    bool startGame(const Package& package) override;
+    void stopGame() override;
+    
 private:
     std::string m_playstationVersion;
     std::string m_biosPath;
+    PlayStationLiveSettings m_liveSettings;
     
     // Emulation cores
     XEmuPS4Core* m_ps4Core;
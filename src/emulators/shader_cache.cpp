@@ -0,0 +1,95 @@
+#include "shader_cache.h"
+#include "../package/package.h"
+#include "../utils/trace.h"
+#include <iostream>
+#include <cstdlib>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+// Cache files the translation layers write, by name
+bool isShippedCache(const std::string& name) {
+    const std::string dxvkSuffix = ".dxvk-cache";
+    return (name.size() > dxvkSuffix.size() &&
+            name.compare(name.size() - dxvkSuffix.size(), dxvkSuffix.size(), dxvkSuffix) == 0) ||
+           name == "vkd3d-proton.cache";
+}
+
+// A shipped cache only starts a title's cache: once the layers have
+// written their own, it holds what this machine compiled and is kept
+void seedFrom(const fs::path& gameDirectory, const fs::path& cacheDirectory) {
+    std::error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator(gameDirectory, ec)) {
+        std::string name = entry.path().filename().string();
+        std::error_code entryError;
+        if (!isShippedCache(name) || !entry.is_regular_file(entryError)) {
+            continue;
+        }
+
+        fs::path target = cacheDirectory / name;
+        if (fs::exists(fs::symlink_status(target, entryError))) {
+            continue;
+        }
+
+        // Without overwrite_existing: a cache written in the meantime wins
+        fs::copy_file(entry.path(), target, fs::copy_options::none, entryError);
+        if (entryError == std::errc::file_exists) {
+            continue;
+        }
+        if (entryError) {
+            std::cerr << "Failed to seed shader cache " << target.string() << ": " << entryError.message() << std::endl;
+        } else {
+            std::cout << "Seeded shader cache from " << name << std::endl;
+        }
+    }
+}
+
+} // namespace
+
+std::string ShaderCache::getDirectory(const std::string& packagePath) {
+    fs::path root;
+    const char* xdgCacheHome = std::getenv("XDG_CACHE_HOME");
+    const char* home = std::getenv("HOME");
+    if (xdgCacheHome && *xdgCacheHome) {
+        root = fs::path(xdgCacheHome) / "XEmuRun";
+    } else if (home) {
+        root = fs::path(home) / ".cache" / "XEmuRun";
+    } else {
+        root = fs::temp_directory_path() / "XEmuRun-cache";
+    }
+    return (root / "shaders" / fs::path(packagePath).stem()).string();
+}
+
+bool ShaderCache::prepare(const Package& package, Process::Environment& environment) {
+    XEMURUN_TRACE_SCOPE("emulator", "ShaderCache::prepare");
+
+    fs::path directory = getDirectory(package.getPackagePath());
+    std::error_code ec;
+    fs::create_directories(directory / "mesa", ec);
+    fs::create_directories(directory / "nvidia", ec);
+    if (ec) {
+        std::cerr << "Failed to create shader cache directory " << directory.string() << ": " << ec.message()
+                  << std::endl;
+        return false;
+    }
+
+    if (!package.getExtractedPath().empty()) {
+        fs::path executable = fs::path(package.getExtractedPath()) / "game" / package.getMainExecutable();
+        seedFrom(executable.parent_path(), directory);
+    }
+
+    environment.emplace_back("DXVK_STATE_CACHE_PATH", directory.string());
+    environment.emplace_back("VKD3D_SHADER_CACHE_PATH", directory.string());
+    environment.emplace_back("MESA_SHADER_CACHE_DIR", (directory / "mesa").string());
+    environment.emplace_back("__GL_SHADER_DISK_CACHE", "1");
+    environment.emplace_back("__GL_SHADER_DISK_CACHE_PATH", (directory / "nvidia").string());
+    // The driver would otherwise trim the directory to its default size
+    environment.emplace_back("__GL_SHADER_DISK_CACHE_SKIP_CLEANUP", "1");
+    return true;
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "../utils/process.h"
+#include <string>
+
+namespace XEmuRun {
+
+class Package;
+
+/**
+ * @class ShaderCache
+ * @brief Per-title shader and pipeline state caches that outlive extractions.
+ *
+ * DXVK, VKD3D-Proton and the GL/Vulkan drivers write their caches next to
+ * the executable or into a shared per-user directory. For an extracted
+ * title the former is thrown away with the extraction, so every fresh
+ * extraction stutters while the caches are rebuilt. Each package gets its
+ * own directory below the user's cache directory instead, keyed like its
+ * extraction directory, and the environment points the translation layers
+ * and drivers at it.
+ *
+ * Packages may ship caches next to the main executable (e.g.
+ * "game.exe.dxvk-cache", "vkd3d-proton.cache"); they seed the directory
+ * while the title has no cache of its own, and never replace one.
+ */
+class ShaderCache {
+public:
+    // $XDG_CACHE_HOME/XEmuRun/shaders/<package>, or below ~/.cache
+    static std::string getDirectory(const std::string& packagePath);
+
+    // Creates the directory, seeds it from the shipped caches and adds the
+    // variables to environment. Returns false if the directory cannot be
+    // used; the game then runs with the default cache locations.
+    static bool prepare(const Package& package, Process::Environment& environment);
+};
+
+} // namespace XEmuRun
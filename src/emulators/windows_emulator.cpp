@@ -1,13 +1,118 @@
 #include "windows_emulator.h"
+#include "emulator_plugin.h"
+#include "shader_cache.h"
+#include "wine_registry.h"
+#include "../utils/binary_discovery.h"
+#include "../utils/snapshot.h"
+#include "../utils/trace.h"
 #include <iostream>
 #include <filesystem>
+#include <cstdio>
 #include <cstdlib>
+#include <fstream>
 #include <string>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
 namespace XEmuRun {
 
+namespace {
+
+// In the prefix: a digest of the settings last written to user.reg and
+// the identity of the hive after that write
+constexpr const char* kRegistryStamp = ".xemurun-registry";
+
+// windows_version as Wine's registry names it; empty if Wine has no match
+std::string wineVersionName(int version) {
+    switch (version) {
+    case 7:
+        return "win7";
+    case 8:
+        return "win8";
+    case 10:
+        return "win10";
+    case 11:
+        return "win11";
+    default:
+        return "";
+    }
+}
+
+// Stable across runs and builds, unlike std::hash
+uint64_t fnv1a(const std::string& text) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (unsigned char c : text) {
+        hash = (hash ^ c) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+// "d3dx9_43,d3dcompiler_47=n,b;xinput1_3=" to registry values: one per DLL,
+// "native,builtin" style, empty for disabled
+std::vector<std::pair<std::string, std::string>> parseDllOverrides(const std::string& overrides) {
+    std::vector<std::pair<std::string, std::string>> values;
+    size_t start = 0;
+    while (start <= overrides.size()) {
+        size_t end = overrides.find(';', start);
+        std::string group = overrides.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        start = end == std::string::npos ? overrides.size() + 1 : end + 1;
+        
+        size_t equals = group.find('=');
+        if (group.empty() || equals == std::string::npos) {
+            continue;
+        }
+        
+        std::string mode;
+        for (char c : group.substr(equals + 1)) {
+            const char* name = c == 'n' ? "native" : c == 'b' ? "builtin" : nullptr;
+            if (name) {
+                mode += (mode.empty() ? "" : ",") + std::string(name);
+            }
+        }
+        
+        std::string dlls = group.substr(0, equals);
+        size_t dllStart = 0;
+        while (dllStart <= dlls.size()) {
+            size_t comma = dlls.find(',', dllStart);
+            std::string dll = dlls.substr(dllStart, comma == std::string::npos ? std::string::npos : comma - dllStart);
+            dllStart = comma == std::string::npos ? dlls.size() + 1 : comma + 1;
+            if (!dll.empty()) {
+                values.emplace_back(dll, mode);
+            }
+        }
+    }
+    return values;
+}
+
+// wineserver holds a lock on a file in a directory named after the
+// prefix's device and inode for as long as it runs
+bool isWineserverRunning(const std::string& prefix) {
+    struct stat st;
+    if (stat(prefix.c_str(), &st) != 0) {
+        return false;
+    }
+    
+    char lockPath[128];
+    std::snprintf(lockPath, sizeof(lockPath), "/tmp/.wine-%u/server-%llx-%llx/lock", static_cast<unsigned>(getuid()),
+                  static_cast<unsigned long long>(st.st_dev), static_cast<unsigned long long>(st.st_ino));
+    int fd = open(lockPath, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    
+    struct flock lock{};
+    lock.l_type = F_WRLCK;
+    lock.l_whence = SEEK_SET;
+    bool running = fcntl(fd, F_GETLK, &lock) == 0 && lock.l_type != F_UNLCK;
+    close(fd);
+    return running;
+}
+
+} // namespace
+
 WindowsEmulator::WindowsEmulator()
     : BaseEmulator("Wine", "windows") {
 }
@@ -15,6 +120,8 @@ WindowsEmulator::WindowsEmulator()
 WindowsEmulator::~WindowsEmulator() = default;
 
 bool WindowsEmulator::initialize() {
+    XEMURUN_TRACE_SCOPE("emulator", "WindowsEmulator::initialize");
+    
     if (!BaseEmulator::initialize()) {
         return false;
     }
@@ -24,92 +131,217 @@ bool WindowsEmulator::initialize() {
 
 bool WindowsEmulator::setupWine() {
     // Check if Wine is installed
-    int result = std::system("which wine > /dev/null 2>&1");
-    if (result != 0) {
+    BinaryDiscovery& discovery = BinaryDiscovery::getInstance();
+    m_wineBinary = discovery.find("wine");
+    if (m_wineBinary.empty()) {
         std::cerr << "Wine is not installed. Please install Wine to run Windows applications." << std::endl;
         return false;
     }
     
-    std::cout << "Wine detected successfully." << std::endl;
+    std::string version = discovery.getVersion("wine");
+    std::cout << "Wine detected: " << m_wineBinary << (version.empty() ? "" : " (" + version + ")") << std::endl;
+    
+    if (isPrepareCancelled()) {
+        return false;
+    }
+    
+    m_wineEnvironment.clear();
     
     // Setup Wine environment if custom Wine prefix is specified
-    std::string winePrefix = m_config.getString("wine_prefix", "");
+    std::string winePrefix(m_config.get(Keys::WinePrefix));
     if (!winePrefix.empty()) {
         std::cout << "Using custom Wine prefix: " << winePrefix << std::endl;
-        setenv("WINEPREFIX", winePrefix.c_str(), 1);
+        m_wineEnvironment.emplace_back("WINEPREFIX", winePrefix);
     }
     
     // Configure DXVK if enabled
-    bool enableDxvk = m_config.getBool("enable_dxvk", true);
+    bool enableDxvk = m_config.get(Keys::EnableDxvk);
     if (enableDxvk) {
         std::cout << "DXVK is enabled for DirectX support" << std::endl;
-        setenv("WINEDLLOVERRIDES", "d3d11,d3d10,d3d9=n", 1);
+        m_wineEnvironment.emplace_back("WINEDLLOVERRIDES", "d3d11,d3d10,d3d9=n");
     }
     
     return true;
 }
 
-int WindowsEmulator::launch(const Package& package) {
-    if (!m_initialized && !initialize()) {
-        std::cerr << "Failed to initialize Windows emulator" << std::endl;
-        return 1;
-    }
-    
+bool WindowsEmulator::startGame(const Package& package) {
     std::string executablePath = (fs::path(package.getExtractedPath()) / "game" / package.getMainExecutable()).string();
     
     if (!fs::exists(executablePath)) {
         std::cerr << "Executable not found: " << executablePath << std::endl;
-        return 1;
+        return false;
     }
     
+    // Registry settings go straight into the prefix instead of through
+    // winecfg or regedit
+    bool prefixConfigured = configurePrefix(fs::path(package.getMainExecutable()).filename().string());
+    
     // Prepare Wine command with configuration
-    std::string command = "wine";
+    std::vector<std::string> command = {m_wineBinary};
     
-    // Add configuration parameters
-    bool fullscreen = m_config.getBool("fullscreen", true);
-    if (fullscreen) {
-        command += " explorer /desktop=XEmuRun,";
-        command += std::to_string(m_config.getInt("resolution_width", 1920));
-        command += "x";
-        command += std::to_string(m_config.getInt("resolution_height", 1080));
+    // Add configuration parameters; the registry's virtual desktop replaces
+    // the explorer wrapper once the prefix is configured
+    bool fullscreen = m_config.get(Keys::Fullscreen);
+    if (fullscreen && !prefixConfigured) {
+        command.push_back("explorer");
+        command.push_back("/desktop=XEmuRun," +
+                          std::to_string(m_config.get(Keys::ResolutionWidth)) + "x" +
+                          std::to_string(m_config.get(Keys::ResolutionHeight)));
     }
     
     // Add executable path
-    command += " \"" + executablePath + "\"";
+    command.push_back(executablePath);
     
     std::cout << "Launching Windows application: " << executablePath << std::endl;
-    std::cout << "Command: " << command << std::endl;
+    std::cout << "Command: " << formatCommandLine(command) << std::endl;
+    
+    // Shader caches survive re-extraction of the package
+    Process::Environment environment = m_wineEnvironment;
+    ShaderCache::prepare(package, environment);
+    
+    return m_process.spawn(command, environment);
+}
+
+std::string WindowsEmulator::getWinePrefix() const {
+    std::string winePrefix(m_config.get(Keys::WinePrefix));
+    if (!winePrefix.empty()) {
+        return winePrefix;
+    }
+    if (const char* inherited = getLaunchVariable("WINEPREFIX"); inherited && *inherited) {
+        return inherited;
+    }
+    const char* home = getLaunchVariable("HOME");
+    return std::string(home ? home : "") + "/.wine";
+}
+
+bool WindowsEmulator::configurePrefix(const std::string& executableName) {
+    XEMURUN_TRACE_SCOPE("emulator", "WindowsEmulator::configurePrefix");
+    
+    std::string prefix = getWinePrefix();
+    std::string hivePath = (fs::path(prefix) / "user.reg").string();
+    std::string stampPath = (fs::path(prefix) / kRegistryStamp).string();
+    
+    // Per-application keys, so games sharing a prefix keep their own settings
+    std::string appKey = "Software\\Wine\\AppDefaults\\" + executableName;
+    int windowsVersion = m_config.get(Keys::WindowsVersion);
+    std::string version = wineVersionName(windowsVersion);
+    std::string dllOverrides(m_config.get(Keys::WineDllOverrides));
+    bool fullscreen = m_config.get(Keys::Fullscreen);
+    std::string resolution = std::to_string(m_config.get(Keys::ResolutionWidth)) + "x" +
+                             std::to_string(m_config.get(Keys::ResolutionHeight));
+    int dpi = m_config.get(Keys::WineDpi);
+    
+    std::string settings = appKey + "\n" + version + "\n" + dllOverrides + "\n" +
+                           (fullscreen ? resolution : "") + "\n" + std::to_string(dpi);
+    uint64_t digest = fnv1a(settings);
+    
+    SnapshotSource source;
+    if (!statSnapshotSource(hivePath, source)) {
+        std::cout << "Wine prefix " << prefix << " is not set up yet; registry settings apply from the next launch"
+                  << std::endl;
+        return false;
+    }
+    
+    // Same settings and the hive as we left it: no need to parse it
+    {
+        std::ifstream stamp(stampPath);
+        uint64_t stampDigest = 0;
+        SnapshotSource stampSource;
+        if (stamp >> std::hex >> stampDigest >> std::dec >> stampSource.mtimeNs >> stampSource.size &&
+            stampDigest == digest && stampSource.mtimeNs == source.mtimeNs && stampSource.size == source.size) {
+            return true;
+        }
+    }
+    
+    // It would overwrite the hive with its own copy on exit
+    if (isWineserverRunning(prefix)) {
+        std::cout << "wineserver is running for " << prefix << "; registry settings apply from the next launch"
+                  << std::endl;
+        return false;
+    }
+    
+    WineRegistry registry;
+    if (!registry.load(hivePath)) {
+        return false;
+    }
+    
+    if (!version.empty()) {
+        registry.setString(appKey, "Version", version);
+    } else {
+        std::cerr << "Wine has no Windows " << windowsVersion << "; keeping the prefix's version" << std::endl;
+    }
+    
+    if (!dllOverrides.empty()) {
+        registry.setStrings(appKey + "\\DllOverrides", parseDllOverrides(dllOverrides));
+    }
+    
+    // A virtual desktop of the configured size stands in for fullscreen
+    if (fullscreen) {
+        registry.setString(appKey + "\\Explorer", "Desktop", "XEmuRun");
+        registry.setString("Software\\Wine\\Explorer\\Desktops", "XEmuRun", resolution);
+    } else {
+        registry.deleteValue(appKey + "\\Explorer", "Desktop");
+    }
     
-    // Execute the command
-    return std::system(command.c_str());
+    if (dpi > 0) {
+        registry.setDword("Control Panel\\Desktop", "LogPixels", static_cast<uint32_t>(dpi));
+    }
+    
+    if (registry.isModified()) {
+        if (!registry.save(hivePath)) {
+            return false;
+        }
+        std::cout << "Updated Wine registry in " << prefix << std::endl;
+    }
+    
+    if (statSnapshotSource(hivePath, source)) {
+        std::ofstream stamp(stampPath, std::ios::trunc);
+        stamp << std::hex << digest << std::dec << " " << source.mtimeNs << " " << source.size << std::endl;
+    }
+    return true;
 }
 
 Config WindowsEmulator::getDefaultConfig() const {
     Config config = BaseEmulator::getDefaultConfig();
     
     // Windows-specific settings
-    config.setString("wine_prefix", "");
-    config.setString("wine_version", "");
-    config.setBool("enable_dxvk", true);
-    config.setInt("windows_version", 10);
+    config.setDefault(Keys::WinePrefix);
+    config.setDefault(Keys::WineVersion);
+    config.setDefault(Keys::EnableDxvk);
+    config.setDefault(Keys::WindowsVersion);
+    config.setDefault(Keys::WineDllOverrides);
+    config.setDefault(Keys::WineDpi);
     
     return config;
 }
 
-void WindowsEmulator::applyConfig(const Config& config) {
+void WindowsEmulator::applyConfig(const ConfigView& config) {
     BaseEmulator::applyConfig(config);
     
     // Apply Windows-specific settings
-    std::string winePrefix = config.getString("wine_prefix", "");
+    std::string_view winePrefix = config.get(Keys::WinePrefix);
     if (!winePrefix.empty()) {
         std::cout << "Using Wine prefix: " << winePrefix << std::endl;
     }
     
-    bool enableDxvk = config.getBool("enable_dxvk", true);
+    bool enableDxvk = config.get(Keys::EnableDxvk);
     std::cout << "DXVK " << (enableDxvk ? "enabled" : "disabled") << std::endl;
     
-    int windowsVersion = config.getInt("windows_version", 10);
+    int windowsVersion = config.get(Keys::WindowsVersion);
     std::cout << "Windows version set to: Windows " << windowsVersion << std::endl;
 }
 
 } // namespace XEmuRun
+
+// Plugin entry point used by EmulatorRegistry
+XEMURUN_EMULATOR_PLUGIN_EXPORT const XEmuRunEmulatorPlugin* xemurun_emulator_plugin() {
+    static const char* const platforms[] = { "windows", nullptr };
+    static const XEmuRunEmulatorPlugin plugin = {
+        XEMURUN_EMULATOR_ABI_VERSION,
+        "Wine",
+        platforms,
+        [](const char*) -> XEmuRun::EmulatorInterface* { return new XEmuRun::WindowsEmulator(); },
+        [](XEmuRun::EmulatorInterface* emulator) { delete emulator; }
+    };
+    return &plugin;
+}
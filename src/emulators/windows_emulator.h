@@ -11,14 +11,30 @@ public:
     ~WindowsEmulator() override;
     
     bool initialize() override;
-    int launch(const Package& package) override;
     
     // Configuration methods
-    void applyConfig(const Config& config) override;
+    void applyConfig(const ConfigView& config) override;
     Config getDefaultConfig() const override;
     
+protected:
+    bool startGame(const Package& package) override;
+    
 private:
     bool setupWine();
+    
+    // WINEPREFIX as Wine will see it
+    std::string getWinePrefix() const;
+    // Writes the game's Windows version, DLL overrides, virtual desktop and
+    // DPI into the prefix's user.reg. Returns false if the prefix could not
+    // be updated, e.g. while a wineserver runs for it.
+    bool configurePrefix(const std::string& executableName);
+    
+    // Absolute, from BinaryDiscovery
+    std::string m_wineBinary;
+    
+    // Passed to Wine instead of changing our own environment, which other
+    // threads may be reading while prepare() runs
+    Process::Environment m_wineEnvironment;
 };
 
 } // namespace XEmuRun
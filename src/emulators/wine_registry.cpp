@@ -0,0 +1,257 @@
+#include "wine_registry.h"
+#include "../utils/trace.h"
+#include <iostream>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <strings.h>
+
+namespace XEmuRun {
+
+namespace {
+
+// Seconds between 1601, where Windows FILETIMEs start, and 1970
+constexpr uint64_t kFiletimeEpochOffset = 11644473600ULL;
+
+// Wine doubles backslashes and escapes quotes in key and value names and
+// in string data
+std::string escape(const std::string& text) {
+    std::string escaped;
+    for (char c : text) {
+        if (c == '\\' || c == '"') {
+            escaped += '\\';
+        }
+        escaped += c;
+    }
+    return escaped;
+}
+
+std::string quotedName(const std::string& name) {
+    return name.empty() ? "@" : "\"" + escape(name) + "\"";
+}
+
+// The value name at the start of a value line, as written, or empty if the
+// line is not a value
+std::string valueNameOf(const std::string& line) {
+    if (line.rfind("@=", 0) == 0) {
+        return "@";
+    }
+    if (line.empty() || line[0] != '"') {
+        return "";
+    }
+    for (size_t i = 1; i < line.size(); ++i) {
+        if (line[i] == '\\') {
+            ++i;
+        } else if (line[i] == '"') {
+            return line.substr(0, i + 1);
+        }
+    }
+    return "";
+}
+
+bool continues(const std::string& line) {
+    return !line.empty() && line.back() == '\\';
+}
+
+bool sameName(const std::string& a, const std::string& b) {
+    return a.size() == b.size() && strncasecmp(a.c_str(), b.c_str(), a.size()) == 0;
+}
+
+} // namespace
+
+bool WineRegistry::load(const std::string& path) {
+    XEMURUN_TRACE_SCOPE("emulator", "WineRegistry::load", path.c_str());
+
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Failed to open registry hive: " << path << std::endl;
+        return false;
+    }
+
+    m_preamble.clear();
+    m_keys.clear();
+    m_modified = false;
+
+    std::string line;
+    if (!std::getline(file, line) || line.rfind("WINE REGISTRY Version 2", 0) != 0) {
+        std::cerr << "Not a Wine registry hive: " << path << std::endl;
+        return false;
+    }
+    m_preamble.push_back(line);
+
+    // Between keys, blank lines are only separators; save() puts one before
+    // each key, as Wine does
+    bool inContinuation = false;
+    while (std::getline(file, line)) {
+        if (inContinuation) {
+            m_keys.back().values.back().lines.push_back(line);
+            inContinuation = continues(line);
+            continue;
+        }
+        if (line.empty() && !m_keys.empty()) {
+            continue;
+        }
+
+        if (!line.empty() && line[0] == '[') {
+            size_t close = line.rfind(']');
+            if (close == std::string::npos) {
+                std::cerr << "Malformed registry key in " << path << ": " << line << std::endl;
+                return false;
+            }
+            while (m_keys.empty() && m_preamble.back().empty()) {
+                m_preamble.pop_back();
+            }
+            m_keys.push_back({line.substr(1, close - 1), {line}, {}});
+            continue;
+        }
+
+        if (m_keys.empty()) {
+            m_preamble.push_back(line);
+            continue;
+        }
+
+        Key& key = m_keys.back();
+        std::string name = valueNameOf(line);
+        if (!name.empty()) {
+            key.values.push_back({name, {line}});
+            inContinuation = continues(line);
+        } else if (key.values.empty()) {
+            key.header.push_back(line); // #time, #class, #link
+        } else {
+            key.values.back().lines.push_back(line);
+        }
+    }
+
+    return true;
+}
+
+bool WineRegistry::save(const std::string& path) const {
+    XEMURUN_TRACE_SCOPE("emulator", "WineRegistry::save", path.c_str());
+
+    std::string tempPath = path + ".xemurun-tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        for (const std::string& line : m_preamble) {
+            file << line << '\n';
+        }
+        for (const Key& key : m_keys) {
+            file << '\n';
+            for (const std::string& line : key.header) {
+                file << line << '\n';
+            }
+            for (const Value& value : key.values) {
+                for (const std::string& line : value.lines) {
+                    file << line << '\n';
+                }
+            }
+        }
+        file.flush();
+        if (!file) {
+            std::cerr << "Failed to write registry hive: " << tempPath << std::endl;
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::cerr << "Failed to replace registry hive: " << path << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+void WineRegistry::setString(const std::string& key, const std::string& name, const std::string& value) {
+    setValue(key, name, "\"" + escape(value) + "\"");
+}
+
+void WineRegistry::setDword(const std::string& key, const std::string& name, uint32_t value) {
+    char data[16];
+    std::snprintf(data, sizeof(data), "dword:%08x", value);
+    setValue(key, name, data);
+}
+
+void WineRegistry::deleteValue(const std::string& key, const std::string& name) {
+    Key* existing = findKey(escape(key));
+    if (!existing) {
+        return;
+    }
+
+    std::string quoted = quotedName(name);
+    for (auto it = existing->values.begin(); it != existing->values.end(); ++it) {
+        if (sameName(it->name, quoted)) {
+            existing->values.erase(it);
+            m_modified = true;
+            return;
+        }
+    }
+}
+
+void WineRegistry::setStrings(const std::string& key, const std::vector<std::pair<std::string, std::string>>& values) {
+    std::vector<Value> replacement;
+    for (const auto& [name, value] : values) {
+        std::string quoted = quotedName(name);
+        replacement.push_back({quoted, {quoted + "=\"" + escape(value) + "\""}});
+    }
+
+    Key* existing = findKey(escape(key));
+    if (!existing && replacement.empty()) {
+        return;
+    }
+    Key& target = existing ? *existing : findOrAddKey(key);
+
+    bool same = target.values.size() == replacement.size();
+    for (size_t i = 0; same && i < replacement.size(); ++i) {
+        same = target.values[i].lines == replacement[i].lines;
+    }
+    if (!same) {
+        target.values = std::move(replacement);
+        m_modified = true;
+    }
+}
+
+WineRegistry::Key* WineRegistry::findKey(const std::string& escapedName) {
+    for (Key& key : m_keys) {
+        if (sameName(key.name, escapedName)) {
+            return &key;
+        }
+    }
+    return nullptr;
+}
+
+WineRegistry::Key& WineRegistry::findOrAddKey(const std::string& key) {
+    std::string escapedName = escape(key);
+    if (Key* existing = findKey(escapedName)) {
+        return *existing;
+    }
+
+    // Wine stamps keys with their last write, in seconds and as a FILETIME
+    uint64_t now = static_cast<uint64_t>(std::time(nullptr));
+    char filetime[32];
+    std::snprintf(filetime, sizeof(filetime), "#time=%llx",
+                  static_cast<unsigned long long>((now + kFiletimeEpochOffset) * 10000000ULL));
+    m_keys.push_back({escapedName, {"[" + escapedName + "] " + std::to_string(now), filetime}, {}});
+    m_modified = true;
+    return m_keys.back();
+}
+
+void WineRegistry::setValue(const std::string& key, const std::string& name, const std::string& data) {
+    Key& target = findOrAddKey(key);
+    std::string quoted = quotedName(name);
+    std::string line = quoted + "=" + data;
+
+    for (Value& value : target.values) {
+        if (sameName(value.name, quoted)) {
+            if (value.lines.size() != 1 || value.lines[0] != line) {
+                value.lines = {line};
+                m_modified = true;
+            }
+            return;
+        }
+    }
+
+    target.values.push_back({quoted, {line}});
+    m_modified = true;
+}
+
+} // namespace XEmuRun
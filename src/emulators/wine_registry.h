@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace XEmuRun {
+
+/**
+ * @class WineRegistry
+ * @brief Reads and patches one of Wine's text registry hives (system.reg,
+ * user.reg) without starting Wine.
+ *
+ * Keys and values the caller does not touch are written back exactly as
+ * Wine wrote them. Key paths use single backslashes and are relative to
+ * the hive's root (e.g. "Software\Wine\AppDefaults\game.exe"); like
+ * Windows, lookups ignore ASCII case. Names are escaped the way Wine
+ * escapes ASCII; names with other characters are not supported.
+ *
+ * wineserver keeps the registry in memory and writes it back when the
+ * last Wine process exits, so a hive must only be patched while no
+ * wineserver runs for its prefix.
+ */
+class WineRegistry {
+public:
+    bool load(const std::string& path);
+    // Writes atomically (temp file + rename)
+    bool save(const std::string& path) const;
+
+    // True once a set or delete changed anything
+    bool isModified() const { return m_modified; }
+
+    void setString(const std::string& key, const std::string& name, const std::string& value);
+    void setDword(const std::string& key, const std::string& name, uint32_t value);
+    void deleteValue(const std::string& key, const std::string& name);
+    // Makes these strings, in this order, the only values of the key
+    void setStrings(const std::string& key, const std::vector<std::pair<std::string, std::string>>& values);
+
+private:
+    struct Value {
+        std::string name; // quoted and escaped as in the file, or "@"
+        std::vector<std::string> lines; // including continuation lines
+    };
+
+    struct Key {
+        std::string name; // escaped, as between the brackets
+        std::vector<std::string> header; // "[name] time" and metadata lines
+        std::vector<Value> values;
+    };
+
+    Key* findKey(const std::string& escapedName);
+    Key& findOrAddKey(const std::string& key);
+    void setValue(const std::string& key, const std::string& name, const std::string& data);
+
+    std::vector<std::string> m_preamble; // lines before the first key
+    std::vector<Key> m_keys;
+    bool m_modified = false;
+};
+
+} // namespace XEmuRun
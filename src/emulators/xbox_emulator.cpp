@@ -1,15 +1,34 @@
 #include "xbox_emulator.h"
+#include "emulator_plugin.h"
+#include "disc_mount.h"
+#include "../utils/archive.h"
+#include "../utils/binary_discovery.h"
+#include "../utils/trace.h"
 #include <iostream>
 #include <filesystem>
 #include <cstdlib>
+#include <algorithm>
+#include <cctype>
 #include <fstream>
 #include <thread>
 #include <map>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
 namespace XEmuRun {
 
+namespace {
+
+bool isDiscImage(const std::string& path) {
+    std::string extension = fs::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".iso" || extension == ".xiso";
+}
+
+} // namespace
+
 XboxEmulator::XboxEmulator(const std::string& xboxVersion)
     : BaseEmulator("Xbox Emulator", xboxVersion), m_xboxVersion(xboxVersion) {
 }
@@ -17,7 +36,9 @@ XboxEmulator::XboxEmulator(const std::string& xboxVersion)
 XboxEmulator::~XboxEmulator() = default;
 
 bool XboxEmulator::initialize() {
-    if (!BaseEmulator::initialize()) {
+    XEMURUN_TRACE_SCOPE("emulator", "XboxEmulator::initialize");
+    
+    if (!BaseEmulator::initialize() || isPrepareCancelled()) {
         return false;
     }
     
@@ -50,7 +71,7 @@ bool XboxEmulator::setupOriginalXboxEmulator() {
     }
     
     // Check for BIOS files
-    m_biosPath = m_config.getString("xbox_bios_path", "");
+    m_biosPath = m_config.get(Keys::XboxBiosPath);
     if (m_biosPath.empty() || !fs::exists(m_biosPath)) {
         std::cerr << "Warning: Xbox BIOS not found. Original Xbox BIOS may be required." << std::endl;
     }
@@ -100,40 +121,54 @@ bool XboxEmulator::setupXboxSeriesEmulator() {
     return true;
 }
 
-std::string XboxEmulator::findEmulatorPath(const std::string& defaultName) {
-    // Try to find emulator in system path
-    int result = std::system(("which " + defaultName + " > /dev/null 2>&1").c_str());
-    if (result == 0) {
-        // Get full path
-        std::string cmd = "which " + defaultName;
-        FILE* pipe = popen(cmd.c_str(), "r");
-        if (!pipe) {
-            return defaultName;
-        }
-        
-        char buffer[128];
-        std::string path = "";
-        while (!feof(pipe)) {
-            if (fgets(buffer, 128, pipe) != nullptr)
-                path += buffer;
-        }
-        pclose(pipe);
-        
-        // Remove trailing newline
-        if (!path.empty() && path[path.length()-1] == '\n') {
-            path.erase(path.length()-1);
+bool XboxEmulator::requiresExtraction(const Package& package) {
+    XEMURUN_TRACE_SCOPE("emulator", "XboxEmulator::requiresExtraction");
+    
+    // The previous package's image; the emulator has closed it
+    m_discMount.reset();
+    
+    // An existing extraction costs nothing to use
+    if (!m_config.get(Keys::StreamDiscImages) || !package.getExtractedPath().empty() ||
+        !isDiscImage(package.getMainExecutable()) || !DiscMount::isSupported()) {
+        return true;
+    }
+    
+    // The emulator is only given the image, so anything else in the game
+    // directory needs the title extracted
+    std::vector<ArchiveEntryInfo> entries;
+    if (!listArchive(package.getPackagePath(), entries)) {
+        return true;
+    }
+    std::string image = "game/" + package.getMainExecutable();
+    for (const ArchiveEntryInfo& entry : entries) {
+        if (!entry.isDirectory && entry.path.rfind("game/", 0) == 0 && entry.path != image) {
+            return true;
         }
-        
-        return path;
     }
     
-    // Check if user has specified a custom path in config
-    std::string customPath = m_config.getString(m_xboxVersion + "_emulator_path", "");
-    if (!customPath.empty() && fs::exists(customPath)) {
+    // Mounted now rather than at launch, so a failure can still fall back
+    // to extracting
+    auto discMount = std::make_unique<DiscMount>();
+    if (!discMount->mount(package.getPackagePath(), image)) {
+        std::cout << "Disc image cannot be served from the package, extracting it" << std::endl;
+        return true;
+    }
+    
+    std::cout << "Serving disc image from the package: " << discMount->getImagePath() << std::endl;
+    m_discMount = std::move(discMount);
+    return false;
+}
+
+std::string XboxEmulator::findEmulatorPath(const std::string& defaultName) {
+    // A custom path in config is what the user asked for: it wins over
+    // PATH and over whatever was remembered before it was set
+    std::string customPath(m_config.getString(m_xboxVersion + "_emulator_path"));
+    if (!customPath.empty() && access(customPath.c_str(), X_OK) == 0 && fs::is_regular_file(customPath)) {
         return customPath;
     }
     
-    // Try common installation locations
+    std::vector<std::string> knownLocations;
+    
     std::map<std::string, std::vector<std::string>> searchPaths = {
         {"xemu", {
             "/usr/bin/xemu",
@@ -157,109 +192,126 @@ std::string XboxEmulator::findEmulatorPath(const std::string& defaultName) {
         }}
     };
     
-    if (searchPaths.find(defaultName) != searchPaths.end()) {
-        for (const auto& path : searchPaths[defaultName]) {
-            if (fs::exists(path)) {
-                return path;
-            }
-        }
+    auto common = searchPaths.find(defaultName);
+    if (common != searchPaths.end()) {
+        knownLocations.insert(knownLocations.end(), common->second.begin(), common->second.end());
     }
     
-    // If we get here, we couldn't find the emulator
-    return "";
+    // System path first; remembered across launches, so this is usually a
+    // single stat
+    return BinaryDiscovery::getInstance().find(defaultName, knownLocations);
 }
 
-int XboxEmulator::launch(const Package& package) {
-    if (!m_initialized && !initialize()) {
-        std::cerr << "Failed to initialize Xbox emulator" << std::endl;
-        return 1;
-    }
-    
+bool XboxEmulator::startGame(const Package& package) {
     if (m_emulatorBinary.empty()) {
         std::cerr << "No emulator binary configured" << std::endl;
-        return 1;
+        return false;
     }
     
-    std::string gamePath = (fs::path(package.getExtractedPath()) / "game" / package.getMainExecutable()).string();
+    // The mount is kept across launches of the package; it is only made
+    // again if something unmounted it in between
+    std::string gamePath = m_discMount ? m_discMount->getImagePath()
+                                       : (fs::path(package.getExtractedPath()) / "game" / package.getMainExecutable()).string();
+    if (m_discMount && !fs::exists(gamePath) &&
+        !m_discMount->mount(package.getPackagePath(), "game/" + package.getMainExecutable())) {
+        std::cerr << "Failed to serve the disc image from the package" << std::endl;
+        return false;
+    }
+    gamePath = m_discMount ? m_discMount->getImagePath() : gamePath;
     
     if (!fs::exists(gamePath)) {
         std::cerr << "Game file not found: " << gamePath << std::endl;
-        return 1;
+        return false;
     }
     
     // Prepare command with emulator-specific options
-    std::string command = m_emulatorBinary;
+    std::vector<std::string> command = {m_emulatorBinary};
     
     // Add version-specific arguments
     if (m_xboxVersion == "xbox") {
         if (!m_biosPath.empty()) {
-            command += " --bios \"" + m_biosPath + "\"";
+            command.push_back("--bios");
+            command.push_back(m_biosPath);
         }
         
-        if (m_config.getBool("hdd_enabled", true)) {
-            std::string hddPath = m_config.getString("hdd_path", "");
+        if (m_config.get(Keys::HddEnabled)) {
+            std::string hddPath(m_config.get(Keys::HddPath));
             if (!hddPath.empty()) {
-                command += " --hdd \"" + hddPath + "\"";
+                command.push_back("--hdd");
+                command.push_back(hddPath);
             }
         }
     } 
     else if (m_xboxVersion == "xbox_360") {
         // Xenia specific arguments
-        if (m_config.getBool("fullscreen", true)) {
-            command += " --fullscreen";
+        if (m_config.get(Keys::Fullscreen)) {
+            command.push_back("--fullscreen");
         }
         
-        if (m_config.getBool("vsync", true)) {
-            command += " --vsync";
+        if (m_config.get(Keys::Vsync)) {
+            command.push_back("--vsync");
         }
     }
     else if (m_xboxVersion == "xbox_one" || m_xboxVersion == "xbox_series") {
         // Future emulator arguments would go here
-        command += " --experimental";
+        command.push_back("--experimental");
     }
     
     // Add game path (this is always the last argument)
-    command += " \"" + gamePath + "\"";
+    command.push_back(gamePath);
     
     std::cout << "Launching " << m_xboxVersion << " game: " << gamePath << std::endl;
-    std::cout << "Command: " << command << std::endl;
+    std::cout << "Command: " << formatCommandLine(command) << std::endl;
     
-    // Execute the command
-    return std::system(command.c_str());
+    return m_process.spawn(command);
 }
 
 Config XboxEmulator::getDefaultConfig() const {
     Config config = BaseEmulator::getDefaultConfig();
     
     // Common settings for all Xbox emulators
-    config.setBool("fullscreen", true);
-    config.setBool("vsync", true);
+    config.setDefault(Keys::Fullscreen);
+    config.setDefault(Keys::Vsync);
+    config.setDefault(Keys::StreamDiscImages);
     
     // Version-specific settings
     if (m_xboxVersion == "xbox") {
         // Original Xbox
-        config.setString("xbox_bios_path", "");
-        config.setBool("hdd_enabled", true);
-        config.setString("hdd_path", "");
+        config.setDefault(Keys::XboxBiosPath);
+        config.setDefault(Keys::HddEnabled);
+        config.setDefault(Keys::HddPath);
     } 
     else if (m_xboxVersion == "xbox_360") {
         // Xbox 360
-        config.setBool("gpu_hardware_acceleration", true);
-        config.setString("save_directory", "");
+        config.setDefault(Keys::GpuHardwareAcceleration);
+        config.setDefault(Keys::SaveDirectory);
     }
     else if (m_xboxVersion == "xbox_one") {
         // Xbox One
-        config.setBool("experimental_mode", true);
-        config.setInt("rendering_scale", 75);
+        config.set(Keys::ExperimentalMode, true);
+        config.set(Keys::RenderingScale, 75);
     }
     else if (m_xboxVersion == "xbox_series") {
         // Xbox Series X|S
-        config.setBool("experimental_mode", true);
-        config.setInt("rendering_scale", 50);
-        config.setBool("raytracing", false);
+        config.set(Keys::ExperimentalMode, true);
+        config.set(Keys::RenderingScale, 50);
+        config.setDefault(Keys::Raytracing);
     }
     
     return config;
 }
 
 } // namespace XEmuRun
+
+// Plugin entry point used by EmulatorRegistry
+XEMURUN_EMULATOR_PLUGIN_EXPORT const XEmuRunEmulatorPlugin* xemurun_emulator_plugin() {
+    static const char* const platforms[] = { "xbox", "xbox_360", "xbox_one", "xbox_series", nullptr };
+    static const XEmuRunEmulatorPlugin plugin = {
+        XEMURUN_EMULATOR_ABI_VERSION,
+        "Xbox Emulator",
+        platforms,
+        [](const char* platform) -> XEmuRun::EmulatorInterface* { return new XEmuRun::XboxEmulator(platform); },
+        [](XEmuRun::EmulatorInterface* emulator) { delete emulator; }
+    };
+    return &plugin;
+}
@@ -2,19 +2,25 @@
 
 #include "base_emulator.h"
 #include "../package/package.h"
+#include <memory>
 #include <string>
 
 namespace XEmuRun {
 
+class DiscMount;
+
 class XboxEmulator : public BaseEmulator {
 public:
     explicit XboxEmulator(const std::string& xboxVersion);
     ~XboxEmulator() override;
     
     bool initialize() override;
-    int launch(const Package& package) override;
+    bool requiresExtraction(const Package& package) override;
     Config getDefaultConfig() const override;
     
+protected:
+    bool startGame(const Package& package) override;
+    
 private:
     bool setupOriginalXboxEmulator();
     bool setupXbox360Emulator();
@@ -25,6 +31,12 @@ private:
     std::string m_emulatorBinary;
     std::string m_xboxVersion;
     std::string m_biosPath;
+    
+    // The disc image served from the package when it is not extracted.
+    // Kept for every launch of the loaded package, since the daemon runs
+    // a prepared package more than once; unmounted when another package
+    // is loaded or the emulator is destroyed.
+    std::unique_ptr<DiscMount> m_discMount;
 };
 
 } // namespace XEmuRun
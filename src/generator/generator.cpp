@@ -0,0 +1,311 @@
+#include "generator.h"
+#include <iostream>
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <vector>
+#include <cstring>
+#include <json/json.h>
+#include "../packager/packager.h"
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+constexpr std::size_t kChunkSize = 1 << 20;
+constexpr std::uint64_t kFilesPerDirectory = 1000;
+
+// SplitMix64 finalizer, used to derive independent per-file streams from one seed
+std::uint64_t mix(std::uint64_t value) {
+    value += 0x9e3779b97f4a7c15ULL;
+    value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    value = (value ^ (value >> 27)) * 0x94d049bb133111ebULL;
+    return value ^ (value >> 31);
+}
+
+void fillChunk(std::vector<char>& chunk, std::size_t size, DataPattern pattern, std::mt19937_64& rng) {
+    switch (pattern) {
+        case DataPattern::Zeros:
+            std::memset(chunk.data(), 0, size);
+            break;
+        case DataPattern::Random:
+            for (std::size_t i = 0; i < size; i += sizeof(std::uint64_t)) {
+                std::uint64_t value = rng();
+                std::memcpy(chunk.data() + i, &value, std::min(sizeof(value), size - i));
+            }
+            break;
+        case DataPattern::Text: {
+            static const char* words[] = {
+                "player ", "level ", "texture ", "shader ", "sound ", "mesh ", "save ", "config ",
+                "enemy ", "quest ", "item ", "dialog ", "map ", "script ", "sprite ", "font\n"
+            };
+            std::size_t offset = 0;
+            while (offset < size) {
+                const char* word = words[rng() % 16];
+                std::size_t length = std::min(std::strlen(word), size - offset);
+                std::memcpy(chunk.data() + offset, word, length);
+                offset += length;
+            }
+            break;
+        }
+    }
+}
+
+} // namespace
+
+Generator::Generator(std::uint64_t seed) : m_seed(seed) {
+}
+
+Generator::~Generator() = default;
+
+std::uint64_t Generator::streamSeed(std::uint64_t fileIndex) const {
+    return mix(m_seed ^ mix(fileIndex));
+}
+
+bool Generator::writeFile(const std::string& path, std::uint64_t size, DataPattern pattern,
+                          std::uint64_t fileIndex) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to create file: " << path << std::endl;
+        return false;
+    }
+
+    std::mt19937_64 rng(streamSeed(fileIndex));
+    std::vector<char> chunk(static_cast<std::size_t>(std::min<std::uint64_t>(size, kChunkSize)));
+
+    std::uint64_t remaining = size;
+    while (remaining > 0) {
+        std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(remaining, kChunkSize));
+        fillChunk(chunk, length, pattern, rng);
+        file.write(chunk.data(), static_cast<std::streamsize>(length));
+        if (!file) {
+            std::cerr << "Failed to write file: " << path << std::endl;
+            return false;
+        }
+        remaining -= length;
+    }
+
+    return true;
+}
+
+std::string Generator::mainExecutableFor(const std::string& platform) {
+    if (platform == "windows") {
+        return "bin/game.exe";
+    } else if (platform == "linux") {
+        return "bin/game";
+    }
+    return "bin/game.iso";
+}
+
+std::uint64_t Generator::generateGameTree(const GameTreeSpec& spec, const std::string& directory,
+                                          const std::string& platform) {
+    fs::path gameDir = fs::path(directory) / "game";
+    std::uint64_t fileIndex = 0;
+    std::uint64_t bytes = 0;
+
+    try {
+        // Main executable, always small and compressible
+        fs::path mainPath = gameDir / mainExecutableFor(platform);
+        fs::create_directories(mainPath.parent_path());
+        {
+            std::ofstream file(mainPath);
+            file << "#!/bin/sh\necho \"XEmuRun synthetic game (seed " << m_seed << ")\"\n";
+        }
+        fs::permissions(mainPath, fs::perms::owner_all | fs::perms::group_read | fs::perms::group_exec |
+                                  fs::perms::others_read | fs::perms::others_exec);
+
+        // Tiny files, spread over directories so no single directory gets huge
+        for (std::uint64_t i = 0; i < spec.tinyFileCount; i++) {
+            fs::path dir = gameDir / "tiny" / ("d" + std::to_string(i / kFilesPerDirectory));
+            if (i % kFilesPerDirectory == 0) {
+                fs::create_directories(dir);
+            }
+            if (!writeFile((dir / ("f" + std::to_string(i) + ".dat")).string(), spec.tinyFileSize,
+                           spec.pattern, fileIndex++)) {
+                return bytes;
+            }
+            bytes += spec.tinyFileSize;
+        }
+
+        // Large blobs
+        if (spec.blobCount > 0) {
+            fs::create_directories(gameDir / "blobs");
+        }
+        for (std::uint64_t i = 0; i < spec.blobCount; i++) {
+            std::string path = (gameDir / "blobs" / ("blob" + std::to_string(i) + ".bin")).string();
+            std::cout << "Writing blob " << (i + 1) << "/" << spec.blobCount << " ("
+                      << spec.blobSize << " bytes)..." << std::endl;
+            if (!writeFile(path, spec.blobSize, spec.pattern, fileIndex++)) {
+                return bytes;
+            }
+            bytes += spec.blobSize;
+        }
+
+        // Deep directory chains with one small file per level
+        for (int chain = 0; chain < spec.treeWidth && spec.treeDepth > 0; chain++) {
+            fs::path dir = gameDir / "deep" / ("chain" + std::to_string(chain));
+            for (int level = 0; level < spec.treeDepth; level++) {
+                dir /= "level" + std::to_string(level);
+                fs::create_directories(dir);
+                if (!writeFile((dir / "data.bin").string(), spec.tinyFileSize, spec.pattern, fileIndex++)) {
+                    return bytes;
+                }
+                bytes += spec.tinyFileSize;
+            }
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Failed to generate game tree: " << e.what() << std::endl;
+    }
+
+    return bytes;
+}
+
+bool Generator::generatePackage(const GameTreeSpec& spec, const std::string& outputDir,
+                                const std::string& name, const std::string& platform) {
+    // Staged next to the package, so the packager archives the tree where
+    // it was written instead of copying it
+    std::string stagingDir = (fs::path(outputDir) / (".XEmuGen_" + name)).string();
+
+    try {
+        if (fs::exists(stagingDir)) {
+            fs::remove_all(stagingDir);
+        }
+        fs::create_directories(stagingDir);
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Failed to create staging directory: " << e.what() << std::endl;
+        return false;
+    }
+
+    std::cout << "Generating game tree in " << stagingDir << "..." << std::endl;
+    std::uint64_t bytes = generateGameTree(spec, stagingDir, platform);
+    std::cout << "Generated " << bytes << " bytes of game data" << std::endl;
+
+    // Go through the real packaging path so manifests and archives match production
+    Packager packager;
+    packager.setGamePath((fs::path(stagingDir) / "game").string());
+    packager.setOutputPath(outputDir);
+    packager.setGameName(name);
+    packager.setPlatform(platform);
+    packager.setMainExecutable(mainExecutableFor(platform));
+    packager.setPackageInPlace(true);
+    packager.addConfigValue("generator_seed", std::to_string(m_seed));
+
+    bool success = packager.createPackage();
+
+    std::error_code ec;
+    fs::remove_all(stagingDir, ec);
+
+    return success;
+}
+
+bool Generator::generateLibrary(const std::string& libraryPath, std::uint64_t entryCount,
+                                const std::string& packagesDir) {
+    static const char* platforms[] = {
+        "windows", "linux", "playstation4", "playstation5", "xbox", "xbox_series"
+    };
+
+    std::mt19937_64 rng(streamSeed(0));
+
+    // Same layout as GameLibrary::saveLibrary
+    Json::Value root(Json::objectValue);
+    for (std::uint64_t i = 0; i < entryCount; i++) {
+        std::string name = "Game " + std::to_string(i);
+        std::string platform = platforms[rng() % 6];
+        std::string packagePath = (fs::path(packagesDir) / (name + ".XEmupkg")).string();
+
+        Json::Value game;
+        game["name"] = name;
+        game["platform"] = platform;
+        game["iconPath"] = "";
+        game["description"] = "Synthetic library entry " + std::to_string(i) + " (seed " +
+                              std::to_string(m_seed) + ")";
+        game["version"] = std::to_string(1 + rng() % 3) + ".0." + std::to_string(rng() % 10);
+        game["mainExecutable"] = mainExecutableFor(platform);
+        root[packagePath] = game;
+    }
+
+    try {
+        fs::path parent = fs::path(libraryPath).parent_path();
+        if (!parent.empty()) {
+            fs::create_directories(parent);
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Failed to create library directory: " << e.what() << std::endl;
+        return false;
+    }
+
+    std::ofstream file(libraryPath);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open library file for writing: " << libraryPath << std::endl;
+        return false;
+    }
+
+    Json::StyledWriter writer;
+    file << writer.write(root);
+    return true;
+}
+
+bool Generator::parsePattern(const std::string& name, DataPattern& pattern) {
+    if (name == "random") {
+        pattern = DataPattern::Random;
+    } else if (name == "zeros") {
+        pattern = DataPattern::Zeros;
+    } else if (name == "text") {
+        pattern = DataPattern::Text;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool Generator::parseSize(const std::string& text, std::uint64_t& size) {
+    // stoull would accept leading blanks and wrap a minus sign
+    if (text.empty() || !std::isdigit(static_cast<unsigned char>(text[0]))) {
+        return false;
+    }
+
+    std::size_t end = 0;
+    unsigned long long value = 0;
+    try {
+        value = std::stoull(text, &end);
+    } catch (const std::exception&) {
+        return false;
+    }
+
+    std::string suffix = text.substr(end);
+    std::uint64_t multiplier = 1;
+    if (suffix.empty() || suffix == "B") {
+        multiplier = 1;
+    } else if (suffix == "K" || suffix == "KiB") {
+        multiplier = 1ULL << 10;
+    } else if (suffix == "M" || suffix == "MiB") {
+        multiplier = 1ULL << 20;
+    } else if (suffix == "G" || suffix == "GiB") {
+        multiplier = 1ULL << 30;
+    } else {
+        return false;
+    }
+
+    size = static_cast<std::uint64_t>(value) * multiplier;
+    return true;
+}
+
+bool Generator::parseCount(const std::string& text, std::uint64_t& count) {
+    if (text.empty() || !std::all_of(text.begin(), text.end(),
+                                     [](unsigned char c) { return std::isdigit(c); })) {
+        return false;
+    }
+
+    try {
+        count = std::stoull(text);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+} // namespace XEmuRun
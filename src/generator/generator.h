@@ -0,0 +1,72 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+
+namespace XEmuRun {
+
+// Contents written into generated files
+enum class DataPattern {
+    Random, // incompressible
+    Zeros,  // compresses to almost nothing
+    Text    // repetitive text, compresses moderately
+};
+
+/**
+ * Shape of a synthetic game tree. Every part is optional and they can be
+ * combined, e.g. a million tiny files next to a few huge blobs.
+ */
+struct GameTreeSpec {
+    std::uint64_t tinyFileCount = 0;
+    std::uint64_t tinyFileSize = 128;
+    std::uint64_t blobCount = 0;
+    std::uint64_t blobSize = 0;
+    int treeDepth = 0;       // nesting depth of the deep directory chains
+    int treeWidth = 1;       // number of independent chains
+    DataPattern pattern = DataPattern::Random;
+};
+
+/**
+ * @class Generator
+ * @brief Fabricates deterministic game trees, packages and game libraries.
+ *
+ * The same seed always produces byte-identical output. Packages are built
+ * through Packager so they exercise the real archive writer.
+ */
+class Generator {
+public:
+    explicit Generator(std::uint64_t seed = 1);
+    ~Generator();
+
+    // Writes game/ (including the main executable) below directory.
+    // Returns the number of payload bytes written.
+    std::uint64_t generateGameTree(const GameTreeSpec& spec, const std::string& directory,
+                                   const std::string& platform);
+
+    // Generates a tree in a staging directory inside outputDir and packages
+    // it in place into outputDir/<name>.XEmupkg
+    bool generatePackage(const GameTreeSpec& spec, const std::string& outputDir,
+                         const std::string& name, const std::string& platform);
+
+    // Writes a library.json in GameLibrary's format with entryCount games
+    bool generateLibrary(const std::string& libraryPath, std::uint64_t entryCount,
+                         const std::string& packagesDir);
+
+    // Main executable path (relative to game/) used for a platform
+    static std::string mainExecutableFor(const std::string& platform);
+
+    static bool parsePattern(const std::string& name, DataPattern& pattern);
+    // A byte count with an optional K/M/G suffix, e.g. "20G"
+    static bool parseSize(const std::string& text, std::uint64_t& size);
+    // A plain decimal number, for counts and seeds
+    static bool parseCount(const std::string& text, std::uint64_t& count);
+
+private:
+    std::uint64_t m_seed;
+
+    bool writeFile(const std::string& path, std::uint64_t size, DataPattern pattern,
+                   std::uint64_t fileIndex);
+    std::uint64_t streamSeed(std::uint64_t fileIndex) const;
+};
+
+} // namespace XEmuRun
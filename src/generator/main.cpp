@@ -0,0 +1,151 @@
+#include <iostream>
+#include <string>
+#include <cstdlib>
+#include "generator.h"
+
+void printUsage() {
+    std::cout << "XEmuGen - Generate synthetic packages and libraries for scale testing\n\n";
+    std::cout << "Usage: xemugen package --output-path <dir> --name <name> [options]\n";
+    std::cout << "       xemugen library --output <library.json> --entries <count> [options]\n\n";
+    std::cout << "Package options:\n";
+    std::cout << "  --platform <platform>   Platform written to the manifest (default: linux)\n";
+    std::cout << "  --preset <preset>       tiny-files, huge-blobs, deep-tree or mixed\n";
+    std::cout << "  --tiny-files <count>    Number of tiny files\n";
+    std::cout << "  --tiny-size <size>      Size of each tiny file (default: 128)\n";
+    std::cout << "  --blobs <count>         Number of large blobs\n";
+    std::cout << "  --blob-size <size>      Size of each blob, e.g. 20G\n";
+    std::cout << "  --depth <levels>        Depth of the deep directory chains\n";
+    std::cout << "  --width <chains>        Number of deep directory chains (default: 1)\n";
+    std::cout << "  --data <pattern>        random (incompressible), zeros or text\n\n";
+    std::cout << "Library options:\n";
+    std::cout << "  --packages-dir <dir>    Directory used for the package paths (default: /games)\n\n";
+    std::cout << "Common options:\n";
+    std::cout << "  --seed <number>         Seed for deterministic output (default: 1)\n";
+    std::cout << "  --help, -h              Display this help message\n";
+}
+
+bool applyPreset(const std::string& preset, XEmuRun::GameTreeSpec& spec) {
+    if (preset == "tiny-files") {
+        spec.tinyFileCount = 1000000;
+        spec.tinyFileSize = 128;
+    } else if (preset == "huge-blobs") {
+        spec.blobCount = 4;
+        spec.blobSize = 20ULL << 30;
+    } else if (preset == "deep-tree") {
+        spec.treeDepth = 64;
+        spec.treeWidth = 16;
+    } else if (preset == "mixed") {
+        spec.tinyFileCount = 10000;
+        spec.blobCount = 2;
+        spec.blobSize = 256ULL << 20;
+        spec.treeDepth = 16;
+        spec.treeWidth = 4;
+        spec.pattern = XEmuRun::DataPattern::Text;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 2) {
+        printUsage();
+        return 1;
+    }
+
+    std::string mode = argv[1];
+    if (mode == "--help" || mode == "-h") {
+        printUsage();
+        return 0;
+    }
+    if (mode != "package" && mode != "library") {
+        std::cerr << "Unknown mode: " << mode << std::endl;
+        printUsage();
+        return 1;
+    }
+
+    XEmuRun::GameTreeSpec spec;
+    std::uint64_t seed = 1;
+    std::uint64_t entries = 0;
+    std::string outputPath;
+    std::string name;
+    std::string platform = "linux";
+    std::string packagesDir = "/games";
+
+    // Parse command line arguments
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool ok = true;
+
+        if ((arg == "--output-path" || arg == "--output") && hasValue) {
+            outputPath = argv[++i];
+        } else if (arg == "--name" && hasValue) {
+            name = argv[++i];
+        } else if (arg == "--platform" && hasValue) {
+            platform = argv[++i];
+        } else if (arg == "--preset" && hasValue) {
+            ok = applyPreset(argv[++i], spec);
+        } else if (arg == "--tiny-files" && hasValue) {
+            ok = XEmuRun::Generator::parseCount(argv[++i], spec.tinyFileCount);
+        } else if (arg == "--tiny-size" && hasValue) {
+            ok = XEmuRun::Generator::parseSize(argv[++i], spec.tinyFileSize);
+        } else if (arg == "--blobs" && hasValue) {
+            ok = XEmuRun::Generator::parseCount(argv[++i], spec.blobCount);
+        } else if (arg == "--blob-size" && hasValue) {
+            ok = XEmuRun::Generator::parseSize(argv[++i], spec.blobSize);
+        } else if (arg == "--depth" && hasValue) {
+            spec.treeDepth = std::atoi(argv[++i]);
+        } else if (arg == "--width" && hasValue) {
+            spec.treeWidth = std::atoi(argv[++i]);
+        } else if (arg == "--data" && hasValue) {
+            ok = XEmuRun::Generator::parsePattern(argv[++i], spec.pattern);
+        } else if (arg == "--entries" && hasValue) {
+            ok = XEmuRun::Generator::parseCount(argv[++i], entries);
+        } else if (arg == "--packages-dir" && hasValue) {
+            packagesDir = argv[++i];
+        } else if (arg == "--seed" && hasValue) {
+            ok = XEmuRun::Generator::parseCount(argv[++i], seed);
+        } else if (arg == "--help" || arg == "-h") {
+            printUsage();
+            return 0;
+        } else {
+            std::cerr << "Unknown argument: " << arg << std::endl;
+            printUsage();
+            return 1;
+        }
+
+        if (!ok) {
+            std::cerr << "Invalid value for " << arg << ": " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    if (outputPath.empty()) {
+        std::cerr << "An output path is required" << std::endl;
+        return 1;
+    }
+
+    XEmuRun::Generator generator(seed);
+
+    if (mode == "library") {
+        if (!generator.generateLibrary(outputPath, entries, packagesDir)) {
+            std::cerr << "Failed to generate library" << std::endl;
+            return 1;
+        }
+        std::cout << "Library with " << entries << " entries written to " << outputPath << std::endl;
+        return 0;
+    }
+
+    if (name.empty()) {
+        std::cerr << "A package name is required" << std::endl;
+        return 1;
+    }
+
+    if (!generator.generatePackage(spec, outputPath, name, platform)) {
+        std::cerr << "Failed to generate package" << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
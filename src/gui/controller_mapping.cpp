@@ -341,8 +341,6 @@ void ControllerMapping::saveMapping() {
     // Save to config system
     ConfigManager& configManager = ConfigManager::getInstance();
     if (configManager.initialize()) {
-        Config& emulatorConfig = configManager.getEmulatorConfig(platform.toStdString());
-        
         // Create JSON mapping
         QJsonObject mapping;
         for (auto it = m_currentMapping.constBegin(); it != m_currentMapping.constEnd(); ++it) {
@@ -353,8 +351,10 @@ void ControllerMapping::saveMapping() {
         QString mappingString = QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
         
         // Store in config
-        emulatorConfig.setString("controller_mapping_" + controllerName.toStdString(), 
-                                mappingString.toStdString());
+        configManager.updateEmulatorConfig(platform.toStdString(), [&](Config& emulatorConfig) {
+            emulatorConfig.setString("controller_mapping_" + controllerName.toStdString(), 
+                                    mappingString.toStdString());
+        });
         
         configManager.saveEmulatorConfig(platform.toStdString());
         
@@ -374,9 +374,9 @@ void ControllerMapping::loadMapping() {
     // Load from config system
     ConfigManager& configManager = ConfigManager::getInstance();
     if (configManager.initialize()) {
-        Config& emulatorConfig = configManager.getEmulatorConfig(platform.toStdString());
+        ConfigSnapshot emulatorConfig = configManager.getEmulatorConfig(platform.toStdString());
         
-        std::string mappingString = emulatorConfig.getString(
+        std::string mappingString = emulatorConfig->getString(
             "controller_mapping_" + controllerName.toStdString(), "{}");
         
         // Parse JSON
@@ -2,11 +2,13 @@
 #include <QStandardPaths>
 #include <QTemporaryDir>
 #include <QProcess>
+#include <QJsonArray>
 #include <iostream>
 #include <filesystem>
 #include <fstream>
 #include <json/json.h>
 #include "../utils/archive.h"
+#include "../utils/snapshot.h"
 
 namespace fs = std::filesystem;
 
@@ -27,6 +29,11 @@ GameLibrary::GameLibrary(QObject* parent) : QObject(parent) {
     loadLibrary();
 }
 
+GameLibrary::GameLibrary(const QString& libraryPath, QObject* parent)
+    : QObject(parent), m_libraryPath(libraryPath) {
+    loadLibrary();
+}
+
 GameLibrary::~GameLibrary() {
     saveLibrary();
 }
@@ -72,7 +79,30 @@ GameInfo GameLibrary::getGameInfo(const QString& packagePath) const {
     return GameInfo();
 }
 
+void GameLibrary::recordLaunch(const QString& packagePath, qint64 startedAt, qint64 durationSeconds) {
+    auto it = m_games.find(packagePath);
+    if (it == m_games.end()) {
+        return;
+    }
+    
+    QList<LaunchRecord>& launches = it->launches;
+    launches.append(LaunchRecord{startedAt, durationSeconds});
+    while (launches.size() > kMaxLaunchRecords) {
+        launches.removeFirst();
+    }
+    
+    saveLibrary();
+}
+
 bool GameLibrary::loadLibrary() {
+    const std::string libraryPath = m_libraryPath.toStdString();
+    SnapshotSource source;
+    bool haveSource = statSnapshotSource(libraryPath, source);
+    
+    if (haveSource && loadLibrarySnapshot(libraryPath, source)) {
+        return true;
+    }
+    
     QFile file(m_libraryPath);
     if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
         return false;
@@ -105,9 +135,20 @@ bool GameLibrary::loadLibrary() {
         info.version = gameObj["version"].toString();
         info.mainExecutable = gameObj["mainExecutable"].toString();
         
+        const QJsonArray launches = gameObj["launches"].toArray();
+        for (const QJsonValue& launch : launches) {
+            QJsonObject launchObj = launch.toObject();
+            info.launches.append(LaunchRecord{static_cast<qint64>(launchObj["startedAt"].toDouble()),
+                                              static_cast<qint64>(launchObj["duration"].toDouble())});
+        }
+        
         m_games[packagePath] = info;
     }
     
+    if (haveSource) {
+        writeLibrarySnapshot(libraryPath, source);
+    }
+    
     return true;
 }
 
@@ -129,6 +170,15 @@ bool GameLibrary::saveLibrary() {
         gameObj["version"] = it.value().version;
         gameObj["mainExecutable"] = it.value().mainExecutable;
         
+        QJsonArray launches;
+        for (const LaunchRecord& launch : it.value().launches) {
+            QJsonObject launchObj;
+            launchObj["startedAt"] = static_cast<double>(launch.startedAt);
+            launchObj["duration"] = static_cast<double>(launch.durationSeconds);
+            launches.append(launchObj);
+        }
+        gameObj["launches"] = launches;
+        
         obj[it.key()] = gameObj;
     }
     
@@ -136,9 +186,87 @@ bool GameLibrary::saveLibrary() {
     file.write(doc.toJson());
     file.close();
     
+    const std::string libraryPath = m_libraryPath.toStdString();
+    SnapshotSource source;
+    if (statSnapshotSource(libraryPath, source)) {
+        writeLibrarySnapshot(libraryPath, source);
+    }
+    
     return true;
 }
 
+bool GameLibrary::loadLibrarySnapshot(const std::string& libraryPath, const SnapshotSource& source) {
+    SnapshotReader snapshot;
+    if (!snapshot.open(libraryPath, SnapshotKind::Library, source)) {
+        return false;
+    }
+    
+    auto toQString = [](std::string_view value) {
+        return QString::fromUtf8(value.data(), static_cast<int>(value.size()));
+    };
+    
+    // One record per game, keyed by package path, followed by its fields
+    m_games.clear();
+    GameInfo* info = nullptr;
+    SnapshotEntry entry;
+    while (snapshot.next(entry)) {
+        if (entry.type == SnapshotValueType::Record) {
+            QString packagePath = toQString(entry.key);
+            info = &m_games[packagePath];
+            info->packagePath = packagePath;
+            continue;
+        }
+        if (!info) {
+            continue;
+        }
+        
+        // Launch history: each start time is followed by its duration
+        if (entry.type == SnapshotValueType::Int) {
+            if (entry.key == "launchStartedAt") {
+                info->launches.append(LaunchRecord{entry.intValue, 0});
+            } else if (entry.key == "launchDuration" && !info->launches.isEmpty()) {
+                info->launches.last().durationSeconds = entry.intValue;
+            }
+            continue;
+        }
+        
+        QString value = toQString(entry.stringValue);
+        if (entry.key == "name") {
+            info->name = value;
+        } else if (entry.key == "platform") {
+            info->platform = value;
+        } else if (entry.key == "iconPath") {
+            info->iconPath = value;
+        } else if (entry.key == "description") {
+            info->description = value;
+        } else if (entry.key == "version") {
+            info->version = value;
+        } else if (entry.key == "mainExecutable") {
+            info->mainExecutable = value;
+        }
+    }
+    
+    return true;
+}
+
+void GameLibrary::writeLibrarySnapshot(const std::string& libraryPath, const SnapshotSource& source) const {
+    SnapshotWriter writer(SnapshotKind::Library);
+    for (auto it = m_games.begin(); it != m_games.end(); ++it) {
+        writer.beginRecord(it.key().toStdString());
+        writer.addString("name", it.value().name.toStdString());
+        writer.addString("platform", it.value().platform.toStdString());
+        writer.addString("iconPath", it.value().iconPath.toStdString());
+        writer.addString("description", it.value().description.toStdString());
+        writer.addString("version", it.value().version.toStdString());
+        writer.addString("mainExecutable", it.value().mainExecutable.toStdString());
+        for (const LaunchRecord& launch : it.value().launches) {
+            writer.addInt("launchStartedAt", launch.startedAt);
+            writer.addInt("launchDuration", launch.durationSeconds);
+        }
+    }
+    writer.commitAsync(libraryPath, source);
+}
+
 bool GameLibrary::extractGameInfo(const QString& packagePath, GameInfo& info) {
     QTemporaryDir tempDir;
     if (!tempDir.isValid()) {
@@ -8,9 +8,18 @@
 #include <QDir>
 #include <QJsonDocument>
 #include <QJsonObject>
+#include <string>
 
 namespace XEmuRun {
 
+struct SnapshotSource;
+
+// One launch of a game, as recorded by the launcher
+struct LaunchRecord {
+    qint64 startedAt = 0;       // seconds since the epoch
+    qint64 durationSeconds = 0;
+};
+
 struct GameInfo {
     QString name;
     QString packagePath;
@@ -19,6 +28,7 @@ struct GameInfo {
     QString description;
     QString version;
     QString mainExecutable;
+    QList<LaunchRecord> launches; // oldest first, capped at kMaxLaunchRecords
 };
 
 class GameLibrary : public QObject {
@@ -26,6 +36,8 @@ class GameLibrary : public QObject {
     
 public:
     explicit GameLibrary(QObject* parent = nullptr);
+    // Use an explicit library file instead of the one in the user's data location
+    explicit GameLibrary(const QString& libraryPath, QObject* parent = nullptr);
     ~GameLibrary();
     
     bool addGame(const QString& packagePath);
@@ -33,11 +45,21 @@ public:
     QList<GameInfo> getGames() const;
     GameInfo getGameInfo(const QString& packagePath) const;
     
-private:
+    // Appends to the game's launch history and saves the library
+    void recordLaunch(const QString& packagePath, qint64 startedAt, qint64 durationSeconds);
+    
+    static constexpr int kMaxLaunchRecords = 64;
+    
     bool loadLibrary();
     bool saveLibrary();
+    
+private:
     bool extractGameInfo(const QString& packagePath, GameInfo& info);
     
+    // Binary copy of library.json, valid while the JSON file is unchanged
+    bool loadLibrarySnapshot(const std::string& libraryPath, const SnapshotSource& source);
+    void writeLibrarySnapshot(const std::string& libraryPath, const SnapshotSource& source) const;
+    
     QString m_libraryPath;
     QHash<QString, GameInfo> m_games;
 };
@@ -9,6 +9,8 @@
 #include <QFormLayout>  // Add this for QFormLayout
 #include <QApplication> // Add this for qApp
 #include "../config/config_manager.h"
+#include "../daemon/daemon_client.h"
+#include "prewarm_scheduler.h"
 
 namespace XEmuRun {
 
@@ -138,6 +140,10 @@ void LauncherGui::setupUi() {
     // Create game library handler
     m_gameLibrary = new GameLibrary(this);
     
+    // Extract likely next games while the machine is idle
+    m_prewarmScheduler = new PrewarmScheduler(m_gameLibrary, this);
+    m_prewarmScheduler->start();
+    
     // Setup status bar
     m_statusLabel = new QLabel("Ready");
     statusBar()->addPermanentWidget(m_statusLabel);
@@ -193,8 +199,6 @@ void LauncherGui::loadSettings() {
     // Load emulator paths from ConfigManager
     ConfigManager& configManager = ConfigManager::getInstance();
     if (configManager.initialize()) {
-        Config& systemConfig = configManager.getSystemConfig();
-        
         // Apply theme
         QString theme = m_themeCombo->currentText();
         applyTheme(theme);
@@ -213,14 +217,14 @@ void LauncherGui::saveSettings() {
     // Save emulator paths to ConfigManager
     ConfigManager& configManager = ConfigManager::getInstance();
     if (configManager.initialize()) {
-        Config& systemConfig = configManager.getSystemConfig();
-        
-        for (int row = 0; row < m_emulatorPathsModel->rowCount(); ++row) {
-            QString platform = m_emulatorPathsModel->data(m_emulatorPathsModel->index(row, 0)).toString();
-            QString path = m_emulatorPathsModel->data(m_emulatorPathsModel->index(row, 1)).toString();
-            
-            systemConfig.setString("emulator_path_" + platform.toStdString(), path.toStdString());
-        }
+        configManager.updateSystemConfig([this](Config& systemConfig) {
+            for (int row = 0; row < m_emulatorPathsModel->rowCount(); ++row) {
+                QString platform = m_emulatorPathsModel->data(m_emulatorPathsModel->index(row, 0)).toString();
+                QString path = m_emulatorPathsModel->data(m_emulatorPathsModel->index(row, 1)).toString();
+                
+                systemConfig.setString("emulator_path_" + platform.toStdString(), path.toStdString());
+            }
+        });
         
         configManager.saveSystemConfig();
     }
@@ -231,7 +235,7 @@ void LauncherGui::populatePlatforms() {
     
     ConfigManager& configManager = ConfigManager::getInstance();
     if (configManager.initialize()) {
-        Config& systemConfig = configManager.getSystemConfig();
+        ConfigSnapshot systemConfig = configManager.getSystemConfig();
         
         std::vector<std::string> platforms = {
             "windows", "linux", "playstation4", "playstation5", "xbox", "xbox_series"
@@ -239,7 +243,7 @@ void LauncherGui::populatePlatforms() {
         
         for (const auto& platform : platforms) {
             QString platformName = QString::fromStdString(platform);
-            QString path = QString::fromStdString(systemConfig.getString("emulator_path_" + platform, ""));
+            QString path = QString::fromStdString(systemConfig->getString("emulator_path_" + platform, ""));
             
             QList<QStandardItem*> row;
             row << new QStandardItem(platformName);
@@ -286,9 +290,25 @@ void LauncherGui::launchGame() {
     
     statusBar()->showMessage("Launching game...", 2000);
     
+    m_prewarmScheduler->suspendForLaunch(packagePath);
+    qint64 startedAt = QDateTime::currentSecsSinceEpoch();
+    
+    // A running xemurund has the package prepared already
+    DaemonClient daemon;
+    int exitCode = 1;
+    if (daemon.connect() && daemon.launch(packagePath.toStdString(), exitCode)) {
+        m_gameLibrary->recordLaunch(packagePath, startedAt, QDateTime::currentSecsSinceEpoch() - startedAt);
+        if (exitCode != 0) {
+            QMessageBox::warning(this, "Launch Error", 
+                                "The game exited with an error code: " + QString::number(exitCode));
+        }
+        return;
+    }
+    
     try {
         if (m_launcher->loadPackage(packagePath.toStdString())) {
             int result = m_launcher->runGame();
+            m_gameLibrary->recordLaunch(packagePath, startedAt, QDateTime::currentSecsSinceEpoch() - startedAt);
             
             if (result != 0) {
                 QMessageBox::warning(this, "Launch Error", 
@@ -348,6 +368,13 @@ void LauncherGui::gameSelected(QListWidgetItem* item) {
     
     GameInfo game = m_gameLibrary->getGameInfo(packagePath);
     showGameDetails(game);
+    
+    // Start emulator setup while the user decides; a running xemurund
+    // prepares packages itself
+    DaemonClient daemon;
+    if (!daemon.connect() && !game.platform.isEmpty()) {
+        m_launcher->prewarm(game.platform.toStdString());
+    }
 }
 
 void LauncherGui::showGameDetails(const GameInfo& game) {
@@ -23,6 +23,8 @@
 
 namespace XEmuRun {
 
+class PrewarmScheduler;
+
 class LauncherGui : public QMainWindow {
     Q_OBJECT
     
@@ -59,6 +61,7 @@ private:
     // Library tab
     QWidget* m_libraryTab;
     GameLibrary* m_gameLibrary;
+    PrewarmScheduler* m_prewarmScheduler;
     QListWidget* m_gamesList;
     QPushButton* m_importButton;
     QPushButton* m_launchButton;
@@ -5,6 +5,8 @@
 #include <iostream>
 #include "launcher_gui.h"
 #include "../config/config_manager.h"
+#include "../utils/trace.h"
+#include "../daemon/daemon_client.h"
 
 // Forward declaration for direct launch function
 bool launchGameDirectly(const QString& packagePath);
@@ -28,8 +30,27 @@ int main(int argc, char *argv[]) {
     QCommandLineOption directLaunchOption("direct-launch", "Launch the specified package directly without showing the GUI");
     parser.addOption(directLaunchOption);
     
+    QCommandLineOption traceOption("trace", "Record launch-phase spans to trace.json (Chrome trace / Perfetto format)");
+    parser.addOption(traceOption);
+    
     parser.process(app);
     
+    const bool trace = parser.isSet(traceOption);
+    if (trace) {
+        XEmuRun::Tracer::getInstance().enable();
+    }
+    
+    // Direct launches go through a running xemurund without loading any
+    // configuration here
+    const QStringList args = parser.positionalArguments();
+    if (parser.isSet(directLaunchOption) && !trace && !args.isEmpty()) {
+        XEmuRun::DaemonClient client;
+        int exitCode = 1;
+        if (client.connect() && client.launch(args.first().toStdString(), exitCode)) {
+            return exitCode == 0 ? 0 : 1;
+        }
+    }
+    
     // Initialize configuration system
     XEmuRun::ConfigManager& configManager = XEmuRun::ConfigManager::getInstance();
     if (!configManager.initialize()) {
@@ -39,20 +60,27 @@ int main(int argc, char *argv[]) {
     }
     
     // Check if a package was specified
-    const QStringList args = parser.positionalArguments();
     if (!args.isEmpty()) {
         QString packagePath = args.first();
         if (QFile::exists(packagePath)) {
             // If direct launch option is specified, launch the game without showing the GUI
             if (parser.isSet(directLaunchOption)) {
-                return launchGameDirectly(packagePath) ? 0 : 1;
+                int result = launchGameDirectly(packagePath) ? 0 : 1;
+                if (trace) {
+                    XEmuRun::Tracer::getInstance().writeToFile("trace.json");
+                }
+                return result;
             }
             
             // Otherwise, show the GUI and import the package
             XEmuRun::LauncherGui mainWindow;
             mainWindow.show();
             mainWindow.importAndLaunchGame(packagePath);
-            return app.exec();
+            int result = app.exec();
+            if (trace) {
+                XEmuRun::Tracer::getInstance().writeToFile("trace.json");
+            }
+            return result;
         } else {
             std::cerr << "Package file does not exist: " << packagePath.toStdString() << std::endl;
             return 1;
@@ -63,7 +91,11 @@ int main(int argc, char *argv[]) {
     XEmuRun::LauncherGui mainWindow;
     mainWindow.show();
     
-    return app.exec();
+    int result = app.exec();
+    if (trace) {
+        XEmuRun::Tracer::getInstance().writeToFile("trace.json");
+    }
+    return result;
 }
 
 bool launchGameDirectly(const QString& packagePath) {
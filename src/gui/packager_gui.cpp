@@ -27,7 +27,7 @@ PackagerGui::PackagerGui(QWidget *parent)
     ConfigManager& configManager = ConfigManager::getInstance();
     if (configManager.initialize()) {
         // Set default output directory if available
-        std::string defaultOutputDir = configManager.getSystemConfig().getString("default_output_directory", "");
+        std::string defaultOutputDir(configManager.getSystemConfig()->get(Keys::DefaultOutputDirectory));
         if (!defaultOutputDir.empty()) {
             m_outputPathEdit->setText(QString::fromStdString(defaultOutputDir));
         }
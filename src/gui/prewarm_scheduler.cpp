@@ -0,0 +1,223 @@
+#include "prewarm_scheduler.h"
+#include "../config/config_manager.h"
+#include "../package/package.h"
+#include "../utils/archive.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+// From linux/ioprio.h, which glibc does not wrap
+constexpr int kIoprioWhoProcess = 1;
+constexpr int kIoprioClassIdle = 3;
+constexpr int kIoprioClassShift = 13;
+
+// Only launches from the last 30 days count, each worth half as much per
+// week of age
+constexpr qint64 kHistoryWindowSeconds = 30 * 24 * 3600;
+constexpr double kHalfLifeSeconds = 7 * 24 * 3600;
+
+// Launches within this many minutes of the current time of day count double
+constexpr int kTimeOfDayWindowMinutes = 60;
+
+void lowerWorkerPriority() {
+    // Both apply to the calling thread only; the GUI is unaffected
+    if (syscall(SYS_ioprio_set, kIoprioWhoProcess, 0, kIoprioClassIdle << kIoprioClassShift) != 0) {
+        std::cerr << "Could not switch pre-extraction to idle I/O priority" << std::endl;
+    }
+    setpriority(PRIO_PROCESS, static_cast<id_t>(syscall(SYS_gettid)), 19);
+}
+
+// Both tiers: a title pre-extracted to RAM takes its share of the budget too
+uint64_t extractionCacheSize() {
+    uint64_t total = 0;
+    for (const std::string& root : {Package::getExtractionRoot(), Package::getRamExtractionRoot()}) {
+        if (root.empty()) {
+            continue;
+        }
+        std::error_code ec;
+        for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec)) {
+                total += it->file_size(ec);
+            }
+        }
+    }
+    return total;
+}
+
+} // namespace
+
+PrewarmScheduler::PrewarmScheduler(GameLibrary* library, QObject* parent)
+    : QObject(parent), m_library(library), m_timer(new QTimer(this)) {
+    connect(m_timer, &QTimer::timeout, this, &PrewarmScheduler::tick);
+}
+
+PrewarmScheduler::~PrewarmScheduler() {
+    // An extraction in progress cannot be interrupted; let it complete
+    m_suspended = true;
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void PrewarmScheduler::start(int intervalMs) {
+    m_timer->start(intervalMs);
+}
+
+void PrewarmScheduler::suspendForLaunch(const QString& packagePath) {
+    // Set under the lock, so the worker either sees it before taking its
+    // next package or has already published that package here
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_suspended = true;
+
+    // Another title's extraction runs at idle priority and is left to
+    // finish alongside the launch; only the launched package's own would
+    // race it for the extraction directory
+    std::string launched = packagePath.toStdString();
+    auto isLaunched = [&launched](const std::string& current) {
+        std::error_code ec;
+        return !current.empty() && (current == launched || fs::equivalent(current, launched, ec));
+    };
+    if (isLaunched(m_currentPackage)) {
+        std::cout << "Waiting for pre-extraction of " << launched << " to finish" << std::endl;
+        m_packageDone.wait(lock, [&] { return !isLaunched(m_currentPackage); });
+    }
+}
+
+QStringList PrewarmScheduler::rankGames(const QList<GameInfo>& games, const QDateTime& now) {
+    const qint64 nowSeconds = now.toSecsSinceEpoch();
+    const int nowMinute = now.time().hour() * 60 + now.time().minute();
+
+    // Summing a recency weight over every launch rewards frequency too
+    QList<QPair<double, QString>> scored;
+    for (const GameInfo& game : games) {
+        double score = 0.0;
+        for (const LaunchRecord& launch : game.launches) {
+            qint64 age = nowSeconds - launch.startedAt;
+            if (age < 0 || age > kHistoryWindowSeconds) {
+                continue;
+            }
+
+            double weight = std::exp2(-static_cast<double>(age) / kHalfLifeSeconds);
+
+            QTime startTime = QDateTime::fromSecsSinceEpoch(launch.startedAt).time();
+            int distance = std::abs(startTime.hour() * 60 + startTime.minute() - nowMinute);
+            distance = std::min(distance, 24 * 60 - distance);
+            if (distance <= kTimeOfDayWindowMinutes) {
+                weight *= 2.0;
+            }
+
+            score += weight;
+        }
+
+        if (score > 0.0) {
+            scored.append(qMakePair(score, game.packagePath));
+        }
+    }
+
+    std::sort(scored.begin(), scored.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+    QStringList ranked;
+    for (const auto& entry : scored) {
+        ranked.append(entry.second);
+    }
+    return ranked;
+}
+
+bool PrewarmScheduler::isIdle() {
+    double load = 0.0;
+    if (getloadavg(&load, 1) != 1) {
+        return false;
+    }
+
+    unsigned cpus = std::max(1u, std::thread::hardware_concurrency());
+    return load < 0.25 * cpus;
+}
+
+void PrewarmScheduler::tick() {
+    // Also the GUI's chance to give RAM extractions back under pressure
+    Package::trimRamExtractions();
+
+    if (m_workerBusy || !isIdle()) {
+        return;
+    }
+
+    ConfigSnapshot systemConfig = ConfigManager::getInstance().getSystemConfig();
+    if (!systemConfig || !systemConfig->get(Keys::PrewarmEnabled)) {
+        return;
+    }
+
+    int maxGames = std::max(0, systemConfig->get(Keys::PrewarmMaxTitles));
+    uint64_t budgetBytes = static_cast<uint64_t>(std::max(0, systemConfig->get(Keys::PrewarmDiskBudgetMb))) << 20;
+
+    // The hot set is the top of the ranking; only its missing members are
+    // extracted
+    QStringList ranked = rankGames(m_library->getGames(), QDateTime::currentDateTime());
+    std::vector<std::string> packages;
+    for (int i = 0; i < ranked.size() && i < maxGames; ++i) {
+        std::string packagePath = ranked[i].toStdString();
+        if (!Package::isExtracted(packagePath)) {
+            packages.push_back(std::move(packagePath));
+        }
+    }
+    if (packages.empty()) {
+        return;
+    }
+
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+    m_suspended = false;
+    m_workerBusy = true;
+    m_worker = std::thread(&PrewarmScheduler::runWorker, this, std::move(packages), budgetBytes);
+}
+
+void PrewarmScheduler::runWorker(std::vector<std::string> packages, uint64_t budgetBytes) {
+    lowerWorkerPriority();
+
+    uint64_t used = extractionCacheSize();
+    for (const std::string& packagePath : packages) {
+        uint64_t size = 0;
+        if (!archiveUncompressedSize(packagePath, size)) {
+            continue;
+        }
+        if (used + size > budgetBytes) {
+            std::cout << "Not pre-extracting " << packagePath << ": disk budget reached" << std::endl;
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_suspended) {
+                break;
+            }
+            m_currentPackage = packagePath;
+        }
+
+        std::cout << "Pre-extracting " << packagePath << std::endl;
+        // Never evicts another member of the hot set from RAM to make room
+        if (Package::preExtract(packagePath, Package::ExtractionTier::RamWithoutEviction)) {
+            used += size;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_currentPackage.clear();
+        }
+        m_packageDone.notify_all();
+    }
+
+    m_workerBusy = false;
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <QObject>
+#include <QStringList>
+#include <QDateTime>
+#include <QTimer>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "game_library.h"
+
+namespace XEmuRun {
+
+/**
+ * @class PrewarmScheduler
+ * @brief Pre-extracts the games most likely to be launched next while the
+ * machine is idle.
+ *
+ * Games are ranked from their launch history by recency, frequency and how
+ * often they were started around the current time of day. Extraction runs
+ * on a worker thread in the idle I/O class at the lowest CPU priority. It
+ * stops before the extraction cache would exceed the configured disk budget.
+ */
+class PrewarmScheduler : public QObject {
+    Q_OBJECT
+
+public:
+    explicit PrewarmScheduler(GameLibrary* library, QObject* parent = nullptr);
+    ~PrewarmScheduler();
+
+    void start(int intervalMs = 60000);
+
+    // Called before a launch: the worker takes no further packages until
+    // the next idle tick. An extraction already running cannot be
+    // interrupted; the call waits for it only if it is of the launched
+    // package, which would otherwise race it for the same directory.
+    void suspendForLaunch(const QString& packagePath);
+
+    // Package paths with launch history, most likely first
+    static QStringList rankGames(const QList<GameInfo>& games, const QDateTime& now);
+
+private slots:
+    void tick();
+
+private:
+    static bool isIdle();
+    void runWorker(std::vector<std::string> packages, uint64_t budgetBytes);
+
+    GameLibrary* m_library;
+    QTimer* m_timer;
+
+    std::thread m_worker;
+    std::atomic<bool> m_workerBusy{false};
+    std::atomic<bool> m_suspended{false};
+
+    std::mutex m_mutex;
+    std::condition_variable m_packageDone;
+    std::string m_currentPackage; // being extracted; empty between items
+};
+
+} // namespace XEmuRun
@@ -0,0 +1,156 @@
+#include "emulator_registry.h"
+#include "../emulators/emulator_plugin.h"
+#include "../utils/trace.h"
+#include <iostream>
+#include <filesystem>
+#include <cstdlib>
+#include <cstring>
+#include <dlfcn.h>
+
+#ifndef XEMURUN_EMULATOR_INSTALL_DIR
+#define XEMURUN_EMULATOR_INSTALL_DIR "/usr/local/lib/xemurun/emulators"
+#endif
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+EmulatorRegistry& EmulatorRegistry::getInstance() {
+    static EmulatorRegistry instance;
+    return instance;
+}
+
+EmulatorRegistry::EmulatorRegistry() {
+    // Which plugin module serves which platform. Kept here rather than
+    // discovered so that resolving a platform never opens unrelated modules.
+    m_platformModules = {
+        {"windows", "windows"},
+        {"linux", "linux"},
+        {"playstation4", "playstation"},
+        {"playstation5", "playstation"},
+        {"xbox", "xbox"},
+        {"xbox_360", "xbox"},
+        {"xbox_one", "xbox"},
+        {"xbox_series", "xbox"}
+    };
+
+    // The PlayStation cores emulate on a thread of the launcher itself
+    m_inProcessModules = {"playstation"};
+}
+
+bool EmulatorRegistry::runsInProcess(const std::string& platform) const {
+    auto it = m_platformModules.find(platform);
+    return it != m_platformModules.end() && m_inProcessModules.count(it->second) > 0;
+}
+
+std::vector<std::string> EmulatorRegistry::getSearchPaths() const {
+    std::vector<std::string> paths;
+
+    // Explicit override, colon separated like PATH
+    const char* envPaths = std::getenv("XEMURUN_EMULATOR_PATH");
+    if (envPaths && *envPaths) {
+        std::string list = envPaths;
+        size_t start = 0;
+        while (start <= list.size()) {
+            size_t end = list.find(':', start);
+            if (end == std::string::npos) {
+                end = list.size();
+            }
+            if (end > start) {
+                paths.push_back(list.substr(start, end - start));
+            }
+            start = end + 1;
+        }
+    }
+
+    // Next to the executable (build tree) and the relative install location
+    std::error_code ec;
+    fs::path exe = fs::read_symlink("/proc/self/exe", ec);
+    if (!ec) {
+        paths.push_back((exe.parent_path() / "emulators").string());
+        paths.push_back((exe.parent_path().parent_path() / "lib" / "xemurun" / "emulators").string());
+    }
+
+    paths.push_back(XEMURUN_EMULATOR_INSTALL_DIR);
+    return paths;
+}
+
+const XEmuRunEmulatorPlugin* EmulatorRegistry::loadPlugin(const std::string& module) {
+    auto it = m_plugins.find(module);
+    if (it != m_plugins.end()) {
+        return it->second;
+    }
+
+    XEMURUN_TRACE_SCOPE("emulator", "EmulatorRegistry::loadPlugin", module.c_str());
+
+    std::string fileName = "xemurun-emu-" + module + ".so";
+
+    for (const auto& dir : getSearchPaths()) {
+        std::string path = (fs::path(dir) / fileName).string();
+        if (!fs::exists(path)) {
+            continue;
+        }
+
+        void* handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+        if (!handle) {
+            std::cerr << "Failed to load emulator plugin " << path << ": " << dlerror() << std::endl;
+            continue;
+        }
+
+        auto entry = reinterpret_cast<XEmuRunEmulatorPluginEntry>(dlsym(handle, XEMURUN_EMULATOR_PLUGIN_ENTRY));
+        const XEmuRunEmulatorPlugin* plugin = entry ? entry() : nullptr;
+
+        if (!plugin) {
+            std::cerr << "Emulator plugin has no entry point: " << path << std::endl;
+            dlclose(handle);
+            continue;
+        }
+
+        if (plugin->abiVersion != XEMURUN_EMULATOR_ABI_VERSION) {
+            std::cerr << "Emulator plugin " << path << " has ABI version " << plugin->abiVersion
+                      << ", expected " << XEMURUN_EMULATOR_ABI_VERSION << std::endl;
+            dlclose(handle);
+            continue;
+        }
+
+        // The handle is intentionally never closed: emulator objects and
+        // their vtables live in the module until the process exits.
+        m_plugins[module] = plugin;
+        return plugin;
+    }
+
+    std::cerr << "Emulator plugin not found: " << fileName << std::endl;
+    m_plugins[module] = nullptr;
+    return nullptr;
+}
+
+EmulatorHandle EmulatorRegistry::create(const std::string& platform) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    auto it = m_platformModules.find(platform);
+    if (it == m_platformModules.end()) {
+        return EmulatorHandle();
+    }
+
+    const XEmuRunEmulatorPlugin* plugin = loadPlugin(it->second);
+    if (!plugin) {
+        return EmulatorHandle();
+    }
+
+    // The plugin must claim the platform it was picked for
+    bool supported = false;
+    for (const char* const* p = plugin->platforms; p && *p; ++p) {
+        if (platform == *p) {
+            supported = true;
+            break;
+        }
+    }
+    if (!supported) {
+        std::cerr << "Emulator plugin " << plugin->name << " does not support platform: " << platform << std::endl;
+        return EmulatorHandle();
+    }
+
+    return EmulatorHandle(plugin->create(platform.c_str()), EmulatorDeleter{plugin->destroy});
+}
+
+} // namespace XEmuRun
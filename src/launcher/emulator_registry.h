@@ -0,0 +1,68 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <map>
+#include <set>
+#include <memory>
+#include <mutex>
+#include "../emulators/emulator_interface.h"
+
+struct XEmuRunEmulatorPlugin;
+
+namespace XEmuRun {
+
+// Hands emulator objects back to the plugin that created them
+struct EmulatorDeleter {
+    void (*destroy)(EmulatorInterface*) = nullptr;
+
+    void operator()(EmulatorInterface* emulator) const {
+        if (emulator && destroy) {
+            // Stop background preparation while the whole object still exists
+            emulator->terminate();
+            destroy(emulator);
+        }
+    }
+};
+
+using EmulatorHandle = std::unique_ptr<EmulatorInterface, EmulatorDeleter>;
+
+/**
+ * @class EmulatorRegistry
+ * @brief Loads emulator backends on demand from plugin modules.
+ *
+ * Only the module serving the requested platform is opened, so a native
+ * Linux launch never maps the Qt-based PlayStation backend. Modules stay
+ * loaded for the lifetime of the process.
+ */
+class EmulatorRegistry {
+public:
+    static EmulatorRegistry& getInstance();
+
+    // Returns nullptr if the platform is unknown or its plugin cannot be loaded
+    EmulatorHandle create(const std::string& platform);
+
+    // True if the platform's games run inside the launching process rather
+    // than as a child process
+    bool runsInProcess(const std::string& platform) const;
+
+    // Directories searched for plugin modules, in order
+    std::vector<std::string> getSearchPaths() const;
+
+private:
+    EmulatorRegistry();
+    ~EmulatorRegistry() = default;
+
+    // Prevent copying
+    EmulatorRegistry(const EmulatorRegistry&) = delete;
+    EmulatorRegistry& operator=(const EmulatorRegistry&) = delete;
+
+    const XEmuRunEmulatorPlugin* loadPlugin(const std::string& module);
+
+    std::mutex m_mutex;
+    std::map<std::string, std::string> m_platformModules;
+    std::set<std::string> m_inProcessModules;
+    std::map<std::string, const XEmuRunEmulatorPlugin*> m_plugins;
+};
+
+} // namespace XEmuRun
@@ -1,9 +1,6 @@
 #include "launcher.h"
-#include "../emulators/windows_emulator.h"
-#include "../emulators/linux_emulator.h"
-#include "../emulators/playstation_emulator.h"
-#include "../emulators/xbox_emulator.h"
 #include "../config/config_manager.h"
+#include "../utils/trace.h"
 #include <iostream>
 
 namespace XEmuRun {
@@ -11,7 +8,30 @@ namespace XEmuRun {
 Launcher::Launcher() = default;
 Launcher::~Launcher() = default;
 
+void Launcher::prewarm(const std::string& platform) {
+    XEMURUN_TRACE_SCOPE("launcher", "Launcher::prewarm", platform.c_str());
+    
+    ConfigManager& configManager = ConfigManager::getInstance();
+    if (!configManager.initialize()) {
+        return;
+    }
+    
+    bool reuse = m_emulator && m_emulatorPlatform == platform;
+    if (!reuse && !createEmulator(platform)) {
+        return;
+    }
+    
+    // No game layer yet; loadPackage() only reuses this for games that
+    // carry no configuration of their own
+    if (!reuse || m_hasGameConfig) {
+        applyConfig(nullptr);
+    }
+    m_emulator->prepare();
+}
+
 bool Launcher::loadPackage(const std::string& packagePath) {
+    XEMURUN_TRACE_SCOPE("launcher", "Launcher::loadPackage", packagePath.c_str());
+    
     // Initialize configuration system
     ConfigManager& configManager = ConfigManager::getInstance();
     if (!configManager.initialize()) {
@@ -19,8 +39,9 @@ bool Launcher::loadPackage(const std::string& packagePath) {
         return false;
     }
     
+    // Only the manifest is read until the emulator says it needs the files
     m_currentPackage = std::make_unique<Package>();
-    if (!m_currentPackage->load(packagePath)) {
+    if (!m_currentPackage->open(packagePath)) {
         std::cerr << "Failed to load package: " << packagePath << std::endl;
         return false;
     }
@@ -28,22 +49,67 @@ bool Launcher::loadPackage(const std::string& packagePath) {
     std::cout << "Successfully loaded package: " << m_currentPackage->getName() << std::endl;
     std::cout << "Platform: " << m_currentPackage->getPlatform() << std::endl;
     
+    if (!m_allowInProcess && EmulatorRegistry::getInstance().runsInProcess(m_currentPackage->getPlatform())) {
+        std::cerr << "Platform " << m_currentPackage->getPlatform() << " cannot run here" << std::endl;
+        return false;
+    }
+    
+    // A prewarmed emulator was set up without a game layer
+    ConfigSnapshot gameConfig = m_currentPackage->getConfig();
+    bool reuse = m_emulator && m_emulatorPlatform == m_currentPackage->getPlatform() &&
+                 !m_hasGameConfig && (!gameConfig || gameConfig->empty());
+    
     // Create appropriate emulator for the package
-    m_emulator.reset(createEmulatorForPlatform(m_currentPackage->getPlatform()));
+    if (!reuse) {
+        if (!createEmulator(m_currentPackage->getPlatform())) {
+            return false;
+        }
+        applyConfig(gameConfig);
+    }
+    
+    // Setup overlaps with extraction and with whatever the caller does
+    // before runGame()
+    m_emulator->prepare();
+    
+    if (m_emulator->requiresExtraction(*m_currentPackage) && !m_currentPackage->extract()) {
+        std::cerr << "Failed to load package: " << packagePath << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool Launcher::createEmulator(const std::string& platform) {
+    // Any emulator for another game is cancelled and released first
+    m_emulator.reset();
+    m_emulatorPlatform.clear();
     
+    m_emulator = EmulatorRegistry::getInstance().create(platform);
     if (!m_emulator) {
-        std::cerr << "Unsupported platform: " << m_currentPackage->getPlatform() << std::endl;
+        std::cerr << "Unsupported platform: " << platform << std::endl;
         return false;
     }
     
-    // Merge system, emulator, and game configurations
-    Config gameConfig = m_currentPackage->getConfig();
-    Config mergedConfig = configManager.mergeWithGameConfig(gameConfig, m_currentPackage->getPlatform());
+    m_emulatorPlatform = platform;
+    return true;
+}
+
+void Launcher::applyConfig(ConfigSnapshot gameConfig) {
+    ConfigManager& configManager = ConfigManager::getInstance();
+    m_configGeneration = configManager.getGeneration();
+    m_hasGameConfig = gameConfig && !gameConfig->empty();
     
-    // Apply the merged configuration
-    m_emulator->applyConfig(mergedConfig);
+    // Layer game, emulator, system and default configurations
+    ConfigView mergedConfig;
+    {
+        XEMURUN_TRACE_SCOPE("config", "ConfigManager::mergeWithGameConfig");
+        mergedConfig = configManager.mergeWithGameConfig(std::move(gameConfig), m_emulatorPlatform);
+    }
     
-    return true;
+    // Apply the merged configuration
+    {
+        XEMURUN_TRACE_SCOPE("emulator", "EmulatorInterface::applyConfig");
+        m_emulator->applyConfig(mergedConfig);
+    }
 }
 
 int Launcher::runGame() {
@@ -52,22 +118,54 @@ int Launcher::runGame() {
         return 1;
     }
     
+    XEMURUN_TRACE_SCOPE("launcher", "Launcher::runGame");
+    
+    // A prepared package may be launched long after it was loaded
+    ConfigManager& configManager = ConfigManager::getInstance();
+    if (configManager.getGeneration() != m_configGeneration) {
+        applyConfig(m_currentPackage->getConfig());
+    }
+    
+    // Forward edits to the configuration files while the game runs
+    const std::string platform = m_currentPackage->getPlatform();
+    configManager.startWatching();
+    int listener = configManager.addChangeListener(
+        [this, &configManager, &platform](const std::string& changedPlatform, const std::vector<std::string>& changedKeys) {
+            if (!changedPlatform.empty() && changedPlatform != platform) {
+                return;
+            }
+            m_emulator->onConfigChanged(
+                configManager.mergeWithGameConfig(m_currentPackage->getConfig(), platform), changedKeys);
+        });
+    
     std::cout << "Starting emulation..." << std::endl;
-    return m_emulator->launch(*m_currentPackage);
+    int result = 1;
+    if (m_emulator->launch(*m_currentPackage)) {
+        result = m_emulator->waitFor();
+    }
+    
+    configManager.removeChangeListener(listener);
+    return result;
+}
+
+void Launcher::setLaunchEnvironment(const std::vector<std::string>& environment, const std::string& workingDirectory) {
+    if (m_emulator) {
+        m_emulator->setLaunchEnvironment(environment, workingDirectory);
+    }
+}
+
+std::string Launcher::getPlatform() const {
+    return m_currentPackage ? m_currentPackage->getPlatform() : "";
+}
+
+void Launcher::terminate() {
+    if (m_emulator) {
+        m_emulator->terminate();
+    }
 }
 
-EmulatorInterface* Launcher::createEmulatorForPlatform(const std::string& platform) {
-    if (platform == "windows") {
-        return new WindowsEmulator();
-    } else if (platform == "linux") {
-        return new LinuxEmulator();
-    } else if (platform == "playstation4" || platform == "playstation5") {
-        return new PlayStationEmulator(platform);
-    } else if (platform == "xbox" || platform == "xbox_series") {
-        return new XboxEmulator(platform);
-    }
-    
-    return nullptr;
+EmulatorState Launcher::getState() const {
+    return m_emulator ? m_emulator->getState() : EmulatorState::Idle;
 }
 
 } // namespace XEmuRun
@@ -2,8 +2,10 @@
 
 #include <string>
 #include <memory>
+#include <cstdint>
+#include <vector>
 #include "../package/package.h"
-#include "../emulators/emulator_interface.h"
+#include "emulator_registry.h"
 
 namespace XEmuRun {
 
@@ -12,14 +14,41 @@ public:
     Launcher();
     ~Launcher();
     
+    // Starts setting up the emulator for a platform in the background, e.g.
+    // while the user is still choosing a game. A later loadPackage() for the
+    // same platform picks up the prepared emulator.
+    void prewarm(const std::string& platform);
+    
     bool loadPackage(const std::string& packagePath);
     int runGame();
     
+    // Starts the game with this environment ("NAME=value" strings) and
+    // working directory instead of the launcher's own
+    void setLaunchEnvironment(const std::vector<std::string>& environment, const std::string& workingDirectory);
+    
+    // With false, loadPackage() fails right after reading the manifest if
+    // the platform's games would run inside this process
+    void setAllowInProcess(bool allow) { m_allowInProcess = allow; }
+    // Platform of the last package loaded, empty if none was opened
+    std::string getPlatform() const;
+    
+    // Asks the game to quit; callable from another thread while runGame()
+    // is blocked
+    void terminate();
+    EmulatorState getState() const;
+    
 private:
-    std::unique_ptr<Package> m_currentPackage;
-    std::unique_ptr<EmulatorInterface> m_emulator;
+    bool createEmulator(const std::string& platform);
+    
+    // Re-layers the current configuration and applies it to the emulator
+    void applyConfig(ConfigSnapshot gameConfig);
     
-    EmulatorInterface* createEmulatorForPlatform(const std::string& platform);
+    std::unique_ptr<Package> m_currentPackage;
+    EmulatorHandle m_emulator;
+    std::string m_emulatorPlatform;
+    bool m_hasGameConfig = false; // applied configuration includes a game layer
+    std::uint64_t m_configGeneration = 0;
+    bool m_allowInProcess = true;
 };
 
 } // namespace XEmuRun
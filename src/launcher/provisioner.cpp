@@ -0,0 +1,200 @@
+#include "provisioner.h"
+#include "emulator_registry.h"
+#include "../config/config_manager.h"
+#include "../package/package.h"
+#include "../utils/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <set>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double elapsedMs(Clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+std::uint64_t directorySize(const std::string& path) {
+    std::uint64_t total = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec)) {
+            total += it->file_size(ec);
+        }
+    }
+    return total;
+}
+
+} // namespace
+
+std::vector<std::string> Provisioner::collectPackages(const std::vector<std::string>& paths) {
+    std::vector<std::string> candidates;
+    for (const std::string& path : paths) {
+        std::error_code ec;
+        if (!fs::is_directory(path, ec)) {
+            candidates.push_back(fs::absolute(path).string());
+            continue;
+        }
+
+        // Sorted so reports can be compared between runs
+        std::vector<std::string> found;
+        for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+            if (it->is_regular_file(ec) && it->path().extension() == ".XEmupkg") {
+                found.push_back(fs::absolute(it->path()).string());
+            }
+        }
+        std::sort(found.begin(), found.end());
+        candidates.insert(candidates.end(), found.begin(), found.end());
+    }
+
+    // Packages with the same name share an extraction directory and must
+    // not be extracted concurrently; only the first is prepared
+    std::vector<std::string> packages;
+    std::set<std::string> names;
+    for (std::string& package : candidates) {
+        if (names.insert(fs::path(package).stem().string()).second) {
+            packages.push_back(std::move(package));
+        } else {
+            std::cerr << "Skipping " << package << ": another package with this name is already listed" << std::endl;
+        }
+    }
+
+    return packages;
+}
+
+std::vector<Provisioner::Result> Provisioner::run(const std::vector<std::string>& packagePaths, unsigned maxJobs) {
+    std::vector<Result> results(packagePaths.size());
+    std::atomic<size_t> next{0};
+
+    auto worker = [&] {
+        for (size_t i = next++; i < packagePaths.size(); i = next++) {
+            results[i] = prepare(packagePaths[i]);
+        }
+    };
+
+    unsigned jobs = std::max(1u, std::min<unsigned>(maxJobs, packagePaths.size()));
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < jobs; ++i) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : workers) {
+        thread.join();
+    }
+
+    return results;
+}
+
+Provisioner::Result Provisioner::prepare(const std::string& packagePath) {
+    XEMURUN_TRACE_SCOPE("launcher", "Provisioner::prepare", packagePath.c_str());
+
+    Result result;
+    result.packagePath = packagePath;
+    Clock::time_point start = Clock::now();
+
+    Clock::time_point phase = Clock::now();
+    bool valid = Package::isValidPackage(packagePath);
+    result.validateMs = elapsedMs(phase);
+    if (!valid) {
+        result.error = "Package validation failed";
+        result.totalMs = elapsedMs(start);
+        return result;
+    }
+
+    std::error_code ec;
+    result.packageBytes = fs::file_size(packagePath, ec);
+
+    phase = Clock::now();
+    result.alreadyExtracted = Package::isExtracted(packagePath);
+    // On disk: the machine is prepared for later, and RAM does not
+    // survive a reboot or the next title's eviction
+    bool extracted = Package::preExtract(packagePath, Package::ExtractionTier::Disk);
+    result.extractMs = elapsedMs(phase);
+    if (!extracted) {
+        result.error = "Package extraction failed";
+        result.totalMs = elapsedMs(start);
+        return result;
+    }
+    result.extractedBytes = directorySize(Package::getExtractionDirectory(packagePath));
+
+    // Finds the extraction in place, so this is validation plus the manifest
+    // parse, which also writes the manifest snapshot
+    phase = Clock::now();
+    Package package;
+    bool loaded = package.load(packagePath);
+    result.manifestMs = elapsedMs(phase);
+    if (!loaded) {
+        result.error = "Failed to load package manifest";
+        result.totalMs = elapsedMs(start);
+        return result;
+    }
+    result.platform = package.getPlatform();
+
+    phase = Clock::now();
+    ConfigView config = ConfigManager::getInstance().mergeWithGameConfig(package.getConfig(), result.platform);
+    result.configMs = elapsedMs(phase);
+
+    // Loads the platform's plugin and runs its setup, the work prepare()
+    // does in the background before a launch
+    phase = Clock::now();
+    EmulatorHandle emulator = EmulatorRegistry::getInstance().create(result.platform);
+    if (!emulator) {
+        result.error = "Unsupported platform: " + result.platform;
+    } else {
+        emulator->applyConfig(config);
+        if (!emulator->initialize()) {
+            result.error = "Failed to initialize " + emulator->getName() + " emulator";
+        }
+    }
+    result.emulatorMs = elapsedMs(phase);
+
+    result.totalMs = elapsedMs(start);
+    return result;
+}
+
+Json::Value Provisioner::toJson(const std::vector<Result>& results) {
+    Json::Value root;
+    Json::Value packages(Json::arrayValue);
+    int failed = 0;
+
+    for (const Result& result : results) {
+        Json::Value package;
+        package["path"] = result.packagePath;
+        package["ok"] = result.error.empty();
+        if (!result.error.empty()) {
+            package["error"] = result.error;
+            failed++;
+        }
+        package["platform"] = result.platform;
+        package["alreadyExtracted"] = result.alreadyExtracted;
+        package["packageBytes"] = static_cast<Json::UInt64>(result.packageBytes);
+        package["extractedBytes"] = static_cast<Json::UInt64>(result.extractedBytes);
+
+        Json::Value timings;
+        timings["validate"] = result.validateMs;
+        timings["extract"] = result.extractMs;
+        timings["manifest"] = result.manifestMs;
+        timings["config"] = result.configMs;
+        timings["emulator"] = result.emulatorMs;
+        timings["total"] = result.totalMs;
+        package["timingsMs"] = timings;
+
+        packages.append(package);
+    }
+
+    root["packages"] = packages;
+    root["prepared"] = static_cast<int>(results.size()) - failed;
+    root["failed"] = failed;
+    return root;
+}
+
+} // namespace XEmuRun
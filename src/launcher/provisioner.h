@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <json/json.h>
+
+namespace XEmuRun {
+
+/**
+ * @class Provisioner
+ * @brief Does everything a launch would do except start the game.
+ *
+ * Meant for imaging machines ahead of time. For each package it validates,
+ * extracts, parses the manifest, merges the configuration and sets up the
+ * emulator. What later launches reuse stays on disk: the extracted files,
+ * the manifest and configuration snapshots, and the emulator's own setup.
+ */
+class Provisioner {
+public:
+    struct Result {
+        std::string packagePath;
+        std::string platform;
+        std::string error; // empty on success
+        bool alreadyExtracted = false;
+        std::uint64_t packageBytes = 0;
+        std::uint64_t extractedBytes = 0;
+
+        // Milliseconds spent in each phase
+        double validateMs = 0;
+        double extractMs = 0;
+        double manifestMs = 0;
+        double configMs = 0;
+        double emulatorMs = 0;
+        double totalMs = 0;
+    };
+
+    // Expands directories to the packages below them
+    static std::vector<std::string> collectPackages(const std::vector<std::string>& paths);
+
+    // Prepares the packages with at most maxJobs running at once. Results
+    // are in the order of packagePaths.
+    std::vector<Result> run(const std::vector<std::string>& packagePaths, unsigned maxJobs);
+
+    static Json::Value toJson(const std::vector<Result>& results);
+
+private:
+    Result prepare(const std::string& packagePath);
+};
+
+} // namespace XEmuRun
@@ -1,30 +1,135 @@
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
+#include <json/json.h>
+#include <QApplication>
 #include "launcher/launcher.h"
+#include "launcher/emulator_registry.h"
+#include "launcher/provisioner.h"
 #include "config/config_manager.h"
+#include "utils/trace.h"
+#include "daemon/daemon_client.h"
+
+// xemurun prepare: everything a launch does except starting the game, for
+// warming up machines before anyone plays on them
+static int runPrepare(int argc, char* argv[]) {
+    std::vector<std::string> paths;
+    std::string reportPath = "prepare-report.json";
+    unsigned jobs = std::max(1u, std::thread::hardware_concurrency());
+
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--jobs" && i + 1 < argc) {
+            jobs = static_cast<unsigned>(std::max(1, std::atoi(argv[++i])));
+        } else if (arg == "--report" && i + 1 < argc) {
+            reportPath = argv[++i];
+        } else {
+            paths.push_back(arg);
+        }
+    }
+
+    if (paths.empty()) {
+        std::cout << "Usage: xemurun prepare [--jobs N] [--report file] <package_or_directory>..." << std::endl;
+        return 1;
+    }
+
+    XEmuRun::ConfigManager& configManager = XEmuRun::ConfigManager::getInstance();
+    if (!configManager.initialize()) {
+        std::cerr << "Failed to initialize configuration system" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> packages = XEmuRun::Provisioner::collectPackages(paths);
+    XEmuRun::Provisioner provisioner;
+    Json::Value report = XEmuRun::Provisioner::toJson(provisioner.run(packages, jobs));
+
+    // A file rather than stdout, which carries the per-package log
+    Json::StreamWriterBuilder writer;
+    writer["indentation"] = "  ";
+    std::ofstream file(reportPath);
+    file << Json::writeString(writer, report) << std::endl;
+    if (!file) {
+        std::cerr << "Failed to write report: " << reportPath << std::endl;
+        return 1;
+    }
+
+    std::cout << "Prepared " << report["prepared"].asInt() << " of " << packages.size() << " packages" << std::endl;
+    return report["failed"].asInt() == 0 ? 0 : 1;
+}
 
 int main(int argc, char* argv[]) {
     std::cout << "XEmuRun - Universal Game Emulation Platform" << std::endl;
-    
+
+    if (argc > 1 && std::string(argv[1]) == "prepare") {
+        return runPrepare(argc, argv);
+    }
+
+    std::string packagePath;
+    bool trace = false;
+    bool useDaemon = true;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--trace") {
+            trace = true;
+        } else if (arg == "--no-daemon") {
+            useDaemon = false;
+        } else if (packagePath.empty()) {
+            packagePath = arg;
+        }
+    }
+
+    if (trace) {
+        XEmuRun::Tracer::getInstance().enable();
+    }
+
+    // Hand the launch to a resident xemurund when one is running; it already
+    // holds configuration and prepared packages in memory. Tracing stays
+    // in-process so the spans cover this launch.
+    if (useDaemon && !trace && !packagePath.empty()) {
+        XEmuRun::DaemonClient client;
+        int exitCode = 1;
+        if (client.connect() && client.launch(packagePath, exitCode)) {
+            return exitCode;
+        }
+    }
+
     // Initialize configuration system
     XEmuRun::ConfigManager& configManager = XEmuRun::ConfigManager::getInstance();
     if (!configManager.initialize()) {
         std::cerr << "Failed to initialize configuration system" << std::endl;
         return 1;
     }
-    
-    if (argc < 2) {
-        std::cout << "Usage: xemurun [path_to_xemupkg]" << std::endl;
+
+    if (packagePath.empty()) {
+        std::cout << "Usage: xemurun [--trace] [--no-daemon] [path_to_xemupkg]" << std::endl;
+        std::cout << "       xemurun prepare [--jobs N] [--report file] <package_or_directory>..." << std::endl;
         return 1;
     }
 
-    std::string packagePath = argv[1];
     XEmuRun::Launcher launcher;
-    
+    int result = 1;
+
     if (launcher.loadPackage(packagePath)) {
-        return launcher.runGame();
+        // In-process backends show their window through the QApplication,
+        // which must live on this thread while the game runs on another
+        std::unique_ptr<QApplication> app;
+        if (XEmuRun::EmulatorRegistry::getInstance().runsInProcess(launcher.getPlatform())) {
+            app = std::make_unique<QApplication>(argc, argv);
+        }
+        result = launcher.runGame();
     } else {
         std::cerr << "Failed to load package: " << packagePath << std::endl;
-        return 1;
     }
+
+    if (trace) {
+        XEmuRun::Tracer::getInstance().writeToFile("trace.json");
+    }
+
+    return result;
 }
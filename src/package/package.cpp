@@ -1,18 +1,33 @@
 #include "package.h"
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <json/json.h>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <linux/fs.h>
+#include <sys/file.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "../utils/archive.h"
+#include "../utils/trace.h"
+#include "../utils/snapshot.h"
+#include "../config/config_manager.h"
 
 namespace fs = std::filesystem;
 
 namespace XEmuRun {
 
-Package::Package() = default;
+Package::Package() : m_config(std::make_shared<const Config>()) {
+}
 Package::~Package() = default;
 
 bool Package::load(const std::string& packagePath) {
+    XEMURUN_TRACE_SCOPE("package", "Package::load", packagePath.c_str());
     m_packagePath = packagePath;
     
     if (!validatePackage()) {
@@ -20,8 +35,7 @@ bool Package::load(const std::string& packagePath) {
         return false;
     }
     
-    if (!extractPackage()) {
-        std::cerr << "Package extraction failed" << std::endl;
+    if (!extract()) {
         return false;
     }
     
@@ -33,8 +47,46 @@ bool Package::load(const std::string& packagePath) {
     return true;
 }
 
+bool Package::open(const std::string& packagePath) {
+    XEMURUN_TRACE_SCOPE("package", "Package::open", packagePath.c_str());
+    
+    m_packagePath = packagePath;
+    
+    if (!validatePackage()) {
+        std::cerr << "Package validation failed" << std::endl;
+        return false;
+    }
+    
+    // An existing extraction has the manifest snapshot; use it as load() does
+    if (isExtracted(packagePath)) {
+        return extract() && loadManifest();
+    }
+    
+    if (!loadManifestFromArchive()) {
+        std::cerr << "Failed to load package manifest" << std::endl;
+        return false;
+    }
+    
+    return true;
+}
+
 bool Package::extract() {
-    return true; // Already extracted during load
+    if (!m_extractedPath.empty()) {
+        return true; // Already extracted during load
+    }
+    
+    if (!extractPackage()) {
+        std::cerr << "Package extraction failed" << std::endl;
+        m_extractedPath.clear();
+        return false;
+    }
+    
+    return true;
+}
+
+bool Package::loadExtracted(const std::string& extractedPath) {
+    m_extractedPath = extractedPath;
+    return loadManifest();
 }
 
 std::string Package::getName() const {
@@ -49,49 +101,477 @@ std::string Package::getMainExecutable() const {
     return m_mainExecutable;
 }
 
+std::string Package::getPackagePath() const {
+    return m_packagePath;
+}
+
 std::string Package::getExtractedPath() const {
     return m_extractedPath;
 }
 
-const Config& Package::getConfig() const {
+ConfigSnapshot Package::getConfig() const {
     return m_config;
 }
 
 bool Package::validatePackage() {
-    if (!fs::exists(m_packagePath)) {
-        std::cerr << "Package file does not exist: " << m_packagePath << std::endl;
+    XEMURUN_TRACE_SCOPE("package", "Package::validatePackage");
+    return isValidPackage(m_packagePath);
+}
+
+bool Package::isValidPackage(const std::string& packagePath) {
+    if (!fs::exists(packagePath)) {
+        std::cerr << "Package file does not exist: " << packagePath << std::endl;
         return false;
     }
     
-    if (fs::path(m_packagePath).extension() != ".XEmupkg") {
-        std::cerr << "File is not an XEmupkg: " << m_packagePath << std::endl;
+    if (fs::path(packagePath).extension() != ".XEmupkg") {
+        std::cerr << "File is not an XEmupkg: " << packagePath << std::endl;
         return false;
     }
     
     return true;
 }
 
+namespace {
+
+// Written after a successful extraction and holding the identity of the
+// package file, so an interrupted extraction or a replaced package is
+// never mistaken for a complete one
+constexpr const char* kExtractionMarker = ".xemurun-extracted";
+
+// Next to the marker, for Windows titles extracted where case cannot be
+// folded
+constexpr const char* kCasefoldIndexName = ".xemurun-casefold";
+
+// Share of the last ten seconds in which tasks stalled waiting for memory,
+// in percent, above which RAM extractions are given up
+constexpr double kMemoryPressureLimit = 10.0;
+
+// flock() on a file next to an extraction directory: "<dir>.lock" is held
+// exclusively while extracting, "<dir>.use" shared while a package is
+// loaded. The kernel drops a lock when its holder exits, however it exits,
+// so a crash never leaves a stale lock behind. Lock files are never
+// deleted: unlinking one while another process waits on it would let a
+// third process lock a new file of the same name.
+class FileLock {
+public:
+    explicit FileLock(const std::string& path) {
+        m_fd = open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (m_fd < 0) {
+            std::cerr << "Failed to open lock file " << path << ": " << std::strerror(errno) << std::endl;
+        }
+    }
+    
+    ~FileLock() {
+        if (m_fd >= 0) {
+            close(m_fd); // releases the lock
+        }
+    }
+    
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+    
+    // LOCK_EX or LOCK_SH, with LOCK_NB to fail instead of waiting
+    bool lock(int operation) {
+        int result = -1;
+        while (m_fd >= 0 && (result = flock(m_fd, operation)) != 0 && errno == EINTR) {
+        }
+        return result == 0;
+    }
+    
+private:
+    int m_fd = -1;
+};
+
+// "some avg10" from the kernel's pressure stall information; 0 on kernels
+// without PSI
+double memoryPressure() {
+    std::ifstream pressure("/proc/pressure/memory");
+    std::string line;
+    while (std::getline(pressure, line)) {
+        if (line.rfind("some ", 0) == 0) {
+            size_t avg10 = line.find("avg10=");
+            return avg10 == std::string::npos ? 0.0 : std::atof(line.c_str() + avg10 + 6);
+        }
+    }
+    return 0.0;
+}
+
+uint64_t directorySize(const fs::path& path) {
+    uint64_t total = 0;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(path, ec), end; !ec && it != end; it.increment(ec)) {
+        if (it->is_regular_file(ec)) {
+            total += it->file_size(ec);
+        }
+    }
+    return total;
+}
+
+bool hasMarkerFor(const fs::path& extractedPath, const SnapshotSource& source) {
+    std::ifstream marker(extractedPath / kExtractionMarker);
+    int64_t mtimeNs = 0;
+    uint64_t size = 0;
+    return marker >> mtimeNs >> size && mtimeNs == source.mtimeNs && size == source.size;
+}
+
+// Removes an extraction unless a loaded package is using it
+bool removeIfIdle(const fs::path& extractedPath) {
+    FileLock useLock(extractedPath.string() + ".use");
+    if (!useLock.lock(LOCK_EX | LOCK_NB)) {
+        return false;
+    }
+    
+    // Marker first, so an interrupted removal is never taken for complete
+    std::error_code ec;
+    fs::remove(extractedPath / kExtractionMarker, ec);
+    fs::remove_all(extractedPath, ec);
+    return !ec;
+}
+
+// Windows titles are written for a case-insensitive filesystem, and Wine
+// answers each lookup whose case does not match by scanning the directory.
+// An empty platform is read from the package; a loaded package passes its
+// own, so the manifest is not read again.
+bool wantsCasefold(const std::string& packagePath, const std::string& platform) {
+    ConfigSnapshot systemConfig = ConfigManager::getInstance().getSystemConfig();
+    if (!(systemConfig ? systemConfig->get(Keys::CasefoldExtraction) : Keys::CasefoldExtraction.defaultValue)) {
+        return false;
+    }
+    if (!platform.empty()) {
+        return platform == "windows";
+    }
+    
+    std::string manifest;
+    Json::Value root;
+    Json::Reader reader;
+    return readArchiveEntry(packagePath, "manifest.json", manifest) && reader.parse(manifest, root) &&
+           root["platform"].asString() == "windows";
+}
+
+// Where directories cannot fold case, every path below game/ is listed
+// under its case-folded form instead: one "folded<TAB>as extracted" line
+// per file and directory, sorted, for a preload shim in Wine's processes
+// to turn a mismatched lookup into an exact one. Folding is ASCII only;
+// of paths that fold alike, the first in byte order is kept.
+bool writeCasefoldIndex(const fs::path& extractionDirectory) {
+    fs::path gameDirectory = extractionDirectory / "game";
+    std::vector<std::string> relativePaths;
+    std::error_code ec;
+    for (fs::recursive_directory_iterator it(gameDirectory, ec), end; !ec && it != end; it.increment(ec)) {
+        std::string relative = it->path().lexically_relative(gameDirectory).string();
+        if (relative.find_first_of("\t\n") == std::string::npos) {
+            relativePaths.push_back(std::move(relative));
+        }
+    }
+    if (ec) {
+        return false;
+    }
+    std::sort(relativePaths.begin(), relativePaths.end());
+    
+    std::map<std::string, std::string> index;
+    size_t collisions = 0;
+    for (const std::string& relative : relativePaths) {
+        std::string folded = relative;
+        std::transform(folded.begin(), folded.end(), folded.begin(),
+                       [](char c) { return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c; });
+        if (!index.emplace(std::move(folded), relative).second) {
+            ++collisions;
+        }
+    }
+    if (collisions > 0) {
+        std::cerr << collisions << " paths differ from others only in case; the case-insensitive index keeps one"
+                  << std::endl;
+    }
+    
+    std::ofstream file(extractionDirectory / kCasefoldIndexName, std::ios::trunc);
+    for (const auto& [folded, relative] : index) {
+        file << folded << '\t' << relative << '\n';
+    }
+    return static_cast<bool>(file);
+}
+
+// Makes a still empty directory case-insensitive, as `chattr +F` does;
+// directories created inside inherit it. Needs a filesystem with casefold
+// support, e.g. ext4 or f2fs made with it, or tmpfs mounted with it.
+bool enableCasefold(const fs::path& directory) {
+    int fd = open(directory.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    
+    int flags = 0;
+    bool enabled = ioctl(fd, FS_IOC_GETFLAGS, &flags) == 0 &&
+                   ((flags & FS_CASEFOLD_FL) || (flags |= FS_CASEFOLD_FL, ioctl(fd, FS_IOC_SETFLAGS, &flags) == 0));
+    close(fd);
+    return enabled;
+}
+
+uint64_t ramBudgetBytes() {
+    ConfigSnapshot systemConfig = ConfigManager::getInstance().getSystemConfig();
+    int budgetMb = systemConfig ? systemConfig->get(Keys::RamExtractionBudgetMb)
+                                : Keys::RamExtractionBudgetMb.defaultValue;
+    return static_cast<uint64_t>(std::max(0, budgetMb)) << 20;
+}
+
+// Evicts idle RAM extractions, least recently used first, until `needed`
+// more bytes fit the budget; under memory pressure, all of them. Returns
+// the bytes still in use.
+uint64_t evictRamExtractions(const fs::path& root, uint64_t budget, uint64_t needed, bool underPressure) {
+    struct Extraction {
+        fs::path path;
+        fs::file_time_type lastUsed;
+        uint64_t size;
+    };
+    
+    std::vector<Extraction> extractions;
+    uint64_t used = 0;
+    std::error_code ec;
+    for (const fs::directory_entry& entry : fs::directory_iterator(root, ec)) {
+        std::error_code entryError;
+        if (!entry.is_directory(entryError)) {
+            continue;
+        }
+    
+        // Incomplete extractions have no marker and go first
+        fs::file_time_type lastUsed = fs::last_write_time(entry.path() / kExtractionMarker, entryError);
+        if (entryError) {
+            lastUsed = fs::file_time_type::min();
+        }
+        extractions.push_back({entry.path(), lastUsed, directorySize(entry.path())});
+        used += extractions.back().size;
+    }
+    
+    std::sort(extractions.begin(), extractions.end(),
+              [](const Extraction& a, const Extraction& b) { return a.lastUsed < b.lastUsed; });
+    
+    for (const Extraction& extraction : extractions) {
+        if (!underPressure && used + needed <= budget) {
+            break;
+        }
+    
+        // Skipped while another process is extracting into it
+        FileLock extractionLock((fs::path(Package::getExtractionRoot()) / extraction.path.filename()).string() + ".lock");
+        if (extractionLock.lock(LOCK_EX | LOCK_NB) && removeIfIdle(extraction.path)) {
+            std::cout << "Evicted RAM extraction " << extraction.path.string() << std::endl;
+            used -= extraction.size;
+        }
+    }
+    
+    return used;
+}
+
+} // namespace
+
+struct Package::UseLock : FileLock {
+    using FileLock::FileLock;
+};
+
 bool Package::extractPackage() {
-    // Create a temporary directory for extraction
-    m_extractedPath = fs::temp_directory_path() / "XEmuRun" / fs::path(m_packagePath).stem().string();
+    XEMURUN_TRACE_SCOPE("package", "Package::extractPackage");
     
+    // An eviction can remove a RAM extraction between finding it and
+    // locking it; the second round extracts again
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        m_extractedPath = findExtraction(m_packagePath);
+        if (!m_extractedPath.empty()) {
+            std::cout << "Using pre-extracted files in " << m_extractedPath << std::endl;
+        } else if (!extractTo(m_packagePath, m_platform, ExtractionTier::Any, m_extractedPath)) {
+            return false;
+        }
+    
+        // Held while this package is loaded, so the files are not evicted
+        // from under a running game
+        auto useLock = std::make_shared<UseLock>(m_extractedPath + ".use");
+        if (useLock->lock(LOCK_SH) && findExtraction(m_packagePath) == m_extractedPath) {
+            m_useLock = std::move(useLock);
+    
+            // Recently used extractions are evicted last
+            utimensat(AT_FDCWD, (fs::path(m_extractedPath) / kExtractionMarker).c_str(), nullptr, 0);
+            return true;
+        }
+    }
+    
+    std::cerr << "Extraction was removed while loading: " << m_packagePath << std::endl;
+    return false;
+}
+
+std::string Package::getExtractionRoot() {
+    return (fs::temp_directory_path() / "XEmuRun").string();
+}
+
+std::string Package::getRamExtractionRoot() {
+    ConfigSnapshot systemConfig = ConfigManager::getInstance().getSystemConfig();
+    return std::string(systemConfig ? systemConfig->get(Keys::RamExtractionPath)
+                                    : Keys::RamExtractionPath.defaultValue);
+}
+
+std::string Package::getExtractionDirectory(const std::string& packagePath) {
+    std::string existing = findExtraction(packagePath);
+    if (!existing.empty()) {
+        return existing;
+    }
+    return (fs::path(getExtractionRoot()) / fs::path(packagePath).stem()).string();
+}
+
+std::string Package::findExtraction(const std::string& packagePath) {
+    SnapshotSource source;
+    if (!statSnapshotSource(packagePath, source)) {
+        return "";
+    }
+    
+    fs::path stem = fs::path(packagePath).stem();
+    for (const std::string& root : {getRamExtractionRoot(), getExtractionRoot()}) {
+        if (!root.empty() && hasMarkerFor(fs::path(root) / stem, source)) {
+            return (fs::path(root) / stem).string();
+        }
+    }
+    return "";
+}
+
+bool Package::isExtracted(const std::string& packagePath) {
+    return !findExtraction(packagePath).empty();
+}
+
+bool Package::preExtract(const std::string& packagePath, ExtractionTier tier) {
+    if (isExtracted(packagePath)) {
+        return true;
+    }
+    std::string extractedPath;
+    return extractTo(packagePath, "", tier, extractedPath);
+}
+
+void Package::trimRamExtractions() {
+    std::string ramRoot = getRamExtractionRoot();
+    if (!ramRoot.empty()) {
+        evictRamExtractions(ramRoot, ramBudgetBytes(), 0, memoryPressure() > kMemoryPressureLimit);
+    }
+}
+
+bool Package::extractTo(const std::string& packagePath, const std::string& platform, ExtractionTier tier,
+                        std::string& extractedPath) {
+    SnapshotSource source;
+    if (!statSnapshotSource(packagePath, source)) {
+        std::cerr << "Package file does not exist: " << packagePath << std::endl;
+        return false;
+    }
+    
+    fs::path stem = fs::path(packagePath).stem();
+    fs::path diskPath = fs::path(getExtractionRoot()) / stem;
     try {
-        fs::create_directories(m_extractedPath);
+        fs::create_directories(getExtractionRoot());
     } catch (const fs::filesystem_error& e) {
         std::cerr << "Failed to create extraction directory: " << e.what() << std::endl;
         return false;
     }
     
-    // Extract the package
-    if (!extractArchive(m_packagePath, m_extractedPath)) {
-        std::cerr << "Failed to extract package" << std::endl;
-        return false;
+    // One process extracts, whichever tier it picks; the others wait here
+    // and then find the marker
+    FileLock lock(diskPath.string() + ".lock");
+    if (!lock.lock(LOCK_EX | LOCK_NB)) {
+        std::cout << "Waiting for another process to finish extracting " << packagePath << std::endl;
+        if (!lock.lock(LOCK_EX)) {
+            return false;
+        }
+    }
+    extractedPath = findExtraction(packagePath);
+    if (!extractedPath.empty()) {
+        return true;
     }
     
-    return true;
+    // Titles that fit the memory budget go to RAM unless memory is under
+    // pressure; everything else, and any failure there, goes to disk.
+    // Ahead-of-time extractions never evict anything to make room: a set of
+    // them would otherwise keep evicting each other.
+    std::vector<fs::path> candidates;
+    std::string ramRoot = getRamExtractionRoot();
+    uint64_t budget = ramBudgetBytes();
+    uint64_t size = 0;
+    if (tier != ExtractionTier::Disk && !ramRoot.empty() && budget > 0 &&
+        archiveUncompressedSize(packagePath, size)) {
+        std::error_code ec;
+        fs::create_directories(ramRoot, ec);
+    
+        bool underPressure = memoryPressure() > kMemoryPressureLimit;
+        uint64_t used = tier == ExtractionTier::Any ? evictRamExtractions(ramRoot, budget, size, underPressure)
+                                                    : directorySize(ramRoot);
+        fs::space_info space = fs::space(ramRoot, ec);
+        if (!ec && !underPressure && used + size <= budget && space.available > size) {
+            candidates.push_back(fs::path(ramRoot) / stem);
+        }
+    }
+    candidates.push_back(diskPath);
+    
+    bool casefold = wantsCasefold(packagePath, platform);
+    
+    for (const fs::path& candidate : candidates) {
+        // An older version of the package may still be running from here;
+        // as for eviction, its files are only replaced when nobody uses
+        // them. Held until the new tree is complete.
+        FileLock useLock(candidate.string() + ".use");
+        if (!useLock.lock(LOCK_EX | LOCK_NB)) {
+            std::cerr << "Not extracting to " << candidate.string() << ": an older version is still in use" << std::endl;
+            continue;
+        }
+    
+        // Whatever is there is from an interrupted extraction or an older
+        // version of the package
+        std::error_code ec;
+        fs::path markerPath = candidate / kExtractionMarker;
+        fs::remove(markerPath, ec);
+        fs::remove_all(candidate, ec);
+    
+        try {
+            fs::create_directories(candidate);
+        } catch (const fs::filesystem_error& e) {
+            std::cerr << "Failed to create extraction directory: " << e.what() << std::endl;
+            continue;
+        }
+    
+        // Before anything is written, so every directory inherits it
+        bool folded = casefold && enableCasefold(candidate);
+        
+        // Extract the package
+        if (!extractArchive(packagePath, candidate.string())) {
+            std::cerr << "Failed to extract package to " << candidate.string() << std::endl;
+            fs::remove_all(candidate, ec);
+            continue;
+        }
+    
+        if (casefold && !folded) {
+            std::cout << "No case-insensitive directories on " << candidate.parent_path().string()
+                      << "; writing a lookup index instead" << std::endl;
+            if (!writeCasefoldIndex(candidate)) {
+                std::cerr << "Failed to write the case-insensitive index for " << candidate.string() << std::endl;
+            }
+        }
+    
+        std::ofstream marker(markerPath, std::ios::trunc);
+        marker << source.mtimeNs << " " << source.size << std::endl;
+        if (!marker) {
+            // Still usable, it just gets extracted again next time
+            std::cerr << "Failed to write extraction marker: " << markerPath << std::endl;
+        }
+    
+        // An older version left in the other tier only takes up space
+        if (!ramRoot.empty()) {
+            fs::path other = candidate == diskPath ? fs::path(ramRoot) / stem : diskPath;
+            if (fs::exists(other, ec)) {
+                removeIfIdle(other);
+            }
+        }
+    
+        extractedPath = candidate.string();
+        return true;
+    }
+    
+    std::cerr << "Failed to extract package" << std::endl;
+    return false;
 }
 
 bool Package::loadManifest() {
+    XEMURUN_TRACE_SCOPE("package", "Package::loadManifest");
+    
     std::string manifestPath = (fs::path(m_extractedPath) / "manifest.json").string();
     
     if (!fs::exists(manifestPath)) {
@@ -99,6 +579,32 @@ bool Package::loadManifest() {
         return false;
     }
     
+    // The snapshot lives in the extraction directory: later launches that
+    // reuse the extraction skip the JSON parse, and a re-extraction,
+    // which starts from an empty directory, writes it anew
+    SnapshotSource source;
+    bool haveSource = statSnapshotSource(manifestPath, source);
+    
+    SnapshotReader snapshot;
+    if (haveSource && snapshot.open(manifestPath, SnapshotKind::Manifest, source)) {
+        SnapshotEntry entry;
+        while (snapshot.next(entry) && entry.type != SnapshotValueType::Record) {
+            if (entry.key == "name") {
+                m_name = entry.stringValue;
+            } else if (entry.key == "platform") {
+                m_platform = entry.stringValue;
+            } else if (entry.key == "main") {
+                m_mainExecutable = entry.stringValue;
+            }
+        }
+        
+        // The "config" record holds the rest
+        auto config = std::make_shared<Config>();
+        config->loadFromSnapshot(snapshot);
+        m_config = std::move(config);
+        return true;
+    }
+    
     std::ifstream file(manifestPath);
     Json::Value root;
     Json::Reader reader;
@@ -108,15 +614,62 @@ bool Package::loadManifest() {
         return false;
     }
     
+    if (!applyManifest(root)) {
+        return false;
+    }
+    
+    if (haveSource) {
+        SnapshotWriter writer(SnapshotKind::Manifest);
+        writer.addString("name", m_name);
+        writer.addString("platform", m_platform);
+        writer.addString("main", m_mainExecutable);
+        writer.beginRecord("config");
+        m_config->writeSnapshot(writer);
+        writer.commitAsync(manifestPath, source);
+    }
+    
+    return true;
+}
+
+bool Package::loadManifestFromArchive() {
+    XEMURUN_TRACE_SCOPE("package", "Package::loadManifestFromArchive");
+    
+    // Only the manifest is inflated; there is nowhere to keep a snapshot
+    std::string text;
+    if (!readArchiveEntry(m_packagePath, "manifest.json", text)) {
+        return false;
+    }
+    
+    Json::Value root;
+    Json::Reader reader;
+    
+    if (!reader.parse(text, root)) {
+        std::cerr << "Failed to parse manifest JSON" << std::endl;
+        return false;
+    }
+    
+    return applyManifest(root);
+}
+
+bool Package::applyManifest(const Json::Value& root) {
+    // Written by a newer packager; extracting it would lay files out wrongly
+    const Json::Value& format = root["format"];
+    if (!format.isNull() && (!format.isInt() || format.asInt() < 1 || format.asInt() > kPackageFormat)) {
+        std::cerr << "Unsupported package format; this version of XEmuRun reads formats up to "
+                  << kPackageFormat << std::endl;
+        return false;
+    }
+    
     m_name = root["name"].asString();
     m_platform = root["platform"].asString();
     m_mainExecutable = root["main"].asString();
     
     // Load configuration
+    auto config = std::make_shared<Config>();
     if (root.isMember("config")) {
-        m_config.loadFromJson(root["config"]);
+        config->loadFromJson(root["config"]);
     }
-    
+    m_config = config;
     return true;
 }
 
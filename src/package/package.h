@@ -3,6 +3,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 #include "../config/config.h"
 
 namespace XEmuRun {
@@ -13,13 +14,55 @@ public:
     ~Package();
     
     bool load(const std::string& packagePath);
+    // Reads the manifest without extracting anything, straight from the
+    // archive unless an extraction already exists. extract() then unpacks
+    // the files for emulators that run them from disk.
+    bool open(const std::string& packagePath);
     bool extract();
     
+    // Reads the manifest of a package that has already been extracted
+    bool loadExtracted(const std::string& extractedPath);
+    
+    // Checks the file exists and is an XEmupkg, without opening it
+    static bool isValidPackage(const std::string& packagePath);
+    
+    // Where load() extracts a package to, one directory per package below
+    // a shared root. Titles that fit ram_extraction_budget_mb go below the
+    // RAM-backed root instead, while memory is not under pressure; the
+    // budget is 0, which disables that tier, unless configured.
+    static std::string getExtractionRoot();
+    static std::string getRamExtractionRoot();
+    
+    // The directory holding the package's current extraction, or the one a
+    // disk extraction would use
+    static std::string getExtractionDirectory(const std::string& packagePath);
+    
+    // True if a complete extraction of this exact package file is on disk
+    // or in RAM, in which case load() skips extraction
+    static bool isExtracted(const std::string& packagePath);
+    
+    // Where an extraction may go
+    enum class ExtractionTier {
+        Any,                // RAM if the title fits, evicting idle RAM extractions
+        RamWithoutEviction, // RAM only if it fits next to the others
+        Disk                // survives reboots and RAM trimming
+    };
+    
+    // Extracts ahead of time, e.g. from an idle-time scheduler
+    static bool preExtract(const std::string& packagePath, ExtractionTier tier);
+    
+    // Evicts RAM extractions no loaded package uses, oldest first, while
+    // over budget or under memory pressure. Called periodically by
+    // long-running processes.
+    static void trimRamExtractions();
+    
     std::string getName() const;
     std::string getPlatform() const;
     std::string getMainExecutable() const;
+    std::string getPackagePath() const;
+    // Empty while the package is open but not extracted
     std::string getExtractedPath() const;
-    const Config& getConfig() const;
+    ConfigSnapshot getConfig() const;
     
 private:
     std::string m_packagePath;
@@ -27,11 +70,25 @@ private:
     std::string m_name;
     std::string m_platform;
     std::string m_mainExecutable;
-    Config m_config;
+    ConfigSnapshot m_config;
+    
+    // Shared lock that keeps the extraction from being evicted
+    struct UseLock;
+    std::shared_ptr<UseLock> m_useLock;
     
     bool validatePackage();
     bool extractPackage();
     bool loadManifest();
+    bool loadManifestFromArchive();
+    // Fails for packages in a format this build cannot read
+    bool applyManifest(const Json::Value& root);
+    
+    // Empty if there is no complete extraction
+    static std::string findExtraction(const std::string& packagePath);
+    // Picks the tier and extracts there, or finds another process's result.
+    // platform is empty if the manifest has not been read.
+    static bool extractTo(const std::string& packagePath, const std::string& platform, ExtractionTier tier,
+                          std::string& extractedPath);
 };
 
 } // namespace XEmuRun
@@ -161,8 +161,7 @@ int main(int argc, char* argv[]) {
     
     // If output path is not set, use the default from config
     if (packager.getOutputPath().empty()) {
-        std::string defaultOutputDir = configManager.getSystemConfig().getString(
-            "default_output_directory", "");
+        std::string defaultOutputDir(configManager.getSystemConfig()->get(XEmuRun::Keys::DefaultOutputDirectory));
         
         if (!defaultOutputDir.empty()) {
             packager.setOutputPath(defaultOutputDir);
@@ -36,6 +36,10 @@ void Packager::addConfigValue(const std::string& key, const std::string& value)
     m_configValues[key] = value;
 }
 
+void Packager::setPackageInPlace(bool inPlace) {
+    m_packageInPlace = inPlace;
+}
+
 bool Packager::createPackage() {
     if (m_gamePath.empty() || m_outputPath.empty() || m_gameName.empty() || 
         m_platform.empty() || m_mainExecutable.empty()) {
@@ -49,22 +53,27 @@ bool Packager::createPackage() {
         return false;
     }
     
-    // Create temp directory for packaging
-    std::string tempDir = (fs::temp_directory_path() / ("XEmuPkg_" + m_gameName)).string();
+    // Create temp directory for packaging, unless the game directory
+    // already sits where the archive can be built from
+    bool inPlace = m_packageInPlace && fs::path(m_gamePath).filename() == "game";
+    std::string tempDir = inPlace ? fs::path(m_gamePath).parent_path().string()
+                                  : (fs::temp_directory_path() / ("XEmuPkg_" + m_gameName)).string();
     
     try {
-        if (fs::exists(tempDir)) {
-            fs::remove_all(tempDir);
+        if (!inPlace) {
+            if (fs::exists(tempDir)) {
+                fs::remove_all(tempDir);
+            }
+            fs::create_directories(tempDir);
+            
+            // Copy game files
+            std::cout << "Copying game files..." << std::endl;
+            fs::copy(m_gamePath, tempDir + "/game", fs::copy_options::recursive);
         }
-        fs::create_directories(tempDir);
-        
-        // Copy game files
-        std::cout << "Copying game files..." << std::endl;
-        fs::copy(m_gamePath, tempDir + "/game", fs::copy_options::recursive);
         
         // Generate manifest
         std::string manifestPath = tempDir + "/manifest.json";
-        if (!generateManifest()) {
+        if (!generateManifest(manifestPath)) {
             std::cerr << "Failed to generate manifest" << std::endl;
             return false;
         }
@@ -85,7 +94,11 @@ bool Packager::createPackage() {
         
         // Clean up temp files
         std::cout << "Cleaning up temporary files..." << std::endl;
-        fs::remove_all(tempDir);
+        if (inPlace) {
+            fs::remove(manifestPath);
+        } else {
+            fs::remove_all(tempDir);
+        }
         
         return true;
     } catch (const fs::filesystem_error& e) {
@@ -94,12 +107,13 @@ bool Packager::createPackage() {
     }
 }
 
-bool Packager::generateManifest() {
+bool Packager::generateManifest(const std::string& manifestPath) {
     Json::Value root;
     root["name"] = m_gameName;
     root["platform"] = m_platform;
     root["main"] = m_mainExecutable;
     root["version"] = "1.0.0";  // Add version information
+    root["format"] = kPackageFormat;
     root["created"] = getCurrentTimestamp();
     
     // Add configuration values
@@ -110,10 +124,6 @@ bool Packager::generateManifest() {
     root["config"] = config;
     
     // Write manifest to file
-    std::string manifestPath = (fs::path(fs::temp_directory_path()) / 
-                                ("XEmuPkg_" + m_gameName) / 
-                                "manifest.json").string();
-    
     std::ofstream file(manifestPath);
     if (!file.is_open()) {
         std::cerr << "Failed to open manifest file for writing" << std::endl;
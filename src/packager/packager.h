@@ -20,6 +20,10 @@ public:
     void setPlatform(const std::string& platform);
     void setMainExecutable(const std::string& executable);
     void addConfigValue(const std::string& key, const std::string& value);
+    // The game path is a directory named "game" that may be archived where
+    // it is: the manifest is written next to it instead of both being
+    // copied to a temporary directory first
+    void setPackageInPlace(bool inPlace);
     
     // Accessor methods
     std::string getGamePath() const { return m_gamePath; }
@@ -38,8 +42,9 @@ private:
     std::string m_platform;
     std::string m_mainExecutable;
     std::map<std::string, std::string> m_configValues;
+    bool m_packageInPlace = false;
     
-    bool generateManifest();
+    bool generateManifest(const std::string& manifestPath);
     bool packageFiles();
     bool validateInputs();
     std::string getCurrentTimestamp();
@@ -1,27 +1,370 @@
 #include "archive.h"
 #include <iostream>
+#include <algorithm>
+#include <cerrno>
 #include <filesystem>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <vector>
+#include <json/json.h>
+#include "trace.h"
+#include "extraction_writer.h"
 #include <archive.h>
 #include <archive_entry.h>
 #include <fcntl.h>
 #include <cstring>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace fs = std::filesystem;
 
 namespace XEmuRun {
 
+namespace {
+
+// Entries must land inside the output directory
+bool isSafeEntryPath(const std::string& entryPath) {
+    fs::path path(entryPath);
+    if (entryPath.empty() || path.is_absolute()) {
+        return false;
+    }
+    for (const fs::path& part : path) {
+        if (part == "..") {
+            return false;
+        }
+    }
+    return true;
+}
+
+timespec entryMtime(struct archive_entry* entry) {
+    timespec mtime{0, UTIME_OMIT};
+    if (archive_entry_mtime_is_set(entry)) {
+        mtime.tv_sec = archive_entry_mtime(entry);
+        mtime.tv_nsec = archive_entry_mtime_nsec(entry);
+    }
+    return mtime;
+}
+
+// Holds the sparse maps. It is the last entry, written once every file has
+// been stored; readers fetch it (see loadSparseMaps) before reading data.
+constexpr const char* kSparseMapEntry = ".xemurun-sparse.json";
+
+// Zero runs are only turned into holes in whole, aligned blocks of this
+// size, and only in files big enough to be disk images
+constexpr int64_t kHoleBlockSize = 64 * 1024;
+constexpr int64_t kMinSparseFileSize = 1 << 20;
+
+// A file stored without its holes: the entry holds the data extents back
+// to back
+struct SparseMap {
+    int64_t size = 0;
+    std::vector<FileExtent> extents;
+    
+    int64_t dataSize() const {
+        int64_t total = 0;
+        for (const FileExtent& extent : extents) {
+            total += extent.length;
+        }
+        return total;
+    }
+};
+
+bool isZero(const char* data, size_t size) {
+    return size == 0 || (data[0] == 0 && std::memcmp(data, data + 1, size - 1) == 0);
+}
+
+void appendExtent(std::vector<FileExtent>& extents, int64_t offset, int64_t length) {
+    if (!extents.empty() && extents.back().offset + extents.back().length == offset) {
+        extents.back().length += length;
+    } else {
+        extents.push_back({offset, length});
+    }
+}
+
+// Stores a file's data extents in the entry just started, finding them as
+// it reads: the ranges SEEK_DATA/SEEK_HOLE report as data, minus any
+// blocks in them that are all zeros (e.g. an image copied without its
+// holes). Returns false if the file could not be read or stored.
+bool writeDataExtents(struct archive* a, int fd, int64_t size, std::vector<FileExtent>& extents) {
+    std::vector<char> buffer(kHoleBlockSize * 16);
+    int64_t position = 0;
+    
+    while (position < size) {
+        off_t dataStart = lseek(fd, position, SEEK_DATA);
+        if (dataStart < 0) {
+            if (errno == ENXIO) {
+                break; // a hole up to the end
+            }
+            dataStart = position; // no SEEK_DATA support: scan everything
+        }
+        off_t dataEnd = lseek(fd, dataStart, SEEK_HOLE);
+        if (dataEnd < 0 || dataEnd > size) {
+            dataEnd = size;
+        }
+        
+        for (int64_t offset = dataStart; offset < dataEnd;) {
+            // The first read ends on a block boundary so no block spans two
+            int64_t room = static_cast<int64_t>(buffer.size()) - offset % kHoleBlockSize;
+            size_t toRead = static_cast<size_t>(std::min<int64_t>(room, dataEnd - offset));
+            ssize_t got = pread(fd, buffer.data(), toRead, offset);
+            if (got <= 0) {
+                if (got < 0 && errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            
+            // Blocks are aligned to the file, not to the read
+            for (int64_t block = 0; block < got;) {
+                int64_t blockEnd = std::min<int64_t>(((offset + block) / kHoleBlockSize + 1) * kHoleBlockSize - offset, got);
+                if (!isZero(buffer.data() + block, static_cast<size_t>(blockEnd - block))) {
+                    if (archive_write_data(a, buffer.data() + block, static_cast<size_t>(blockEnd - block)) < 0) {
+                        return false;
+                    }
+                    appendExtent(extents, offset + block, blockEnd - block);
+                }
+                block = blockEnd;
+            }
+            offset += got;
+        }
+        position = dataEnd;
+    }
+    return true;
+}
+
+Json::Value sparseMapsToJson(const std::map<std::string, SparseMap>& maps) {
+    Json::Value files(Json::objectValue);
+    for (const auto& [path, map] : maps) {
+        Json::Value file;
+        file["size"] = static_cast<Json::Int64>(map.size);
+        Json::Value extents(Json::arrayValue);
+        for (const FileExtent& extent : map.extents) {
+            Json::Value pair(Json::arrayValue);
+            pair.append(static_cast<Json::Int64>(extent.offset));
+            pair.append(static_cast<Json::Int64>(extent.length));
+            extents.append(pair);
+        }
+        file["extents"] = extents;
+        files[path] = file;
+    }
+    
+    Json::Value root;
+    root["version"] = 1;
+    root["files"] = files;
+    return root;
+}
+
+bool sparseMapsFromJson(const std::string& text, std::map<std::string, SparseMap>& maps) {
+    Json::Value root;
+    Json::CharReaderBuilder reader;
+    std::string errors;
+    std::istringstream stream(text);
+    if (!Json::parseFromStream(reader, stream, &root, &errors) || root["version"].asInt() != 1) {
+        std::cerr << "Invalid sparse map: " << errors << std::endl;
+        return false;
+    }
+    
+    const Json::Value& files = root["files"];
+    for (const std::string& path : files.getMemberNames()) {
+        SparseMap map;
+        map.size = files[path]["size"].asInt64();
+        int64_t end = 0;
+        for (const Json::Value& pair : files[path]["extents"]) {
+            FileExtent extent{pair[0].asInt64(), pair[1].asInt64()};
+            // Extents are sorted, disjoint and inside the file; written
+            // without overflowing, whatever the map claims
+            if (extent.offset < end || extent.length <= 0 || extent.offset > map.size ||
+                extent.length > map.size - extent.offset) {
+                std::cerr << "Invalid sparse map for " << path << std::endl;
+                return false;
+            }
+            end = extent.offset + extent.length;
+            map.extents.push_back(extent);
+        }
+        maps[path] = std::move(map);
+    }
+    return true;
+}
+
+// Receives a file's data a block at a time, with its offset in the file
+using BlockSink = std::function<bool(const char* data, size_t size, int64_t offset)>;
+
+// Reads the sparse map entry the archive is positioned at
+bool readSparseMaps(struct archive* a, std::map<std::string, SparseMap>& maps) {
+    std::string text;
+    char buffer[8192];
+    la_ssize_t got;
+    while ((got = archive_read_data(a, buffer, sizeof(buffer))) > 0) {
+        text.append(buffer, static_cast<size_t>(got));
+    }
+    return got == 0 && sparseMapsFromJson(text, maps);
+}
+
+// The sparse maps of a package; none if it has no sparse files. Packages
+// are zips, read from their central directory, so finding the entry
+// inflates nothing else.
+bool loadSparseMaps(const std::string& archivePath, std::map<std::string, SparseMap>& maps) {
+    struct archive* a = archive_read_new();
+    archive_read_support_format_all(a);
+    archive_read_support_filter_all(a);
+    
+    if (archive_read_open_filename(a, archivePath.c_str(), 10240) != ARCHIVE_OK) {
+        std::cerr << "Error opening archive: " << archive_error_string(a) << std::endl;
+        archive_read_free(a);
+        return false;
+    }
+    
+    struct archive_entry* entry;
+    int r;
+    bool ok = true;
+    while ((r = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
+        if (std::strcmp(archive_entry_pathname(entry), kSparseMapEntry) == 0) {
+            ok = readSparseMaps(a, maps);
+            break;
+        }
+    }
+    if (r != ARCHIVE_OK && r != ARCHIVE_EOF) {
+        std::cerr << "Error reading archive header: " << archive_error_string(a) << std::endl;
+        ok = false;
+    }
+    archive_read_free(a);
+    return ok;
+}
+
+// Writes a block of a sparse file's stored bytes to where they belong.
+// starts[i] is the position in the stored bytes where extent i begins.
+bool writeSparseBlock(const BlockSink& write, const SparseMap& map, const std::vector<int64_t>& starts,
+                      const char* data, size_t size, int64_t storedOffset) {
+    while (size > 0) {
+        auto next = std::upper_bound(starts.begin(), starts.end(), storedOffset);
+        if (next == starts.begin()) {
+            return false;
+        }
+        size_t index = static_cast<size_t>(next - starts.begin()) - 1;
+        const FileExtent& extent = map.extents[index];
+        int64_t within = storedOffset - starts[index];
+        if (within >= extent.length) {
+            return false; // more data than the map describes
+        }
+        
+        size_t chunk = static_cast<size_t>(std::min<int64_t>(size, extent.length - within));
+        if (!write(data, chunk, extent.offset + within)) {
+            return false;
+        }
+        data += chunk;
+        size -= chunk;
+        storedOffset += static_cast<int64_t>(chunk);
+    }
+    return true;
+}
+
+// Passes the data of the regular file entry the archive is positioned at
+// to write, placing a sparse file's stored bytes at their real offsets
+bool readEntryData(struct archive* a, const std::string& entryPath, const SparseMap* sparse, const BlockSink& write) {
+    std::vector<int64_t> extentStarts;
+    if (sparse) {
+        int64_t stored = 0;
+        for (const FileExtent& extent : sparse->extents) {
+            extentStarts.push_back(stored);
+            stored += extent.length;
+        }
+    }
+    
+    const void* buff;
+    size_t blockSize;
+    la_int64_t offset;
+    int r;
+    while ((r = archive_read_data_block(a, &buff, &blockSize, &offset)) != ARCHIVE_EOF) {
+        if (r != ARCHIVE_OK) {
+            std::cerr << "Error reading data block: " << archive_error_string(a) << std::endl;
+            return false;
+        }
+        if (sparse) {
+            if (!writeSparseBlock(write, *sparse, extentStarts, static_cast<const char*>(buff), blockSize, offset)) {
+                std::cerr << "Entry does not match its sparse map: " << entryPath << std::endl;
+                return false;
+            }
+        } else if (!write(static_cast<const char*>(buff), blockSize, offset)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Skips to one regular file and passes its data and unpacked size on;
+// with a seekable zip the entries before it are never inflated
+bool readSingleEntry(const std::string& archivePath, const std::string& entryPath,
+                     const std::function<bool(int64_t size)>& begin, const BlockSink& write) {
+    XEMURUN_TRACE_SCOPE("archive", "readArchiveEntry", entryPath.c_str());
+    
+    std::map<std::string, SparseMap> sparseMaps;
+    if (!loadSparseMaps(archivePath, sparseMaps)) {
+        return false;
+    }
+    
+    struct archive* a = archive_read_new();
+    archive_read_support_format_all(a);
+    archive_read_support_filter_all(a);
+    
+    if (archive_read_open_filename(a, archivePath.c_str(), 10240) != ARCHIVE_OK) {
+        std::cerr << "Error opening archive: " << archive_error_string(a) << std::endl;
+        archive_read_free(a);
+        return false;
+    }
+    
+    struct archive_entry* entry;
+    bool ok = false;
+    while (true) {
+        int r = archive_read_next_header(a, &entry);
+        if (r == ARCHIVE_EOF) {
+            std::cerr << "No " << entryPath << " in " << archivePath << std::endl;
+            break;
+        }
+        if (r != ARCHIVE_OK) {
+            std::cerr << "Error reading archive header: " << archive_error_string(a) << std::endl;
+            break;
+        }
+        
+        if (archive_entry_pathname(entry) != entryPath) {
+            continue;
+        }
+        
+        if (archive_entry_filetype(entry) != AE_IFREG || archive_entry_hardlink(entry)) {
+            std::cerr << "Not a regular file: " << entryPath << std::endl;
+            break;
+        }
+        
+        auto sparse = sparseMaps.find(entryPath);
+        const SparseMap* map = sparse != sparseMaps.end() ? &sparse->second : nullptr;
+        int64_t size = map ? map->size : archive_entry_size_is_set(entry) ? archive_entry_size(entry) : 0;
+        ok = begin(size) && readEntryData(a, entryPath, map, write);
+        break;
+    }
+    
+    archive_read_free(a);
+    return ok;
+}
+
+} // namespace
+
 bool extractArchive(const std::string& archivePath, const std::string& outputDir) {
+    XEMURUN_TRACE_SCOPE("archive", "extractArchive", archivePath.c_str());
+    
     struct archive* a;
     struct archive* ext;
     struct archive_entry* entry;
     int flags;
     int r;
 
-    // Select which attributes we want to restore.
+    // Select which attributes we want to restore. These apply to the
+    // entries ExtractionWriter does not handle (links, special files).
     flags = ARCHIVE_EXTRACT_TIME;
     flags |= ARCHIVE_EXTRACT_PERM;
     flags |= ARCHIVE_EXTRACT_ACL;
     flags |= ARCHIVE_EXTRACT_FFLAGS;
+    flags |= ARCHIVE_EXTRACT_SECURE_NODOTDOT;
+    flags |= ARCHIVE_EXTRACT_SECURE_SYMLINKS;
 
     a = archive_read_new();
     archive_read_support_format_all(a);
@@ -30,8 +373,16 @@ bool extractArchive(const std::string& archivePath, const std::string& outputDir
     archive_write_disk_set_options(ext, flags);
     archive_write_disk_set_standard_lookup(ext);
 
+    auto cleanup = [&] {
+        archive_read_close(a);
+        archive_read_free(a);
+        archive_write_close(ext);
+        archive_write_free(ext);
+    };
+
     if ((r = archive_read_open_filename(a, archivePath.c_str(), 10240))) {
         std::cerr << "Error opening archive: " << archive_error_string(a) << std::endl;
+        cleanup();
         return false;
     }
 
@@ -41,67 +392,253 @@ bool extractArchive(const std::string& archivePath, const std::string& outputDir
             fs::create_directories(outputDir);
         } catch (const fs::filesystem_error& e) {
             std::cerr << "Failed to create output directory: " << e.what() << std::endl;
+            cleanup();
             return false;
         }
     }
 
+    // Sparse files are laid out by the map before their data arrives
+    std::map<std::string, SparseMap> sparseMaps;
+    if (!loadSparseMaps(archivePath, sparseMaps)) {
+        cleanup();
+        return false;
+    }
+
+    // Directories and regular files, i.e. everything the packager writes,
+    // go through the preallocating batched writer
+    ExtractionWriter writer(outputDir);
+    bool ok = true;
+
     // Extract each entry
-    for (;;) {
+    while (ok) {
         r = archive_read_next_header(a, &entry);
         if (r == ARCHIVE_EOF)
             break;
         if (r != ARCHIVE_OK) {
             std::cerr << "Error reading archive header: " << archive_error_string(a) << std::endl;
-            return false;
+            ok = false;
+            break;
         }
 
         // Prepare full output path
         std::string entryPath = archive_entry_pathname(entry);
+        if (!isSafeEntryPath(entryPath)) {
+            std::cerr << "Refusing to extract entry outside the output directory: " << entryPath << std::endl;
+            ok = false;
+            break;
+        }
         std::string fullOutputPath = (fs::path(outputDir) / entryPath).string();
         
+        if (entryPath == kSparseMapEntry) {
+            continue;
+        }
+        
+        unsigned fileType = archive_entry_filetype(entry);
+        mode_t perm = archive_entry_perm(entry);
+        
+        if (fileType == AE_IFDIR) {
+            ok = writer.makeDirectory(fullOutputPath, perm, entryMtime(entry));
+            continue;
+        }
+        
+        if (fileType == AE_IFREG && !archive_entry_hardlink(entry)) {
+            int64_t size = archive_entry_size_is_set(entry) ? archive_entry_size(entry) : 0;
+            
+            // A sparse file's entry holds only its data extents
+            auto sparse = sparseMaps.find(entryPath);
+            const SparseMap* map = sparse != sparseMaps.end() ? &sparse->second : nullptr;
+            if (map) {
+                size = map->size;
+            }
+            ok = writer.openFile(fullOutputPath, perm, size, entryMtime(entry), map ? &map->extents : nullptr) &&
+                 readEntryData(a, entryPath, map, [&](const char* data, size_t length, int64_t offset) {
+                     return writer.write(data, length, offset);
+                 });
+            
+            ok = writer.closeFile() && ok;
+            continue;
+        }
+        
         // Update the entry with the new path
         archive_entry_set_pathname(entry, fullOutputPath.c_str());
+        if (const char* target = archive_entry_hardlink(entry)) {
+            if (!isSafeEntryPath(target)) {
+                std::cerr << "Refusing to extract link outside the output directory: " << entryPath << std::endl;
+                ok = false;
+                break;
+            }
+            archive_entry_set_hardlink(entry, (fs::path(outputDir) / target).string().c_str());
+        }
 
         r = archive_write_header(ext, entry);
         if (r != ARCHIVE_OK) {
             std::cerr << "Error writing header: " << archive_error_string(ext) << std::endl;
-        } else {
-            // Copy the file data if it's a regular file
-            if (archive_entry_size(entry) > 0) {
-                const void* buff;
-                size_t size;
-                la_int64_t offset;
-
-                while ((r = archive_read_data_block(a, &buff, &size, &offset)) != ARCHIVE_EOF) {
-                    if (r != ARCHIVE_OK) {
-                        std::cerr << "Error reading data block: " << archive_error_string(a) << std::endl;
-                        break;
-                    }
-                    r = archive_write_data_block(ext, buff, size, offset);
-                    if (r != ARCHIVE_OK) {
-                        std::cerr << "Error writing data block: " << archive_error_string(ext) << std::endl;
-                        break;
-                    }
-                }
-            }
         }
         
         r = archive_write_finish_entry(ext);
         if (r != ARCHIVE_OK) {
             std::cerr << "Error finishing entry: " << archive_error_string(ext) << std::endl;
-            return false;
+            ok = false;
         }
     }
 
-    archive_read_close(a);
+    ok = writer.finish() && ok;
+    cleanup();
+    
+    return ok;
+}
+
+bool archiveUncompressedSize(const std::string& archivePath, uint64_t& size) {
+    XEMURUN_TRACE_SCOPE("archive", "archiveUncompressedSize", archivePath.c_str());
+    
+    // A sparse file's entry holds only its data; it unpacks to its full size
+    std::map<std::string, SparseMap> sparseMaps;
+    if (!loadSparseMaps(archivePath, sparseMaps)) {
+        return false;
+    }
+    
+    struct archive* a = archive_read_new();
+    archive_read_support_format_all(a);
+    archive_read_support_filter_all(a);
+    
+    if (archive_read_open_filename(a, archivePath.c_str(), 10240) != ARCHIVE_OK) {
+        std::cerr << "Error opening archive: " << archive_error_string(a) << std::endl;
+        archive_read_free(a);
+        return false;
+    }
+    
+    // Seekable zips answer this from the central directory without
+    // inflating any data
+    size = 0;
+    struct archive_entry* entry;
+    int r;
+    while ((r = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
+        std::string path = archive_entry_pathname(entry);
+        auto sparse = sparseMaps.find(path);
+        if (sparse != sparseMaps.end()) {
+            size += static_cast<uint64_t>(sparse->second.size);
+        } else if (path != kSparseMapEntry && archive_entry_size_is_set(entry) && archive_entry_size(entry) > 0) {
+            size += static_cast<uint64_t>(archive_entry_size(entry));
+        }
+    }
+    
+    bool ok = r == ARCHIVE_EOF;
+    if (!ok) {
+        std::cerr << "Error reading archive header: " << archive_error_string(a) << std::endl;
+    }
+    archive_read_free(a);
+    return ok;
+}
+
+bool listArchive(const std::string& archivePath, std::vector<ArchiveEntryInfo>& entries) {
+    XEMURUN_TRACE_SCOPE("archive", "listArchive", archivePath.c_str());
+    
+    std::map<std::string, SparseMap> sparseMaps;
+    if (!loadSparseMaps(archivePath, sparseMaps)) {
+        return false;
+    }
+    
+    struct archive* a = archive_read_new();
+    archive_read_support_format_all(a);
+    archive_read_support_filter_all(a);
+    
+    if (archive_read_open_filename(a, archivePath.c_str(), 10240) != ARCHIVE_OK) {
+        std::cerr << "Error opening archive: " << archive_error_string(a) << std::endl;
+        archive_read_free(a);
+        return false;
+    }
+    
+    entries.clear();
+    struct archive_entry* entry;
+    int r;
+    while ((r = archive_read_next_header(a, &entry)) == ARCHIVE_OK) {
+        std::string path = archive_entry_pathname(entry);
+        if (path == kSparseMapEntry) {
+            continue;
+        }
+        
+        auto sparse = sparseMaps.find(path);
+        int64_t size = sparse != sparseMaps.end() ? sparse->second.size
+                     : archive_entry_size_is_set(entry) ? archive_entry_size(entry) : 0;
+        entries.push_back({std::move(path), static_cast<uint64_t>(std::max<int64_t>(size, 0)),
+                           archive_entry_filetype(entry) == AE_IFDIR});
+    }
+    
+    bool ok = r == ARCHIVE_EOF;
+    if (!ok) {
+        std::cerr << "Error reading archive header: " << archive_error_string(a) << std::endl;
+    }
     archive_read_free(a);
-    archive_write_close(ext);
-    archive_write_free(ext);
+    return ok;
+}
+
+bool readArchiveEntry(const std::string& archivePath, const std::string& entryPath, std::string& contents) {
+    contents.clear();
+    return readSingleEntry(archivePath, entryPath,
+        [&](int64_t size) {
+            contents.assign(static_cast<size_t>(std::max<int64_t>(size, 0)), '\0');
+            return true;
+        },
+        [&](const char* data, size_t length, int64_t offset) {
+            if (static_cast<size_t>(offset) + length > contents.size()) {
+                contents.resize(static_cast<size_t>(offset) + length);
+            }
+            std::memcpy(&contents[static_cast<size_t>(offset)], data, length);
+            return true;
+        });
+}
+
+bool readArchiveEntry(const std::string& archivePath, const std::string& entryPath, int fd) {
+    return readSingleEntry(archivePath, entryPath,
+        [&](int64_t size) {
+            // Holes in a sparse file stay holes
+            if (ftruncate(fd, size) != 0) {
+                std::cerr << "Failed to size " << entryPath << ": " << std::strerror(errno) << std::endl;
+                return false;
+            }
+            return true;
+        },
+        [&](const char* data, size_t length, int64_t offset) {
+            while (length > 0) {
+                ssize_t written = pwrite(fd, data, length, offset);
+                if (written < 0 && errno == EINTR) {
+                    continue;
+                }
+                if (written < 0) {
+                    std::cerr << "Failed to write " << entryPath << ": " << std::strerror(errno) << std::endl;
+                    return false;
+                }
+                data += written;
+                length -= static_cast<size_t>(written);
+                offset += written;
+            }
+            return true;
+        });
+}
+
+bool readSparseMap(const std::string& archivePath, const std::string& entryPath, bool& sparse,
+                   int64_t& size, std::vector<FileExtent>& extents) {
+    sparse = false;
     
+    // Maps are checked as they are parsed: extents sorted, disjoint and
+    // inside the file
+    std::map<std::string, SparseMap> sparseMaps;
+    if (!loadSparseMaps(archivePath, sparseMaps)) {
+        return false;
+    }
+    
+    auto map = sparseMaps.find(entryPath);
+    if (map != sparseMaps.end()) {
+        sparse = true;
+        size = map->second.size;
+        extents = map->second.extents;
+    }
     return true;
 }
 
 bool createArchive(const std::string& directoryPath, const std::string& outputArchive) {
+    XEMURUN_TRACE_SCOPE("archive", "createArchive", outputArchive.c_str());
+    
     struct archive* a;
     struct archive_entry* entry;
     struct stat st;
@@ -122,45 +659,83 @@ bool createArchive(const std::string& directoryPath, const std::string& outputAr
     fs::path sourceDirPath = fs::absolute(directoryPath);
 
     try {
-        // Recursively add all files and directories
+        std::vector<std::pair<std::string, std::string>> files;
         for (const auto& entry_path : fs::recursive_directory_iterator(sourceDirPath)) {
-            std::string fullPath = entry_path.path().string();
-            std::string relativePath = entry_path.path().lexically_relative(sourceDirPath).string();
-
             // Skip if entry is a directory
             if (fs::is_directory(entry_path)) {
                 continue;
             }
+            files.emplace_back(entry_path.path().string(),
+                               entry_path.path().lexically_relative(sourceDirPath).string());
+        }
 
+        // Disk images are mostly holes or zeros; those are left out of the
+        // package and recreated as holes on extraction
+        std::map<std::string, SparseMap> sparseMaps;
+        for (const auto& [fullPath, relativePath] : files) {
             // Get file info
             if (stat(fullPath.c_str(), &st) != 0) {
                 std::cerr << "Failed to stat file: " << fullPath << std::endl;
                 continue;
             }
 
-            // Create a new entry
+            fd = open(fullPath.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0) {
+                std::cerr << "Failed to open file for reading: " << fullPath << std::endl;
+                continue;
+            }
+
+            // Create a new entry. Holes in a large file are found while it
+            // is stored, so its stored size is only known at the end.
+            bool maybeSparse = st.st_size >= kMinSparseFileSize;
             entry = archive_entry_new();
             archive_entry_set_pathname(entry, relativePath.c_str());
-            archive_entry_set_size(entry, st.st_size);
+            if (!maybeSparse) {
+                archive_entry_set_size(entry, st.st_size);
+            }
             archive_entry_set_filetype(entry, AE_IFREG);
             archive_entry_set_perm(entry, 0644);
             archive_write_header(a, entry);
 
             // Write file data to archive
-            fd = open(fullPath.c_str(), O_RDONLY);
-            if (fd < 0) {
-                std::cerr << "Failed to open file for reading: " << fullPath << std::endl;
-                archive_entry_free(entry);
-                continue;
-            }
-
-            while ((len = read(fd, buff, sizeof(buff))) > 0) {
-                archive_write_data(a, buff, len);
+            if (maybeSparse) {
+                SparseMap map;
+                map.size = st.st_size;
+                if (!writeDataExtents(a, fd, st.st_size, map.extents)) {
+                    std::cerr << "Failed to store " << fullPath << std::endl;
+                    close(fd);
+                    archive_entry_free(entry);
+                    archive_write_close(a);
+                    archive_write_free(a);
+                    return false;
+                }
+                if (map.dataSize() < map.size) {
+                    sparseMaps[relativePath] = std::move(map);
+                }
+            } else {
+                while ((len = read(fd, buff, sizeof(buff))) > 0) {
+                    archive_write_data(a, buff, len);
+                }
             }
 
             close(fd);
             archive_entry_free(entry);
         }
+
+        if (!sparseMaps.empty()) {
+            Json::StreamWriterBuilder writer;
+            writer["indentation"] = "";
+            std::string text = Json::writeString(writer, sparseMapsToJson(sparseMaps));
+
+            entry = archive_entry_new();
+            archive_entry_set_pathname(entry, kSparseMapEntry);
+            archive_entry_set_size(entry, static_cast<la_int64_t>(text.size()));
+            archive_entry_set_filetype(entry, AE_IFREG);
+            archive_entry_set_perm(entry, 0644);
+            archive_write_header(a, entry);
+            archive_write_data(a, text.data(), text.size());
+            archive_entry_free(entry);
+        }
     } catch (const fs::filesystem_error& e) {
         std::cerr << "Error accessing directory: " << e.what() << std::endl;
         archive_write_close(a);
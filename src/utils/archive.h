@@ -1,10 +1,39 @@
 #pragma once
 
 #include <string>
+#include <vector>
+#include <cstdint>
+#include "extraction_writer.h"
 
 namespace XEmuRun {
 
+// Layout of the packages createArchive() writes, recorded in their manifest
+// as "format"; packages without one are format 1. Format 2 stores sparse
+// files without their holes. Readers refuse packages newer than they know,
+// which they would otherwise extract wrongly.
+constexpr int kPackageFormat = 2;
+
+// A file or directory as stored in an archive, listed without inflating it
+struct ArchiveEntryInfo {
+    std::string path;
+    uint64_t size; // unpacked size; holes in sparse files included
+    bool isDirectory;
+};
+
 bool extractArchive(const std::string& archivePath, const std::string& outputDir);
+// Sum of the unpacked file sizes, holes in sparse files included, i.e. the
+// space an extraction needs at most
+bool archiveUncompressedSize(const std::string& archivePath, uint64_t& size);
+bool listArchive(const std::string& archivePath, std::vector<ArchiveEntryInfo>& entries);
+// Inflates a single regular file, into memory or into an open file
+// descriptor (e.g. a memfd), leaving everything else in the archive alone
+bool readArchiveEntry(const std::string& archivePath, const std::string& entryPath, std::string& contents);
+bool readArchiveEntry(const std::string& archivePath, const std::string& entryPath, int fd);
+// Whether a file was stored without its holes and, if so, its real size
+// and the data extents its entry holds back to back. Fails for a map whose
+// extents are unsorted, overlap or lie outside the file.
+bool readSparseMap(const std::string& archivePath, const std::string& entryPath, bool& sparse,
+                   int64_t& size, std::vector<FileExtent>& extents);
 bool createArchive(const std::string& directoryPath, const std::string& outputArchive);
 
 } // namespace XEmuRun
@@ -0,0 +1,280 @@
+#include "binary_discovery.h"
+#include "trace.h"
+#include "../config/config_manager.h"
+#include <iostream>
+#include <chrono>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <json/json.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+constexpr const char* kCacheFile = "binaries.json";
+
+// A binary that starts its UI instead of printing a version is killed
+constexpr int kVersionTimeoutMs = 2000;
+
+bool isExecutableFile(const std::string& path, struct stat& st) {
+    return stat(path.c_str(), &st) == 0 && S_ISREG(st.st_mode) && access(path.c_str(), X_OK) == 0;
+}
+
+// Entries are per lookup: different known locations may find a different
+// binary of the same name
+std::string cacheKey(const std::string& name, const std::vector<std::string>& knownLocations) {
+    std::string key = name;
+    for (const std::string& location : knownLocations) {
+        key += "\n" + location;
+    }
+    return key;
+}
+
+int64_t mtimeNsOf(const struct stat& st) {
+    return static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+}
+
+std::string queryVersion(const std::string& path) {
+    XEMURUN_TRACE_SCOPE("discovery", "queryVersion", path.c_str());
+
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) != 0) {
+        return "";
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_adddup2(&actions, pipeFds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    std::string versionFlag = "--version";
+    char* argv[] = {const_cast<char*>(path.c_str()), versionFlag.data(), nullptr};
+    pid_t pid = -1;
+    int result = posix_spawn(&pid, path.c_str(), &actions, nullptr, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(pipeFds[1]);
+    if (result != 0) {
+        close(pipeFds[0]);
+        return "";
+    }
+
+    // The first line is all that is kept
+    std::string output;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kVersionTimeoutMs);
+    bool closed = false;
+    while (output.find('\n') == std::string::npos && output.size() < 4096) {
+        auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+        pollfd fd = {pipeFds[0], POLLIN, 0};
+        if (remaining.count() <= 0 || poll(&fd, 1, static_cast<int>(remaining.count())) == 0) {
+            break;
+        }
+        char buffer[512];
+        ssize_t count = read(pipeFds[0], buffer, sizeof(buffer));
+        if (count < 0 && errno == EINTR) {
+            continue;
+        }
+        if (count <= 0) {
+            closed = true;
+            break;
+        }
+        output.append(buffer, static_cast<size_t>(count));
+    }
+    close(pipeFds[0]);
+
+    // Closing stdout is not exiting: the same deadline applies to the exit
+    bool exited = false;
+    while (closed && !exited) {
+        pid_t reaped = waitpid(pid, nullptr, WNOHANG);
+        if (reaped == pid || (reaped < 0 && errno != EINTR)) {
+            exited = true;
+        } else if (std::chrono::steady_clock::now() >= deadline) {
+            break;
+        } else if (reaped == 0) {
+            usleep(10000);
+        }
+    }
+    if (!exited) {
+        kill(pid, SIGKILL);
+        while (waitpid(pid, nullptr, 0) < 0 && errno == EINTR) {
+        }
+    }
+
+    output = output.substr(0, output.find('\n'));
+    while (!output.empty() && (output.back() == '\r' || output.back() == ' ')) {
+        output.pop_back();
+    }
+    return output;
+}
+
+} // namespace
+
+BinaryDiscovery& BinaryDiscovery::getInstance() {
+    static BinaryDiscovery instance;
+    return instance;
+}
+
+std::string BinaryDiscovery::find(const std::string& name, const std::vector<std::string>& knownLocations) {
+    XEMURUN_TRACE_SCOPE("discovery", "BinaryDiscovery::find", name.c_str());
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    load();
+
+    std::string key = cacheKey(name, knownLocations);
+    auto cached = m_entries.find(key);
+    if (cached != m_entries.end() && isCurrent(cached->second)) {
+        return cached->second.path;
+    }
+
+    std::vector<std::string> candidates;
+    const char* path = std::getenv("PATH");
+    std::string searchPath = path ? path : "/usr/local/bin:/usr/bin:/bin";
+    size_t start = 0;
+    while (start <= searchPath.size()) {
+        size_t end = searchPath.find(':', start);
+        std::string directory = searchPath.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        start = end == std::string::npos ? searchPath.size() + 1 : end + 1;
+        if (!directory.empty()) {
+            candidates.push_back((fs::path(directory) / name).string());
+        }
+    }
+    candidates.insert(candidates.end(), knownLocations.begin(), knownLocations.end());
+
+    for (const std::string& candidate : candidates) {
+        struct stat st;
+        if (!isExecutableFile(candidate, st)) {
+            continue;
+        }
+
+        Entry entry;
+        entry.path = fs::absolute(candidate).lexically_normal().string();
+        entry.device = static_cast<uint64_t>(st.st_dev);
+        entry.inode = static_cast<uint64_t>(st.st_ino);
+        entry.mtimeNs = mtimeNsOf(st);
+        m_entries[key] = entry;
+        save();
+        return entry.path;
+    }
+
+    if (cached != m_entries.end()) {
+        m_entries.erase(cached);
+        save();
+    }
+    return "";
+}
+
+std::string BinaryDiscovery::getVersion(const std::string& name, const std::vector<std::string>& knownLocations) {
+    std::string path = find(name, knownLocations);
+    if (path.empty()) {
+        return "";
+    }
+
+    std::string key = cacheKey(name, knownLocations);
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        const Entry& entry = m_entries[key];
+        if (entry.hasVersion && entry.path == path) {
+            return entry.version;
+        }
+    }
+
+    // Outside the lock: it runs a program
+    std::string version = queryVersion(path);
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Entry& entry = m_entries[key];
+    if (entry.path == path) {
+        entry.hasVersion = true;
+        entry.version = version;
+        save();
+    }
+    return version;
+}
+
+void BinaryDiscovery::load() {
+    if (m_loaded) {
+        return;
+    }
+    m_loaded = true;
+
+    std::ifstream file(ConfigManager::getInstance().getConfigDirectory() + "/" + kCacheFile);
+    Json::Value root;
+    Json::Reader reader;
+    if (!file || !reader.parse(file, root) || root["version"].asInt() != 1) {
+        return;
+    }
+
+    const Json::Value& binaries = root["binaries"];
+    for (const std::string& key : binaries.getMemberNames()) {
+        const Json::Value& value = binaries[key];
+        Entry entry;
+        entry.path = value["path"].asString();
+        entry.device = value["device"].asUInt64();
+        entry.inode = value["inode"].asUInt64();
+        entry.mtimeNs = value["mtime_ns"].asInt64();
+        entry.hasVersion = value.isMember("version_output");
+        entry.version = value["version_output"].asString();
+        if (!entry.path.empty()) {
+            m_entries[key] = std::move(entry);
+        }
+    }
+}
+
+void BinaryDiscovery::save() const {
+    Json::Value root;
+    root["version"] = 1;
+    Json::Value& binaries = root["binaries"];
+    binaries = Json::Value(Json::objectValue);
+    for (const auto& [key, entry] : m_entries) {
+        Json::Value value;
+        value["path"] = entry.path;
+        value["device"] = Json::UInt64(entry.device);
+        value["inode"] = Json::UInt64(entry.inode);
+        value["mtime_ns"] = Json::Int64(entry.mtimeNs);
+        if (entry.hasVersion) {
+            value["version_output"] = entry.version;
+        }
+        binaries[key] = value;
+    }
+
+    // Replaced by rename, so concurrent launches never read half a file
+    std::string configDir = ConfigManager::getInstance().getConfigDirectory();
+    std::error_code ec;
+    fs::create_directories(configDir, ec);
+    std::string path = configDir + "/" + kCacheFile;
+    std::string tempPath = path + "." + std::to_string(getpid()) + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        Json::StyledWriter writer;
+        file << writer.write(root);
+        if (!file) {
+            std::remove(tempPath.c_str());
+            return;
+        }
+    }
+    if (std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        std::remove(tempPath.c_str());
+    }
+}
+
+bool BinaryDiscovery::isCurrent(const Entry& entry) const {
+    struct stat st;
+    return isExecutableFile(entry.path, st) && static_cast<uint64_t>(st.st_dev) == entry.device &&
+           static_cast<uint64_t>(st.st_ino) == entry.inode && mtimeNsOf(st) == entry.mtimeNs;
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace XEmuRun {
+
+/**
+ * @class BinaryDiscovery
+ * @brief Finds emulator and runtime binaries once and remembers them.
+ *
+ * A binary is looked up in PATH, then in the caller's known install
+ * locations. What was found is kept in binaries.json in the configuration
+ * directory together with the file's device, inode and mtime, so later
+ * launches, in any process, only stat() it to confirm nothing changed. A
+ * binary installed into an earlier PATH directory afterwards is not
+ * noticed until the remembered one changes or disappears. Lookups with
+ * different known locations are remembered separately, so changing them
+ * (e.g. a custom path in the configuration) searches again.
+ *
+ * Safe to call from several threads, e.g. emulators preparing in parallel.
+ */
+class BinaryDiscovery {
+public:
+    static BinaryDiscovery& getInstance();
+
+    // Absolute path of the binary, or empty if it is not installed.
+    // Missing binaries are looked up again every time.
+    std::string find(const std::string& name, const std::vector<std::string>& knownLocations = {});
+
+    // First line of `<binary> --version`, run only when the binary is new
+    // or has changed. Empty if it is not installed or printed nothing.
+    std::string getVersion(const std::string& name, const std::vector<std::string>& knownLocations = {});
+
+private:
+    BinaryDiscovery() = default;
+
+    struct Entry {
+        std::string path;
+        uint64_t device = 0;
+        uint64_t inode = 0;
+        int64_t mtimeNs = 0;
+        bool hasVersion = false;
+        std::string version;
+    };
+
+    // With the lock held
+    void load();
+    void save() const;
+    bool isCurrent(const Entry& entry) const;
+
+    std::mutex m_mutex;
+    bool m_loaded = false;
+    std::map<std::string, Entry> m_entries;
+};
+
+} // namespace XEmuRun
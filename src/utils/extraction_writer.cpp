@@ -0,0 +1,412 @@
+#include "extraction_writer.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <unistd.h>
+#ifdef XEMURUN_HAVE_LIBURING
+#include <liburing.h>
+#endif
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+// Large enough for the device to stream, few enough to bound memory
+constexpr size_t kBufferSize = 1 << 20;
+constexpr size_t kBufferCount = 16;
+
+// Queued writes are handed to the kernel in groups of this many
+constexpr int kSubmitBatch = 4;
+
+bool writeFully(int fd, const char* data, size_t size, int64_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, offset);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+        offset += written;
+    }
+    return true;
+}
+
+bool reserve(int fd, int64_t offset, int64_t length) {
+    return fallocate(fd, 0, offset, length) == 0 || errno == EOPNOTSUPP || errno == ENOSYS;
+}
+
+} // namespace
+
+struct ExtractionWriter::File {
+    int fd = -1;
+    std::string path;
+    timespec mtime{};
+    int pendingWrites = 0;
+    bool closeRequested = false;
+    bool failed = false;
+};
+
+struct ExtractionWriter::Buffer {
+    std::unique_ptr<char[]> data{new char[kBufferSize]};
+    size_t length = 0;
+    int64_t offset = 0;
+    std::shared_ptr<File> file;
+};
+
+#ifdef XEMURUN_HAVE_LIBURING
+struct ExtractionWriter::Ring {
+    io_uring ring;
+    ~Ring() { io_uring_queue_exit(&ring); }
+};
+#else
+struct ExtractionWriter::Ring {};
+#endif
+
+ExtractionWriter::ExtractionWriter(const std::string& outputDir) : m_outputDir(outputDir) {
+    m_rootFd = open(outputDir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (m_rootFd < 0) {
+        std::cerr << "Failed to open " << outputDir << ": " << std::strerror(errno) << std::endl;
+        m_failed = true;
+    }
+#ifdef XEMURUN_HAVE_LIBURING
+    // Kernels without io_uring, or with it disabled, get the pwrite path
+    auto ring = std::make_unique<Ring>();
+    if (io_uring_queue_init(kBufferCount, &ring->ring, 0) == 0) {
+        m_ring = std::move(ring);
+    }
+#endif
+}
+
+ExtractionWriter::~ExtractionWriter() {
+    // Buffers must outlive the kernel's use of them
+    while (m_inFlight > 0 && reapOne()) {
+    }
+    if (m_file && m_file->fd >= 0) {
+        close(m_file->fd);
+    }
+    if (m_rootFd >= 0) {
+        close(m_rootFd);
+    }
+}
+
+std::string ExtractionWriter::relativePath(const std::string& path) const {
+    fs::path relative = fs::path(path).lexically_relative(m_outputDir);
+    if (relative.empty() || *relative.begin() == "..") {
+        errno = EPERM;
+        return "";
+    }
+    return relative.string();
+}
+
+int ExtractionWriter::openDirectory(const std::string& path, bool create) {
+    if (m_rootFd < 0) {
+        return -1;
+    }
+
+    int dirFd = dup(m_rootFd);
+    for (const fs::path& component : fs::path(path)) {
+        if (dirFd < 0) {
+            break;
+        }
+        if (component.empty() || component == ".") {
+            continue;
+        }
+        if (component == ".." || component == "/") {
+            close(dirFd);
+            errno = EPERM;
+            return -1;
+        }
+
+        if (create && mkdirat(dirFd, component.c_str(), 0777) != 0 && errno != EEXIST) {
+            close(dirFd);
+            return -1;
+        }
+        int next = openat(dirFd, component.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        int error = errno;
+        close(dirFd);
+        errno = error;
+        dirFd = next;
+    }
+    return dirFd;
+}
+
+bool ExtractionWriter::makeDirectory(const std::string& path, mode_t mode, const timespec& mtime) {
+    std::string relative = relativePath(path);
+    int fd = relative.empty() ? -1 : openDirectory(relative, true);
+    if (fd < 0) {
+        std::cerr << "Failed to create directory " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    close(fd);
+
+    // A read-only mode would stop the contents from being created, and
+    // creating them would undo the mtime
+    m_directoryFixups.push_back({relative, mode, mtime});
+    return true;
+}
+
+bool ExtractionWriter::openFile(const std::string& path, mode_t mode, int64_t size, const timespec& mtime,
+                                const std::vector<FileExtent>* dataExtents) {
+    if (m_file && !closeFile()) {
+        return false;
+    }
+
+    // Neither a parent nor the file itself may be a symlink
+    fs::path relative = relativePath(path);
+    int fd = -1;
+    int parentFd = relative.empty() ? -1 : openDirectory(relative.parent_path().string(), true);
+    if (parentFd >= 0) {
+        fd = openat(parentFd, relative.filename().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC | O_NOFOLLOW, 0600);
+        int error = errno;
+        close(parentFd);
+        errno = error;
+    }
+    if (fd < 0) {
+        std::cerr << "Failed to create " << path << ": " << std::strerror(errno) << std::endl;
+        m_failed = true;
+        return false;
+    }
+    fchmod(fd, mode);
+
+    // One contiguous allocation instead of one extent per write. Filesystems
+    // without fallocate just allocate as the writes arrive.
+    bool reserved = true;
+    if (dataExtents) {
+        reserved = ftruncate(fd, size) == 0;
+        for (const FileExtent& extent : *dataExtents) {
+            reserved = reserved && reserve(fd, extent.offset, extent.length);
+        }
+    } else if (size > 0) {
+        reserved = reserve(fd, 0, size);
+    }
+    if (!reserved) {
+        std::cerr << "Failed to reserve space for " << path << ": " << std::strerror(errno) << std::endl;
+        close(fd);
+        m_failed = true;
+        return false;
+    }
+
+    m_file = std::make_shared<File>();
+    m_file->fd = fd;
+    m_file->path = path;
+    m_file->mtime = mtime;
+    return true;
+}
+
+bool ExtractionWriter::write(const void* data, size_t size, int64_t offset) {
+    if (!m_file) {
+        return false;
+    }
+
+    // Archives hand out data in blocks of a few KiB; contiguous blocks are
+    // gathered into one write
+    if (m_current && m_current->offset + static_cast<int64_t>(m_current->length) != offset && !flush()) {
+        return false;
+    }
+
+    const char* bytes = static_cast<const char*>(data);
+    while (size > 0) {
+        if (!m_current) {
+            m_current = acquireBuffer();
+            if (!m_current) {
+                return false;
+            }
+            m_current->offset = offset;
+            m_current->file = m_file;
+        }
+
+        size_t chunk = std::min(size, kBufferSize - m_current->length);
+        std::memcpy(m_current->data.get() + m_current->length, bytes, chunk);
+        m_current->length += chunk;
+        bytes += chunk;
+        size -= chunk;
+        offset += static_cast<int64_t>(chunk);
+
+        if (m_current->length == kBufferSize && !flush()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool ExtractionWriter::closeFile() {
+    if (!m_file) {
+        return true;
+    }
+
+    bool ok = flush();
+    std::shared_ptr<File> file = std::move(m_file);
+    file->closeRequested = true;
+    if (file->pendingWrites == 0) {
+        finalizeFile(*file);
+    }
+    return ok && !file->failed;
+}
+
+bool ExtractionWriter::finish() {
+    closeFile();
+
+    while (m_inFlight > 0) {
+        if (!reapOne()) {
+            m_failed = true;
+            break;
+        }
+    }
+
+    // Parents were created before their children, so the deepest
+    // directories come last; their times no longer change after this
+    for (auto it = m_directoryFixups.rbegin(); it != m_directoryFixups.rend(); ++it) {
+        int dirFd = openDirectory(it->path, false);
+        if (dirFd >= 0) {
+            timespec times[2] = {it->mtime, it->mtime};
+            futimens(dirFd, times);
+            fchmod(dirFd, it->mode);
+            close(dirFd);
+        }
+    }
+    m_directoryFixups.clear();
+
+    // One flush of the filesystem instead of an fsync per file, so the
+    // extraction marker written afterwards never outlives the data
+    if (m_rootFd >= 0 && syncfs(m_rootFd) != 0) {
+        std::cerr << "Failed to sync " << m_outputDir << ": " << std::strerror(errno) << std::endl;
+        m_failed = true;
+    }
+
+    return !m_failed;
+}
+
+ExtractionWriter::Buffer* ExtractionWriter::acquireBuffer() {
+    if (m_freeBuffers.empty() && m_buffers.size() < kBufferCount) {
+        m_buffers.push_back(std::make_unique<Buffer>());
+        m_freeBuffers.push_back(m_buffers.back().get());
+    }
+
+    // All buffers are in flight; the oldest write frees one
+    while (m_freeBuffers.empty()) {
+        if (!reapOne()) {
+            m_failed = true;
+            return nullptr;
+        }
+    }
+
+    Buffer* buffer = m_freeBuffers.back();
+    m_freeBuffers.pop_back();
+    buffer->length = 0;
+    return buffer;
+}
+
+bool ExtractionWriter::flush() {
+    Buffer* buffer = m_current;
+    m_current = nullptr;
+    if (!buffer) {
+        return true;
+    }
+    if (buffer->length == 0) {
+        buffer->file.reset();
+        m_freeBuffers.push_back(buffer);
+        return true;
+    }
+
+    buffer->file->pendingWrites++;
+    m_inFlight++;
+
+#ifdef XEMURUN_HAVE_LIBURING
+    if (m_ring) {
+        io_uring_sqe* sqe = io_uring_get_sqe(&m_ring->ring);
+        if (!sqe) {
+            io_uring_submit(&m_ring->ring);
+            m_unsubmitted = 0;
+            sqe = io_uring_get_sqe(&m_ring->ring);
+        }
+        if (sqe) {
+            io_uring_prep_write(sqe, buffer->file->fd, buffer->data.get(), buffer->length, buffer->offset);
+            io_uring_sqe_set_data(sqe, buffer);
+            if (++m_unsubmitted >= kSubmitBatch) {
+                io_uring_submit(&m_ring->ring);
+                m_unsubmitted = 0;
+            }
+            return true;
+        }
+    }
+#endif
+
+    bool ok = writeFully(buffer->file->fd, buffer->data.get(), buffer->length, buffer->offset);
+    complete(buffer, ok ? static_cast<ssize_t>(buffer->length) : -errno);
+    return ok;
+}
+
+void ExtractionWriter::complete(Buffer* buffer, ssize_t result) {
+    File& file = *buffer->file;
+
+    // Short writes are rare (e.g. a signal); the rest is written directly
+    if (result >= 0 && static_cast<size_t>(result) < buffer->length) {
+        size_t written = static_cast<size_t>(result);
+        if (writeFully(file.fd, buffer->data.get() + written, buffer->length - written,
+                       buffer->offset + static_cast<int64_t>(written))) {
+            result = static_cast<ssize_t>(buffer->length);
+        } else {
+            result = -errno;
+        }
+    }
+
+    if (result < 0 && !file.failed) {
+        std::cerr << "Failed to write " << file.path << ": " << std::strerror(static_cast<int>(-result)) << std::endl;
+        file.failed = true;
+        m_failed = true;
+    }
+
+    m_inFlight--;
+    if (--file.pendingWrites == 0 && file.closeRequested) {
+        finalizeFile(file);
+    }
+
+    buffer->file.reset();
+    m_freeBuffers.push_back(buffer);
+}
+
+bool ExtractionWriter::reapOne() {
+#ifdef XEMURUN_HAVE_LIBURING
+    if (m_ring) {
+        io_uring_cqe* cqe = nullptr;
+        int result = m_unsubmitted > 0 ? io_uring_submit_and_wait(&m_ring->ring, 1) : 0;
+        m_unsubmitted = 0;
+        if (result >= 0) {
+            result = io_uring_wait_cqe(&m_ring->ring, &cqe);
+        }
+        if (result < 0) {
+            std::cerr << "io_uring wait failed: " << std::strerror(-result) << std::endl;
+            return false;
+        }
+
+        Buffer* buffer = static_cast<Buffer*>(io_uring_cqe_get_data(cqe));
+        ssize_t written = cqe->res;
+        io_uring_cqe_seen(&m_ring->ring, cqe);
+        complete(buffer, written);
+        return true;
+    }
+#endif
+    // Synchronous writes complete inside flush()
+    return false;
+}
+
+void ExtractionWriter::finalizeFile(File& file) {
+    timespec times[2] = {file.mtime, file.mtime};
+    futimens(file.fd, times);
+    if (close(file.fd) != 0 && !file.failed) {
+        std::cerr << "Failed to close " << file.path << ": " << std::strerror(errno) << std::endl;
+        file.failed = true;
+        m_failed = true;
+    }
+    file.fd = -1;
+}
+
+} // namespace XEmuRun
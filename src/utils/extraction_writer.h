@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+namespace XEmuRun {
+
+// A run of bytes in a file; outside its extents a sparse file is a hole
+struct FileExtent {
+    int64_t offset;
+    int64_t length;
+};
+
+/**
+ * @class ExtractionWriter
+ * @brief Writes extracted files with few, large, asynchronous writes.
+ *
+ * Each file is preallocated to its final size, then written from a small
+ * pool of large buffers that coalesce the archive's data blocks. With
+ * liburing the writes are queued on an io_uring and submitted in batches,
+ * so decompression overlaps with the device; without it they are plain
+ * pwrite() calls. Nothing is fsynced per file: finish() waits for all
+ * writes and syncs the filesystem once.
+ *
+ * Paths are resolved from the output directory one component at a time
+ * and no component may be a symlink, so an entry can never write through a
+ * link that an earlier entry, or anyone else, planted in the tree.
+ *
+ * Calls come from one thread. Only one file is written at a time, but
+ * writes to earlier files may still be in flight.
+ */
+class ExtractionWriter {
+public:
+    explicit ExtractionWriter(const std::string& outputDir);
+    ~ExtractionWriter();
+
+    ExtractionWriter(const ExtractionWriter&) = delete;
+    ExtractionWriter& operator=(const ExtractionWriter&) = delete;
+
+    // Creates the directory and its parents; its mode and mtime are
+    // restored by finish(), once nothing more is created inside it
+    bool makeDirectory(const std::string& path, mode_t mode, const timespec& mtime);
+
+    // Creates or truncates the file and reserves size bytes for it. A
+    // sparse file only gets its data extents reserved; the rest stay holes.
+    bool openFile(const std::string& path, mode_t mode, int64_t size, const timespec& mtime,
+                  const std::vector<FileExtent>* dataExtents = nullptr);
+    bool write(const void* data, size_t size, int64_t offset);
+    // The file is closed, with its mtime restored, once its writes complete
+    bool closeFile();
+
+    // Waits for all writes and syncs the filesystem. Returns false if any
+    // write failed.
+    bool finish();
+
+private:
+    struct File;
+    struct Buffer;
+    struct Ring;
+
+    struct DirectoryFixup {
+        std::string path; // relative to the output directory
+        mode_t mode;
+        timespec mtime;
+    };
+
+    // Opens the directory at path, relative to the output directory, without
+    // following symlinks; with create, missing components are made. Returns
+    // -1 on failure.
+    int openDirectory(const std::string& path, bool create);
+    // path relative to the output directory, or empty if it is outside it
+    std::string relativePath(const std::string& path) const;
+
+    Buffer* acquireBuffer();
+    bool flush();
+    void complete(Buffer* buffer, ssize_t result);
+    bool reapOne();
+    void finalizeFile(File& file);
+
+    std::string m_outputDir;
+    int m_rootFd = -1;
+
+    std::vector<std::unique_ptr<Buffer>> m_buffers;
+    std::vector<Buffer*> m_freeBuffers;
+    Buffer* m_current = nullptr; // being filled
+    std::shared_ptr<File> m_file; // being written
+    int m_inFlight = 0;
+    int m_unsubmitted = 0;
+
+    // Declared after the buffers so it is torn down before them
+    std::unique_ptr<Ring> m_ring; // null when io_uring is unavailable
+
+    std::vector<DirectoryFixup> m_directoryFixups;
+    bool m_failed = false;
+};
+
+} // namespace XEmuRun
@@ -0,0 +1,184 @@
+#include "process.h"
+#include <iostream>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char** environ;
+
+namespace XEmuRun {
+
+Process::~Process() {
+    if (isRunning()) {
+        terminate(true);
+        wait();
+    }
+}
+
+bool Process::spawn(const std::vector<std::string>& argv, const Environment& environment) {
+    if (argv.empty()) {
+        std::cerr << "Cannot start a process without a command" << std::endl;
+        return false;
+    }
+    return start(argv[0], true, argv, environment);
+}
+
+bool Process::spawnFd(int fd, const std::vector<std::string>& argv, const Environment& environment) {
+    if (argv.empty()) {
+        std::cerr << "Cannot start a process without a name" << std::endl;
+        return false;
+    }
+    // What fexecve() does: the child opens its own copy of the descriptor
+    return start("/proc/self/fd/" + std::to_string(fd), false, argv, environment);
+}
+
+void Process::setBaseEnvironment(const std::vector<std::string>& environment) {
+    m_baseEnvironment = environment;
+}
+
+void Process::setWorkingDirectory(const std::string& directory) {
+    m_workingDirectory = directory;
+}
+
+bool Process::start(const std::string& path, bool searchPath, const std::vector<std::string>& argv,
+                    const Environment& environment) {
+    if (isRunning()) {
+        std::cerr << "Process is already running" << std::endl;
+        return false;
+    }
+
+    // Inherited (or base) environment with the overrides applied
+    std::vector<std::string> inherited;
+    if (m_baseEnvironment.empty()) {
+        for (char** entry = environ; entry && *entry; ++entry) {
+            inherited.emplace_back(*entry);
+        }
+    } else {
+        inherited = m_baseEnvironment;
+    }
+    std::vector<std::string> envStrings;
+    for (std::string& variable : inherited) {
+        std::string name = variable.substr(0, variable.find('='));
+        bool overridden = false;
+        for (const auto& [key, value] : environment) {
+            overridden = overridden || key == name;
+        }
+        if (!overridden) {
+            envStrings.push_back(std::move(variable));
+        }
+    }
+    for (const auto& [key, value] : environment) {
+        envStrings.push_back(key + "=" + value);
+    }
+
+    std::vector<char*> args;
+    for (const std::string& arg : argv) {
+        args.push_back(const_cast<char*>(arg.c_str()));
+    }
+    args.push_back(nullptr);
+
+    std::vector<char*> envp;
+    for (std::string& variable : envStrings) {
+        envp.push_back(variable.data());
+    }
+    envp.push_back(nullptr);
+
+    // The daemon ignores SIGPIPE and threads may block signals; neither
+    // should leak into the game
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    sigset_t mask;
+    sigemptyset(&mask);
+    posix_spawnattr_setsigmask(&attr, &mask);
+    sigset_t defaults;
+    sigemptyset(&defaults);
+    sigaddset(&defaults, SIGPIPE);
+    posix_spawnattr_setsigdefault(&attr, &defaults);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    if (!m_workingDirectory.empty()) {
+        posix_spawn_file_actions_addchdir_np(&actions, m_workingDirectory.c_str());
+    }
+
+    pid_t pid = -1;
+    int result = searchPath ? posix_spawnp(&pid, path.c_str(), &actions, &attr, args.data(), envp.data())
+                            : posix_spawn(&pid, path.c_str(), &actions, &attr, args.data(), envp.data());
+    posix_spawn_file_actions_destroy(&actions);
+    posix_spawnattr_destroy(&attr);
+
+    if (result != 0) {
+        std::cerr << "Failed to start " << argv[0] << ": " << std::strerror(result) << std::endl;
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_pid = pid;
+    m_reaped = false;
+    m_exitCode = -1;
+    return true;
+}
+
+int Process::wait() {
+    pid_t pid;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_pid < 0 || m_reaped) {
+            return m_exitCode;
+        }
+        pid = m_pid;
+    }
+
+    // Wait without reaping, so the pid stays ours until the lock is held
+    siginfo_t info;
+    while (waitid(P_PID, pid, &info, WEXITED | WNOWAIT) != 0 && errno == EINTR) {
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_reaped) {
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0 && errno == EINTR) {
+        }
+        if (WIFEXITED(status)) {
+            m_exitCode = WEXITSTATUS(status);
+        } else if (WIFSIGNALED(status)) {
+            m_exitCode = 128 + WTERMSIG(status);
+        } else {
+            m_exitCode = 1;
+        }
+        m_reaped = true;
+    }
+    return m_exitCode;
+}
+
+void Process::terminate(bool force) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_pid > 0 && !m_reaped) {
+        kill(m_pid, force ? SIGKILL : SIGTERM);
+    }
+}
+
+bool Process::isRunning() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_pid > 0 && !m_reaped;
+}
+
+std::string formatCommandLine(const std::vector<std::string>& argv) {
+    std::string line;
+    for (const std::string& arg : argv) {
+        if (!line.empty()) {
+            line += ' ';
+        }
+        if (arg.find_first_of(" \t\"'") != std::string::npos) {
+            line += "\"" + arg + "\"";
+        } else {
+            line += arg;
+        }
+    }
+    return line;
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <sys/types.h>
+
+namespace XEmuRun {
+
+/**
+ * @class Process
+ * @brief Child process started with posix_spawn, without going through a shell.
+ *
+ * wait() and terminate() may be called from different threads: the child is
+ * only reaped while holding the lock terminate() takes, so a signal can
+ * never reach an unrelated process that reused the pid.
+ */
+class Process {
+public:
+    using Environment = std::vector<std::pair<std::string, std::string>>;
+
+    Process() = default;
+    // Kills and reaps a child that is still running
+    ~Process();
+
+    Process(const Process&) = delete;
+    Process& operator=(const Process&) = delete;
+
+    // Starts argv[0], searched in PATH. Entries in environment are added to,
+    // or replace, the inherited environment.
+    bool spawn(const std::vector<std::string>& argv, const Environment& environment = {});
+    // Starts the executable open at fd, e.g. a memfd, like fexecve() does.
+    // The descriptor must survive exec, i.e. not be close-on-exec, when it
+    // holds a script. argv[0] is just the name the child sees.
+    bool spawnFd(int fd, const std::vector<std::string>& argv, const Environment& environment = {});
+
+    // Later spawns start from these "NAME=value" strings instead of this
+    // process's environment, and in this directory instead of its own, e.g.
+    // those of the client a daemon starts a game for. Empty means inherit.
+    void setBaseEnvironment(const std::vector<std::string>& environment);
+    void setWorkingDirectory(const std::string& directory);
+
+    // Blocks until the child exits. Returns its exit status, or 128 plus the
+    // signal number if it was killed, like a shell does; -1 if none was started.
+    int wait();
+
+    // Sends SIGTERM, or SIGKILL when forced
+    void terminate(bool force = false);
+
+    bool isRunning() const;
+
+private:
+    bool start(const std::string& path, bool searchPath, const std::vector<std::string>& argv,
+               const Environment& environment);
+
+    std::vector<std::string> m_baseEnvironment;
+    std::string m_workingDirectory;
+
+    mutable std::mutex m_mutex;
+    pid_t m_pid = -1;
+    bool m_reaped = false;
+    int m_exitCode = -1;
+};
+
+// Joins argv into a single line for logging
+std::string formatCommandLine(const std::vector<std::string>& argv);
+
+} // namespace XEmuRun
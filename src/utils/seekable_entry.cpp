@@ -0,0 +1,550 @@
+#include "seekable_entry.h"
+#include "archive.h"
+#include "snapshot.h"
+#include "trace.h"
+#include <iostream>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace XEmuRun {
+
+namespace {
+
+// Inflated in blocks of this size; the kernel asks for at most 128 KiB at a
+// time, so a block serves several reads
+constexpr size_t kBlockSize = 1 << 20;
+constexpr size_t kCachedBlocks = 32;
+
+// Output between checkpoints: the most a seek has to inflate and discard.
+// Each checkpoint holds a 32 KiB window, so an 8 GB image needs 16 MB.
+constexpr uint64_t kCheckpointSpan = 16 << 20;
+constexpr size_t kWindowSize = 32768;
+constexpr size_t kInputSize = 256 << 10;
+
+constexpr uint32_t kEndOfCentralDirectory = 0x06054b50;
+constexpr uint32_t kZip64EndLocator = 0x07064b50;
+constexpr uint32_t kZip64End = 0x06064b50;
+constexpr uint32_t kCentralHeader = 0x02014b50;
+constexpr uint32_t kLocalHeader = 0x04034b50;
+constexpr uint16_t kZip64Extra = 0x0001;
+constexpr uint16_t kMethodStored = 0;
+constexpr uint16_t kMethodDeflated = 8;
+
+uint16_t le16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | p[1] << 8);
+}
+
+uint32_t le32(const unsigned char* p) {
+    return static_cast<uint32_t>(le16(p)) | static_cast<uint32_t>(le16(p + 2)) << 16;
+}
+
+uint64_t le64(const unsigned char* p) {
+    return static_cast<uint64_t>(le32(p)) | static_cast<uint64_t>(le32(p + 4)) << 32;
+}
+
+bool readAt(int fd, void* buffer, size_t length, uint64_t offset) {
+    char* out = static_cast<char*>(buffer);
+    while (length > 0) {
+        ssize_t got = pread(fd, out, length, static_cast<off_t>(offset));
+        if (got < 0 && errno == EINTR) {
+            continue;
+        }
+        if (got <= 0) {
+            return false;
+        }
+        out += got;
+        length -= static_cast<size_t>(got);
+        offset += static_cast<uint64_t>(got);
+    }
+    return true;
+}
+
+} // namespace
+
+SeekableEntry::SeekableEntry() {
+    std::memset(&m_stream, 0, sizeof(m_stream));
+}
+
+SeekableEntry::~SeekableEntry() {
+    close();
+}
+
+bool SeekableEntry::open(const std::string& archivePath, const std::string& entryPath) {
+    XEMURUN_TRACE_SCOPE("archive", "SeekableEntry::open", entryPath.c_str());
+
+    close();
+    m_fd = ::open(archivePath.c_str(), O_RDONLY | O_CLOEXEC);
+    if (m_fd < 0) {
+        std::cerr << "Failed to open archive: " << archivePath << std::endl;
+        return false;
+    }
+    m_archivePath = archivePath;
+    m_entryPath = entryPath;
+
+    if (!findEntry(entryPath)) {
+        close();
+        return false;
+    }
+
+    bool sparse = false;
+    int64_t sparseSize = 0;
+    if (!readSparseMap(archivePath, entryPath, sparse, sparseSize, m_extents)) {
+        close();
+        return false;
+    }
+    if (!sparse) {
+        m_extents = {{0, static_cast<int64_t>(m_storedSize)}};
+        sparseSize = static_cast<int64_t>(m_storedSize);
+    }
+
+    uint64_t stored = 0;
+    for (const FileExtent& extent : m_extents) {
+        m_extentStarts.push_back(stored);
+        stored += static_cast<uint64_t>(extent.length);
+    }
+    if (stored != m_storedSize) {
+        std::cerr << "Entry does not match its sparse map: " << entryPath << std::endl;
+        close();
+        return false;
+    }
+    m_size = static_cast<uint64_t>(sparseSize);
+
+    if (m_deflated) {
+        // Raw deflate: zip entries carry no zlib header
+        if (inflateInit2(&m_stream, -MAX_WBITS) != Z_OK) {
+            close();
+            return false;
+        }
+        m_streamReady = true;
+        m_input.resize(kInputSize);
+        m_block.resize(kBlockSize);
+    }
+    return true;
+}
+
+void SeekableEntry::close() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_streamReady) {
+        inflateEnd(&m_stream);
+        std::memset(&m_stream, 0, sizeof(m_stream));
+    }
+    if (m_fd >= 0) {
+        ::close(m_fd);
+    }
+    m_fd = -1;
+    m_streamReady = false;
+    m_streamActive = false;
+    m_size = 0;
+    m_extents.clear();
+    m_extentStarts.clear();
+    m_checkpoints.clear();
+    m_indexChanged = false;
+    m_cache.clear();
+    m_window.clear();
+}
+
+bool SeekableEntry::findEntry(const std::string& entryPath) {
+    struct stat st;
+    if (fstat(m_fd, &st) != 0 || st.st_size < 22) {
+        return false;
+    }
+    uint64_t fileSize = static_cast<uint64_t>(st.st_size);
+
+    // The end record is last, after a comment of up to 64 KiB
+    size_t tailSize = static_cast<size_t>(std::min<uint64_t>(fileSize, 22 + 65535));
+    std::vector<unsigned char> tail(tailSize);
+    if (!readAt(m_fd, tail.data(), tailSize, fileSize - tailSize)) {
+        return false;
+    }
+    size_t end = tailSize - 22 + 1;
+    while (end > 0 && le32(&tail[end - 1]) != kEndOfCentralDirectory) {
+        --end;
+    }
+    if (end == 0) {
+        return false; // not a zip file
+    }
+    const unsigned char* record = &tail[end - 1];
+    uint64_t directoryEnd = fileSize - tailSize + (end - 1);
+    uint64_t directorySize = le32(record + 12);
+    uint64_t directoryOffset = le32(record + 16);
+
+    if (directoryOffset == 0xffffffff || directorySize == 0xffffffff) {
+        unsigned char locator[20];
+        unsigned char zip64[56];
+        if (directoryEnd < sizeof(locator) || !readAt(m_fd, locator, sizeof(locator), directoryEnd - sizeof(locator)) ||
+            le32(locator) != kZip64EndLocator || !readAt(m_fd, zip64, sizeof(zip64), le64(locator + 8)) ||
+            le32(zip64) != kZip64End) {
+            return false;
+        }
+        directorySize = le64(zip64 + 40);
+        directoryOffset = le64(zip64 + 48);
+    }
+    if (directoryOffset > fileSize || directorySize > fileSize - directoryOffset) {
+        return false;
+    }
+
+    std::vector<unsigned char> directory(static_cast<size_t>(directorySize));
+    if (!readAt(m_fd, directory.data(), directory.size(), directoryOffset)) {
+        return false;
+    }
+
+    for (size_t pos = 0; pos + 46 <= directory.size();) {
+        const unsigned char* header = &directory[pos];
+        if (le32(header) != kCentralHeader) {
+            return false;
+        }
+        uint16_t nameLength = le16(header + 28);
+        uint16_t extraLength = le16(header + 30);
+        uint16_t commentLength = le16(header + 32);
+        if (pos + 46 + nameLength + extraLength > directory.size()) {
+            return false;
+        }
+
+        std::string name(reinterpret_cast<const char*>(header + 46), nameLength);
+        if (name != entryPath) {
+            pos += 46 + nameLength + extraLength + commentLength;
+            continue;
+        }
+
+        uint16_t flags = le16(header + 8);
+        uint16_t method = le16(header + 10);
+        uint64_t compressedSize = le32(header + 20);
+        uint64_t storedSize = le32(header + 24);
+        uint64_t localOffset = le32(header + 42);
+
+        // Sizes that do not fit 32 bits are in the zip64 field, in this order
+        const unsigned char* extra = header + 46 + nameLength;
+        for (size_t at = 0; at + 4 <= extraLength;) {
+            uint16_t id = le16(extra + at);
+            uint16_t length = le16(extra + at + 2);
+            if (at + 4 + length > extraLength) {
+                break;
+            }
+            if (id == kZip64Extra) {
+                const unsigned char* field = extra + at + 4;
+                const unsigned char* fieldEnd = field + length;
+                for (uint64_t* value : {&storedSize, &compressedSize, &localOffset}) {
+                    if (*value == 0xffffffff && field + 8 <= fieldEnd) {
+                        *value = le64(field);
+                        field += 8;
+                    }
+                }
+            }
+            at += 4 + length;
+        }
+
+        if ((flags & 1) || (method != kMethodStored && method != kMethodDeflated)) {
+            std::cerr << "Entry is encrypted or compressed in a way that cannot be streamed: " << entryPath << std::endl;
+            return false;
+        }
+
+        // The local header's extra field may differ from the central one
+        unsigned char local[30];
+        if (!readAt(m_fd, local, sizeof(local), localOffset) || le32(local) != kLocalHeader) {
+            return false;
+        }
+        m_dataOffset = localOffset + sizeof(local) + le16(local + 26) + le16(local + 28);
+        m_deflated = method == kMethodDeflated;
+        m_storedSize = storedSize;
+        m_compressedSize = m_deflated ? compressedSize : storedSize;
+        return m_dataOffset <= fileSize && m_compressedSize <= fileSize - m_dataOffset;
+    }
+
+    std::cerr << "No " << entryPath << " in " << m_archivePath << std::endl;
+    return false;
+}
+
+ssize_t SeekableEntry::read(char* buffer, size_t length, uint64_t offset) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_fd < 0) {
+        return -1;
+    }
+    if (offset >= m_size) {
+        return 0;
+    }
+    length = static_cast<size_t>(std::min<uint64_t>(length, m_size - offset));
+
+    // Holes first, then the extents that overlap the range
+    std::memset(buffer, 0, length);
+    uint64_t end = offset + length;
+    auto extent = std::upper_bound(m_extents.begin(), m_extents.end(), offset,
+        [](uint64_t position, const FileExtent& e) {
+            return position < static_cast<uint64_t>(e.offset + e.length);
+        });
+    for (; extent != m_extents.end() && static_cast<uint64_t>(extent->offset) < end; ++extent) {
+        uint64_t from = std::max<uint64_t>(offset, static_cast<uint64_t>(extent->offset));
+        uint64_t to = std::min<uint64_t>(end, static_cast<uint64_t>(extent->offset + extent->length));
+        uint64_t stored = m_extentStarts[static_cast<size_t>(extent - m_extents.begin())] +
+                          (from - static_cast<uint64_t>(extent->offset));
+        char* out = buffer + (from - offset);
+        bool ok = m_deflated ? readCompressed(out, static_cast<size_t>(to - from), stored)
+                             : readStored(out, static_cast<size_t>(to - from), stored);
+        if (!ok) {
+            std::cerr << "Failed to read " << m_entryPath << " at offset " << from << std::endl;
+            return -1;
+        }
+    }
+    return static_cast<ssize_t>(length);
+}
+
+bool SeekableEntry::readStored(char* buffer, size_t length, uint64_t storedOffset) {
+    return readAt(m_fd, buffer, length, m_dataOffset + storedOffset);
+}
+
+bool SeekableEntry::readCompressed(char* buffer, size_t length, uint64_t storedOffset) {
+    while (length > 0) {
+        const CachedBlock* block = getBlock(storedOffset / kBlockSize);
+        size_t within = static_cast<size_t>(storedOffset % kBlockSize);
+        if (!block || within >= block->data.size()) {
+            return false;
+        }
+        size_t chunk = std::min(length, block->data.size() - within);
+        std::memcpy(buffer, block->data.data() + within, chunk);
+        buffer += chunk;
+        length -= chunk;
+        storedOffset += chunk;
+    }
+    return true;
+}
+
+const SeekableEntry::CachedBlock* SeekableEntry::getBlock(uint64_t index) {
+    auto cached = m_cache.find(index);
+    if (cached == m_cache.end()) {
+        if (!inflateTo(index)) {
+            return nullptr;
+        }
+        cached = m_cache.find(index);
+        if (cached == m_cache.end()) {
+            return nullptr;
+        }
+    }
+    cached->second.lastUse = ++m_useCounter;
+    return &cached->second;
+}
+
+bool SeekableEntry::inflateTo(uint64_t index) {
+    XEMURUN_TRACE_SCOPE("archive", "SeekableEntry::inflateTo");
+
+    uint64_t start = index * kBlockSize;
+    if (start >= m_storedSize) {
+        return false;
+    }
+
+    // Continue the stream if it is already between the nearest checkpoint
+    // and the block, otherwise start over from that checkpoint
+    auto next = std::upper_bound(m_checkpoints.begin(), m_checkpoints.end(), start,
+        [](uint64_t position, const Checkpoint& c) { return position < c.out; });
+    const Checkpoint* nearest = next == m_checkpoints.begin() ? nullptr : &*(next - 1);
+    uint64_t nearestOut = nearest ? nearest->out : 0;
+    if (!m_streamActive || m_outPos > start || m_outPos < nearestOut) {
+        if (!restart(nearest)) {
+            return false;
+        }
+    }
+
+    while (true) {
+        if (m_stream.avail_in == 0) {
+            size_t toRead = static_cast<size_t>(std::min<uint64_t>(m_input.size(), m_compressedSize - m_inPos));
+            if (toRead == 0 || !readAt(m_fd, m_input.data(), toRead, m_dataOffset + m_inPos)) {
+                m_streamActive = false;
+                return false; // truncated
+            }
+            m_stream.next_in = m_input.data();
+            m_stream.avail_in = static_cast<uInt>(toRead);
+            m_inPos += toRead;
+        }
+
+        size_t blockLimit = static_cast<size_t>(std::min<uint64_t>(kBlockSize, m_storedSize - m_blockIndex * kBlockSize));
+        unsigned char* out = reinterpret_cast<unsigned char*>(m_block.data()) + m_blockFill;
+        m_stream.next_out = out;
+        m_stream.avail_out = static_cast<uInt>(blockLimit - m_blockFill);
+
+        // Z_BLOCK stops at the end of each deflate block, the only places a
+        // checkpoint can be taken
+        int result = ::inflate(&m_stream, Z_BLOCK);
+        if (result != Z_OK && result != Z_STREAM_END && result != Z_BUF_ERROR) {
+            std::cerr << "Corrupt data in " << m_entryPath << std::endl;
+            m_streamActive = false;
+            return false;
+        }
+        size_t produced = static_cast<size_t>(m_stream.next_out - out);
+        remember(out, produced);
+        m_blockFill += produced;
+        m_outPos += produced;
+
+        bool atBlockEnd = (m_stream.data_type & 128) && !(m_stream.data_type & 64);
+        uint64_t lastOut = m_checkpoints.empty() ? 0 : m_checkpoints.back().out;
+        if (atBlockEnd && m_outPos >= lastOut + kCheckpointSpan) {
+            Checkpoint checkpoint;
+            checkpoint.in = m_inPos - m_stream.avail_in;
+            checkpoint.out = m_outPos;
+            checkpoint.bits = m_stream.data_type & 7;
+            checkpoint.window = m_window;
+            m_checkpoints.push_back(std::move(checkpoint));
+            m_indexChanged = true;
+        }
+
+        if (m_blockFill == blockLimit) {
+            if (m_blockComplete) {
+                cacheBlock(m_blockIndex, m_block.data(), blockLimit);
+            }
+            bool done = m_blockIndex == index;
+            ++m_blockIndex;
+            m_blockFill = 0;
+            m_blockComplete = true;
+            if (done) {
+                if (m_outPos >= m_storedSize) {
+                    m_streamActive = false;
+                }
+                return true;
+            }
+        }
+
+        if (result == Z_STREAM_END) {
+            m_streamActive = false;
+            std::cerr << "Entry is shorter than its header says: " << m_entryPath << std::endl;
+            return false;
+        }
+        if (result == Z_BUF_ERROR && m_stream.avail_in > 0) {
+            m_streamActive = false;
+            return false; // no progress possible
+        }
+    }
+}
+
+bool SeekableEntry::restart(const Checkpoint* checkpoint) {
+    m_streamActive = false;
+    if (inflateReset(&m_stream) != Z_OK) {
+        return false;
+    }
+    m_stream.avail_in = 0;
+    m_window.clear();
+    m_inPos = 0;
+    m_outPos = 0;
+
+    if (checkpoint) {
+        // A checkpoint in the middle of a byte resumes with its last bits
+        m_inPos = checkpoint->in;
+        if (checkpoint->bits) {
+            unsigned char byte;
+            if (checkpoint->in == 0 || !readAt(m_fd, &byte, 1, m_dataOffset + checkpoint->in - 1) ||
+                inflatePrime(&m_stream, checkpoint->bits, byte >> (8 - checkpoint->bits)) != Z_OK) {
+                return false;
+            }
+        }
+        if (!checkpoint->window.empty() &&
+            inflateSetDictionary(&m_stream, checkpoint->window.data(),
+                                 static_cast<uInt>(checkpoint->window.size())) != Z_OK) {
+            return false;
+        }
+        m_window = checkpoint->window;
+        m_outPos = checkpoint->out;
+    }
+
+    // The part of the block before the checkpoint never comes out
+    m_blockIndex = m_outPos / kBlockSize;
+    m_blockFill = static_cast<size_t>(m_outPos % kBlockSize);
+    m_blockComplete = m_blockFill == 0;
+    m_streamActive = true;
+    return true;
+}
+
+void SeekableEntry::remember(const unsigned char* data, size_t length) {
+    if (length >= kWindowSize) {
+        m_window.assign(data + length - kWindowSize, data + length);
+        return;
+    }
+    size_t overflow = m_window.size() + length > kWindowSize ? m_window.size() + length - kWindowSize : 0;
+    m_window.erase(m_window.begin(), m_window.begin() + static_cast<std::ptrdiff_t>(overflow));
+    m_window.insert(m_window.end(), data, data + length);
+}
+
+void SeekableEntry::cacheBlock(uint64_t index, const char* data, size_t length) {
+    if (m_cache.size() >= kCachedBlocks && m_cache.find(index) == m_cache.end()) {
+        auto oldest = std::min_element(m_cache.begin(), m_cache.end(), [](const auto& a, const auto& b) {
+            return a.second.lastUse < b.second.lastUse;
+        });
+        m_cache.erase(oldest);
+    }
+    CachedBlock& block = m_cache[index];
+    block.data.assign(data, data + length);
+    block.lastUse = ++m_useCounter;
+}
+
+bool SeekableEntry::loadIndex(const std::string& indexPath) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (!m_deflated) {
+        return true;
+    }
+
+    SnapshotSource source;
+    SnapshotReader snapshot;
+    if (!statSnapshotSource(m_archivePath, source) ||
+        !snapshot.open(indexPath, SnapshotKind::StreamIndex, source)) {
+        return false;
+    }
+
+    // The same package could hold the image under another name
+    std::vector<Checkpoint> checkpoints;
+    SnapshotEntry entry;
+    while (snapshot.next(entry)) {
+        if (entry.key == "entry" && entry.stringValue != m_entryPath) {
+            return false;
+        }
+        if (entry.type == SnapshotValueType::Record) {
+            checkpoints.emplace_back();
+        } else if (!checkpoints.empty()) {
+            Checkpoint& checkpoint = checkpoints.back();
+            if (entry.key == "in") {
+                checkpoint.in = static_cast<uint64_t>(entry.intValue);
+            } else if (entry.key == "out") {
+                checkpoint.out = static_cast<uint64_t>(entry.intValue);
+            } else if (entry.key == "bits") {
+                checkpoint.bits = static_cast<int>(entry.intValue);
+            } else if (entry.key == "window") {
+                checkpoint.window.assign(entry.stringValue.begin(), entry.stringValue.end());
+            }
+        }
+    }
+
+    for (size_t i = 0; i < checkpoints.size(); ++i) {
+        const Checkpoint& checkpoint = checkpoints[i];
+        if (checkpoint.in > m_compressedSize || checkpoint.out > m_storedSize || checkpoint.bits < 0 ||
+            checkpoint.bits > 7 || checkpoint.window.size() > kWindowSize ||
+            (i > 0 && checkpoint.out <= checkpoints[i - 1].out)) {
+            return false;
+        }
+    }
+    m_checkpoints = std::move(checkpoints);
+    m_streamActive = false;
+    return true;
+}
+
+void SeekableEntry::saveIndex(const std::string& indexPath) const {
+    if (!m_indexChanged) {
+        return;
+    }
+
+    SnapshotSource source;
+    if (!statSnapshotSource(m_archivePath, source)) {
+        return;
+    }
+
+    SnapshotWriter writer(SnapshotKind::StreamIndex);
+    writer.addString("entry", m_entryPath);
+    for (const Checkpoint& checkpoint : m_checkpoints) {
+        writer.beginRecord("checkpoint");
+        writer.addInt("in", static_cast<int64_t>(checkpoint.in));
+        writer.addInt("out", static_cast<int64_t>(checkpoint.out));
+        writer.addInt("bits", checkpoint.bits);
+        writer.addString("window", std::string_view(reinterpret_cast<const char*>(checkpoint.window.data()),
+                                                    checkpoint.window.size()));
+    }
+    writer.commitAsync(indexPath, source);
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "extraction_writer.h"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <sys/types.h>
+#include <zlib.h>
+
+namespace XEmuRun {
+
+/**
+ * @class SeekableEntry
+ * @brief Random read access to one file inside a zip package, without
+ * extracting it.
+ *
+ * A stored entry is read straight from the package. A deflated one is
+ * inflated a block at a time into a small cache. Reads never inflate from
+ * the start of the entry more than once: every few MB of output the
+ * inflater's state (input bit position and the last 32 KiB of output) is
+ * kept as a checkpoint, and a read starts from the nearest one before it.
+ * Checkpoints can be saved as a snapshot next to the caller's cache, so the
+ * next launch seeks anywhere at once.
+ *
+ * Holes of sparse files (see createArchive) read as zeros. CRCs are not
+ * checked; a corrupt stream fails the read with an error instead.
+ *
+ * Safe to call from several threads; reads are serialized.
+ */
+class SeekableEntry {
+public:
+    SeekableEntry();
+    ~SeekableEntry();
+
+    SeekableEntry(const SeekableEntry&) = delete;
+    SeekableEntry& operator=(const SeekableEntry&) = delete;
+
+    // Fails for archives that are not zip files and for entries that are
+    // neither stored nor deflated
+    bool open(const std::string& archivePath, const std::string& entryPath);
+    void close();
+
+    // Unpacked size, holes included
+    uint64_t size() const { return m_size; }
+
+    // Like pread(): the bytes read, 0 at the end, -1 on error
+    ssize_t read(char* buffer, size_t length, uint64_t offset);
+
+    // Checkpoints from an earlier run of the same package; ignored if the
+    // package changed since
+    bool loadIndex(const std::string& indexPath);
+    // Writes the checkpoints if this run added any
+    void saveIndex(const std::string& indexPath) const;
+
+private:
+    struct Checkpoint {
+        uint64_t in = 0; // first compressed byte not fully consumed
+        uint64_t out = 0;
+        int bits = 0; // bits of in's byte already consumed
+        std::vector<unsigned char> window;
+    };
+
+    struct CachedBlock {
+        std::vector<char> data;
+        uint64_t lastUse = 0;
+    };
+
+    bool findEntry(const std::string& entryPath);
+    bool readStored(char* buffer, size_t length, uint64_t storedOffset);
+    bool readCompressed(char* buffer, size_t length, uint64_t storedOffset);
+    const CachedBlock* getBlock(uint64_t index);
+    bool inflateTo(uint64_t index);
+    bool restart(const Checkpoint* checkpoint);
+    void remember(const unsigned char* data, size_t length);
+    void cacheBlock(uint64_t index, const char* data, size_t length);
+
+    std::mutex m_mutex;
+    int m_fd = -1;
+    std::string m_archivePath;
+    std::string m_entryPath;
+
+    // Where the entry's bytes are in the package
+    uint64_t m_dataOffset = 0;
+    uint64_t m_compressedSize = 0;
+    uint64_t m_storedSize = 0; // what the entry unpacks to, holes excluded
+    bool m_deflated = false;
+
+    // Where the stored bytes belong in the file; a whole file is one extent
+    uint64_t m_size = 0;
+    std::vector<FileExtent> m_extents;
+    std::vector<uint64_t> m_extentStarts; // in the stored bytes
+
+    // The inflater is left where the last read stopped, so sequential
+    // reads just continue it
+    z_stream m_stream;
+    bool m_streamReady = false;
+    bool m_streamActive = false;
+    uint64_t m_inPos = 0; // next compressed byte to feed
+    uint64_t m_outPos = 0;
+    std::vector<unsigned char> m_input;
+    std::vector<unsigned char> m_window; // up to the last 32 KiB of output
+    std::vector<char> m_block;
+    uint64_t m_blockIndex = 0;
+    size_t m_blockFill = 0;
+    bool m_blockComplete = false; // false while the block's start is missing
+
+    std::vector<Checkpoint> m_checkpoints; // sorted by out
+    bool m_indexChanged = false;
+
+    std::map<uint64_t, CachedBlock> m_cache;
+    uint64_t m_useCounter = 0;
+};
+
+} // namespace XEmuRun
@@ -0,0 +1,326 @@
+#include "snapshot.h"
+#include "trace.h"
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace XEmuRun {
+
+namespace {
+
+constexpr char kSnapshotMagic[8] = {'X', 'E', 'M', 'U', 'S', 'N', 'A', 'P'};
+constexpr uint32_t kSnapshotFormatVersion = 1;
+
+struct SnapshotHeader {
+    char magic[8];
+    uint32_t formatVersion;
+    uint32_t kind;
+    int64_t sourceMtimeNs;
+    uint64_t sourceSize;
+    uint64_t payloadSize;
+    uint64_t checksum;
+};
+
+// Each entry is: type (1 byte), key size (4), value size (4), key, value
+constexpr size_t kEntryHeaderSize = 1 + 4 + 4;
+
+uint64_t checksumPayload(const char* data, size_t size) {
+    // 64-bit FNV-1a
+    uint64_t hash = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+struct PendingSnapshot {
+    std::string path;
+    std::string contents;
+};
+
+bool writeSnapshotFile(const PendingSnapshot& snapshot) {
+    XEMURUN_TRACE_SCOPE("snapshot", "writeSnapshot", snapshot.path.c_str());
+
+    std::string tempPath = snapshot.path + ".tmp." + std::to_string(getpid());
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open snapshot for writing: " << tempPath << std::endl;
+            return false;
+        }
+        file.write(snapshot.contents.data(), static_cast<std::streamsize>(snapshot.contents.size()));
+        file.flush();
+        if (!file) {
+            std::cerr << "Failed to write snapshot: " << tempPath << std::endl;
+            file.close();
+            std::remove(tempPath.c_str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    fs::rename(tempPath, snapshot.path, ec);
+    if (ec) {
+        std::cerr << "Failed to replace snapshot " << snapshot.path << ": " << ec.message() << std::endl;
+        std::remove(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Single background thread that writes snapshots in submission order. It is
+// never destroyed, so it can still accept work while statics are torn down;
+// an exit handler drains whatever was queued before the process exits.
+class BackgroundWriter {
+public:
+    static BackgroundWriter& getInstance() {
+        static BackgroundWriter* instance = [] {
+            auto* writer = new BackgroundWriter();
+            std::atexit([] { getInstance().drain(); });
+            return writer;
+        }();
+        return *instance;
+    }
+
+    void submit(PendingSnapshot snapshot) {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_stopping) {
+            // Too late to hand off; the next start regenerates it
+            return;
+        }
+        m_queue.push_back(std::move(snapshot));
+        if (!m_thread.joinable()) {
+            m_thread = std::thread(&BackgroundWriter::run, this);
+        }
+        m_condition.notify_one();
+    }
+
+private:
+    void run() {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (;;) {
+            m_condition.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_queue.empty()) {
+                return;
+            }
+            PendingSnapshot snapshot = std::move(m_queue.front());
+            m_queue.pop_front();
+
+            lock.unlock();
+            writeSnapshotFile(snapshot);
+            lock.lock();
+        }
+    }
+
+    void drain() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_one();
+        if (m_thread.joinable()) {
+            m_thread.join();
+        }
+    }
+
+    std::mutex m_mutex;
+    std::condition_variable m_condition;
+    std::deque<PendingSnapshot> m_queue;
+    std::thread m_thread;
+    bool m_stopping = false;
+};
+
+} // namespace
+
+bool statSnapshotSource(const std::string& jsonPath, SnapshotSource& source) {
+    struct stat st;
+    if (::stat(jsonPath.c_str(), &st) != 0) {
+        return false;
+    }
+    source.mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+    source.size = static_cast<uint64_t>(st.st_size);
+    return true;
+}
+
+std::string snapshotPathFor(const std::string& jsonPath) {
+    return jsonPath + ".snap";
+}
+
+SnapshotReader::~SnapshotReader() {
+    close();
+}
+
+void SnapshotReader::close() {
+    if (m_mapping) {
+        munmap(m_mapping, m_mappingSize);
+    }
+    m_mapping = nullptr;
+    m_mappingSize = 0;
+    m_cursor = m_end = nullptr;
+}
+
+bool SnapshotReader::open(const std::string& jsonPath, SnapshotKind kind, const SnapshotSource& source) {
+    XEMURUN_TRACE_SCOPE("snapshot", "SnapshotReader::open", jsonPath.c_str());
+    close();
+
+    // A missing snapshot is the normal first-run case, not an error
+    int fd = ::open(snapshotPathFor(jsonPath).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    size_t size = static_cast<size_t>(st.st_size);
+    void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    m_mapping = mapping;
+    m_mappingSize = size;
+
+    SnapshotHeader header;
+    std::memcpy(&header, mapping, sizeof(header));
+    const char* payload = static_cast<const char*>(mapping) + sizeof(header);
+
+    if (std::memcmp(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0 ||
+        header.formatVersion != kSnapshotFormatVersion ||
+        header.kind != static_cast<uint32_t>(kind) ||
+        header.sourceMtimeNs != source.mtimeNs ||
+        header.sourceSize != source.size ||
+        header.payloadSize != size - sizeof(header) ||
+        header.checksum != checksumPayload(payload, header.payloadSize)) {
+        close();
+        return false;
+    }
+
+    m_cursor = payload;
+    m_end = payload + header.payloadSize;
+    return true;
+}
+
+bool SnapshotReader::next(SnapshotEntry& entry) {
+    if (!m_cursor || static_cast<size_t>(m_end - m_cursor) < kEntryHeaderSize) {
+        return false;
+    }
+
+    uint8_t type;
+    uint32_t keySize;
+    uint32_t valueSize;
+    std::memcpy(&type, m_cursor, 1);
+    std::memcpy(&keySize, m_cursor + 1, 4);
+    std::memcpy(&valueSize, m_cursor + 5, 4);
+
+    const char* key = m_cursor + kEntryHeaderSize;
+    if (static_cast<size_t>(m_end - key) < static_cast<size_t>(keySize) + valueSize) {
+        // The checksum matched, so this is a writer bug rather than damage
+        std::cerr << "Truncated snapshot entry" << std::endl;
+        m_cursor = nullptr;
+        return false;
+    }
+    const char* value = key + keySize;
+
+    entry = SnapshotEntry();
+    entry.type = static_cast<SnapshotValueType>(type);
+    entry.key = std::string_view(key, keySize);
+    switch (entry.type) {
+        case SnapshotValueType::String:
+            entry.stringValue = std::string_view(value, valueSize);
+            break;
+        case SnapshotValueType::Int:
+            if (valueSize == sizeof(int64_t)) {
+                std::memcpy(&entry.intValue, value, sizeof(int64_t));
+            }
+            break;
+        case SnapshotValueType::Bool:
+            entry.boolValue = valueSize > 0 && value[0] != 0;
+            break;
+        case SnapshotValueType::Record:
+            break;
+    }
+
+    m_cursor = value + valueSize;
+    return true;
+}
+
+SnapshotWriter::SnapshotWriter(SnapshotKind kind) : m_kind(kind) {
+}
+
+void SnapshotWriter::addEntry(SnapshotValueType type, std::string_view key, const void* value, uint32_t valueSize) {
+    uint8_t typeByte = static_cast<uint8_t>(type);
+    uint32_t keySize = static_cast<uint32_t>(key.size());
+    m_payload.append(reinterpret_cast<const char*>(&typeByte), 1);
+    m_payload.append(reinterpret_cast<const char*>(&keySize), 4);
+    m_payload.append(reinterpret_cast<const char*>(&valueSize), 4);
+    m_payload.append(key.data(), key.size());
+    m_payload.append(static_cast<const char*>(value), valueSize);
+}
+
+void SnapshotWriter::addString(std::string_view key, std::string_view value) {
+    addEntry(SnapshotValueType::String, key, value.data(), static_cast<uint32_t>(value.size()));
+}
+
+void SnapshotWriter::addInt(std::string_view key, int64_t value) {
+    addEntry(SnapshotValueType::Int, key, &value, sizeof(value));
+}
+
+void SnapshotWriter::addBool(std::string_view key, bool value) {
+    char byte = value ? 1 : 0;
+    addEntry(SnapshotValueType::Bool, key, &byte, 1);
+}
+
+void SnapshotWriter::beginRecord(std::string_view name) {
+    addEntry(SnapshotValueType::Record, name, "", 0);
+}
+
+namespace {
+
+PendingSnapshot buildSnapshot(const std::string& jsonPath, SnapshotKind kind,
+                              const SnapshotSource& source, const std::string& payload) {
+    SnapshotHeader header{};
+    std::memcpy(header.magic, kSnapshotMagic, sizeof(kSnapshotMagic));
+    header.formatVersion = kSnapshotFormatVersion;
+    header.kind = static_cast<uint32_t>(kind);
+    header.sourceMtimeNs = source.mtimeNs;
+    header.sourceSize = source.size;
+    header.payloadSize = payload.size();
+    header.checksum = checksumPayload(payload.data(), payload.size());
+
+    PendingSnapshot snapshot;
+    snapshot.path = snapshotPathFor(jsonPath);
+    snapshot.contents.reserve(sizeof(header) + payload.size());
+    snapshot.contents.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    snapshot.contents.append(payload);
+    return snapshot;
+}
+
+} // namespace
+
+bool SnapshotWriter::commit(const std::string& jsonPath, const SnapshotSource& source) const {
+    return writeSnapshotFile(buildSnapshot(jsonPath, m_kind, source, m_payload));
+}
+
+void SnapshotWriter::commitAsync(const std::string& jsonPath, const SnapshotSource& source) const {
+    BackgroundWriter::getInstance().submit(buildSnapshot(jsonPath, m_kind, source, m_payload));
+}
+
+} // namespace XEmuRun
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+namespace XEmuRun {
+
+// What a snapshot holds, so one kind is never read back as another
+enum class SnapshotKind : uint32_t {
+    Config = 1,
+    Manifest = 2,
+    Library = 3,
+    LinkerCache = 4,
+    StreamIndex = 5
+};
+
+enum class SnapshotValueType : uint8_t {
+    String = 1,
+    Int = 2,
+    Bool = 3,
+    // Starts a named group of entries (a library game, a manifest's config)
+    Record = 4
+};
+
+// Identity of the JSON file a snapshot was built from
+struct SnapshotSource {
+    int64_t mtimeNs = 0;
+    uint64_t size = 0;
+};
+
+bool statSnapshotSource(const std::string& jsonPath, SnapshotSource& source);
+
+// The snapshot lives next to its JSON file: "system.json" -> "system.json.snap"
+std::string snapshotPathFor(const std::string& jsonPath);
+
+struct SnapshotEntry {
+    SnapshotValueType type = SnapshotValueType::String;
+    std::string_view key;
+    std::string_view stringValue;
+    int64_t intValue = 0;
+    bool boolValue = false;
+};
+
+/**
+ * @class SnapshotReader
+ * @brief Memory-mapped view of a binary snapshot of a JSON file.
+ *
+ * The file is a versioned header followed by a flat list of typed key/value
+ * entries. Entries are read in place, so string views point into the mapping
+ * and stay valid for the lifetime of the reader. Snapshots are a local cache
+ * in native byte order, not an interchange format.
+ */
+class SnapshotReader {
+public:
+    SnapshotReader() = default;
+    ~SnapshotReader();
+
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    // Fails if the snapshot is missing, corrupt, of another kind, or was
+    // built from a different version of the JSON file
+    bool open(const std::string& jsonPath, SnapshotKind kind, const SnapshotSource& source);
+
+    // Returns the next entry in file order, or false at the end
+    bool next(SnapshotEntry& entry);
+
+private:
+    void close();
+
+    void* m_mapping = nullptr;
+    size_t m_mappingSize = 0;
+    const char* m_cursor = nullptr;
+    const char* m_end = nullptr;
+};
+
+class SnapshotWriter {
+public:
+    explicit SnapshotWriter(SnapshotKind kind);
+
+    void addString(std::string_view key, std::string_view value);
+    void addInt(std::string_view key, int64_t value);
+    void addBool(std::string_view key, bool value);
+    void beginRecord(std::string_view name);
+
+    // Writes the snapshot atomically (temp file + rename). The source must be
+    // stat'ed before the JSON was read, so a concurrent edit leaves the
+    // snapshot stale rather than wrong.
+    bool commit(const std::string& jsonPath, const SnapshotSource& source) const;
+
+    // Same, on a background thread; pending writes finish at exit
+    void commitAsync(const std::string& jsonPath, const SnapshotSource& source) const;
+
+private:
+    void addEntry(SnapshotValueType type, std::string_view key, const void* value, uint32_t valueSize);
+
+    SnapshotKind m_kind;
+    std::string m_payload;
+};
+
+} // namespace XEmuRun
@@ -0,0 +1,92 @@
+#include "trace.h"
+#include <iostream>
+#include <fstream>
+#include <json/json.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+namespace XEmuRun {
+
+Tracer& Tracer::getInstance() {
+    static Tracer instance;
+    return instance;
+}
+
+Tracer::Tracer() : m_enabled(false), m_epoch(std::chrono::steady_clock::now()) {
+}
+
+void Tracer::enable() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_epoch = std::chrono::steady_clock::now();
+    m_events.clear();
+    m_enabled.store(true, std::memory_order_release);
+}
+
+std::uint64_t Tracer::nowUs() const {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+void Tracer::record(TraceEvent event) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_events.push_back(std::move(event));
+}
+
+std::uint32_t Tracer::currentThreadId() {
+    // Kernel thread ids match what perf and /proc report for the same thread
+    thread_local std::uint32_t tid = static_cast<std::uint32_t>(syscall(SYS_gettid));
+    return tid;
+}
+
+bool Tracer::writeToFile(const std::string& path) {
+    std::vector<TraceEvent> events;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        events.swap(m_events);
+    }
+
+    const Json::UInt pid = static_cast<Json::UInt>(getpid());
+
+    Json::Value traceEvents(Json::arrayValue);
+
+    // Name the process so Perfetto shows something readable in the track list
+    Json::Value processName;
+    processName["name"] = "process_name";
+    processName["ph"] = "M";
+    processName["pid"] = pid;
+    processName["args"]["name"] = "xemurun";
+    traceEvents.append(processName);
+
+    for (const auto& event : events) {
+        Json::Value value;
+        value["name"] = event.name;
+        value["cat"] = event.category;
+        value["ph"] = "X";
+        value["ts"] = Json::UInt64(event.startUs);
+        value["dur"] = Json::UInt64(event.durationUs);
+        value["pid"] = pid;
+        value["tid"] = Json::UInt(event.threadId);
+        if (!event.detail.empty()) {
+            value["args"]["detail"] = event.detail;
+        }
+        traceEvents.append(value);
+    }
+
+    Json::Value root;
+    root["traceEvents"] = traceEvents;
+    root["displayTimeUnit"] = "ms";
+
+    std::ofstream file(path);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open trace file for writing: " << path << std::endl;
+        return false;
+    }
+
+    Json::FastWriter writer;
+    file << writer.write(root);
+
+    std::cout << "Trace written to " << path << " (" << events.size() << " spans)" << std::endl;
+    return true;
+}
+
+} // namespace XEmuRun
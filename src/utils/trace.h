@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace XEmuRun {
+
+/**
+ * A single completed span, stored until the trace is written out.
+ * Name and category must point to static storage (string literals).
+ */
+struct TraceEvent {
+    const char* category;
+    const char* name;
+    std::string detail;
+    std::uint64_t startUs;
+    std::uint64_t durationUs;
+    std::uint32_t threadId;
+};
+
+/**
+ * @class Tracer
+ * @brief Collects scoped spans and writes them as Chrome trace JSON.
+ *
+ * The output can be opened in Perfetto (ui.perfetto.dev) or chrome://tracing.
+ * While disabled, spans cost a single relaxed atomic load.
+ */
+class Tracer {
+public:
+    static Tracer& getInstance();
+
+    void enable();
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+
+    std::uint64_t nowUs() const;
+    void record(TraceEvent event);
+
+    bool writeToFile(const std::string& path);
+
+    static std::uint32_t currentThreadId();
+
+private:
+    Tracer();
+    ~Tracer() = default;
+
+    // Prevent copying
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    std::atomic<bool> m_enabled;
+    std::chrono::steady_clock::time_point m_epoch;
+    std::mutex m_mutex;
+    std::vector<TraceEvent> m_events;
+};
+
+/**
+ * RAII span recorded on destruction. Use through XEMURUN_TRACE_SCOPE.
+ */
+class TraceSpan {
+public:
+    TraceSpan(const char* category, const char* name, const char* detail = nullptr)
+        : m_category(category), m_name(name), m_active(Tracer::getInstance().isEnabled()) {
+        if (m_active) {
+            if (detail) {
+                m_detail = detail;
+            }
+            m_startUs = Tracer::getInstance().nowUs();
+        }
+    }
+
+    ~TraceSpan() {
+        if (m_active) {
+            Tracer& tracer = Tracer::getInstance();
+            tracer.record({m_category, m_name, std::move(m_detail), m_startUs,
+                           tracer.nowUs() - m_startUs, Tracer::currentThreadId()});
+        }
+    }
+
+    TraceSpan(const TraceSpan&) = delete;
+    TraceSpan& operator=(const TraceSpan&) = delete;
+
+private:
+    const char* m_category;
+    const char* m_name;
+    std::string m_detail;
+    std::uint64_t m_startUs = 0;
+    bool m_active;
+};
+
+} // namespace XEmuRun
+
+#define XEMURUN_TRACE_CONCAT_INNER(a, b) a##b
+#define XEMURUN_TRACE_CONCAT(a, b) XEMURUN_TRACE_CONCAT_INNER(a, b)
+
+// Records a span covering the rest of the enclosing scope
+#define XEMURUN_TRACE_SCOPE(category, ...) \
+    ::XEmuRun::TraceSpan XEMURUN_TRACE_CONCAT(xemurunTraceSpan_, __LINE__)(category, __VA_ARGS__)